@@ -120,6 +120,15 @@ error_t arch_barrier_destroy(struct cluster_s *cluster, uint_t barrier_id)
 }
 
 
+error_t arch_cpu_set_tick(struct cpu_s *cpu, uint_t ticks_nr)
+{
+	uint_t value;
+
+	value = (ticks_nr == 0) ? cpu_get_ticks_period(cpu) : ticks_nr * cpu_get_ticks_period(cpu);
+
+	return soclib_xicu_timer_set(get_arch_entry(cpu->cluster->id)->xicu, cpu->lid, value);
+}
+
 //FIXME
 error_t arch_cpu_send_ipi(gid_t dest, uint32_t val)
 {
@@ -52,7 +52,7 @@ static sint_t fb_read(struct device_s *fb, dev_request_t *rq)
 	if(src == limit)
 		return 0;
 
-	size = ((src + rq->count) > limit) ? limit - (src + rq->count) : rq->count;
+	size = ((src + rq->count) > limit) ? (size_t)(limit - src) : rq->count;
 
 #if CONFIG_FB_USE_DMA
 	error_t err;
@@ -64,6 +64,7 @@ static sint_t fb_read(struct device_s *fb, dev_request_t *rq)
 #else
 	memcpy(rq->dst, src, size);
 #endif
+	rq->file->f_remote->fr_offset += size;
 	return size;
 }
 
@@ -81,7 +82,7 @@ static sint_t fb_write(struct device_s *fb, dev_request_t *rq)
 	if(dst == limit)
 		return -ERANGE;
 
-	size = ((dst + rq->count) > limit) ? limit - (dst + rq->count) : rq->count;
+	size = ((dst + rq->count) > limit) ? (size_t)(limit - dst) : rq->count;
 
 #if CONFIG_FB_USE_DMA
 	error_t err;
@@ -93,7 +94,9 @@ static sint_t fb_write(struct device_s *fb, dev_request_t *rq)
 	//printk(INFO,"%s: dst 0x%x, src 0x%x, size %d\n", __FUNCTION__, dst, rq->src, size);
 	memcpy(dst, rq->src, size);
 #endif
-	return rq->count;
+	/* Consecutive writes (devfs chunks, sendfile) follow each other */
+	rq->file->f_remote->fr_offset += size;
+	return size;
 }
 
 static error_t fb_lseek(struct device_s *fb, dev_request_t *rq)
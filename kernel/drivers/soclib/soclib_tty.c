@@ -35,6 +35,7 @@
 #include <cpu-trace.h>
 #include <thread.h>
 #include <mwmr.h>
+#include <poll.h>
 
 /* This is a basic terminal mangement */
 
@@ -48,6 +49,7 @@ struct tty_context_s
 	unsigned int eol;		/* End Of Line */
 	dev_request_t *pending_rq;
 	struct wait_queue_s wait_queue;
+	struct poll_queue_s poll_queue;
 	struct fifomwmr_s *tty_buffer;
 };
 
@@ -198,6 +200,28 @@ sint_t tty_write(struct device_s *tty, dev_request_t *rq)
 	return size;
 }
 
+/* Readable once a whole line has been buffered, always writable */
+uint_t tty_poll(struct device_s *tty, struct poll_entry_s *entry)
+{
+	struct tty_context_s *ctx;
+	uint_t irq_state;
+	uint_t revents;
+
+	ctx     = (struct tty_context_s*)tty->data;
+	revents = POLLOUT;
+
+	spinlock_lock_noirq(&tty->lock, &irq_state);
+
+	if(ctx->eol)
+		revents |= POLLIN;
+
+	if(entry != NULL)
+		poll_register(&ctx->poll_queue, &tty->lock, entry);
+
+	spinlock_unlock_noirq(&tty->lock, irq_state);
+	return revents;
+}
+
 sint_t tty_get_params(struct device_s *tty, dev_params_t *params)
 {
 	memset(params, 0, sizeof(*params));
@@ -249,7 +273,13 @@ void tty_irq_handler(struct irq_action_s *action)
 		else
 		{
 			mwmr_write(ctx->tty_buffer, &ch, 1);
-			if(ch == '\n') ctx->eol = 1;
+
+			/* A buffered line is what makes a read return at once */
+			if((ch == '\n') && (ctx->eol == 0))
+			{
+				ctx->eol = 1;
+				poll_notify(&ctx->poll_queue, POLLIN);
+			}
 		}
 
 #if CONFIG_TTY_ECHO_MODE
@@ -295,6 +325,7 @@ error_t soclib_tty_init(struct device_s *tty)
 	tty->op.dev.munmap      = NULL;
 	tty->op.dev.set_params  = NULL;
 	tty->op.dev.get_params  = &tty_get_params;
+	tty->op.dev.poll        = &tty_poll;
 	tty->op.drvid           = SOCLIB_TTY_ID;
 
 	req.type  = KMEM_GENERIC;
@@ -319,6 +350,7 @@ error_t soclib_tty_init(struct device_s *tty)
 
 	metafs_init(&tty->node, tty->name);
 	wait_queue_init(&ctx->wait_queue, tty->name);
+	poll_queue_init(&ctx->poll_queue);
 	tty_count ++;
 	return 0;
 }
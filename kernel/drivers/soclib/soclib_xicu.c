@@ -276,6 +276,15 @@ error_t soclib_xicu_bind_wti(struct device_s *icu, struct irq_action_s *action,
 	return 0;
 }
 
+error_t soclib_xicu_timer_set(struct device_s *xicu, uint_t pti_index, uint32_t val)
+{
+	if(pti_index >= XICU_PTI_MAX)
+		return ERANGE;
+
+	xicu_reg_write(xicu->base, xicu->cid, XICU_PTI_VAL, pti_index, val);
+	return 0;
+}
+
 error_t soclib_xicu_ipi_send(struct device_s *xicu, uint_t port, uint32_t val)
 {
 	xicu_reg_write(xicu->base, xicu->cid, XICU_WTI_REG, port, val);
@@ -69,6 +69,7 @@ sint_t  soclib_xicu_barrier_init(struct device_s *xicu, struct event_s *event, u
 sint_t  soclib_xicu_barrier_wait(struct device_s *xicu, uint_t barrier_id);
 error_t soclib_xicu_barrier_destroy(struct device_s *xicu, uint_t barrier_id);
 error_t soclib_xicu_ipi_send(struct device_s *xicu, uint_t port, uint32_t val);
+error_t soclib_xicu_timer_set(struct device_s *xicu, uint_t pti_index, uint32_t val);
 
 extern driver_t soclib_xicu_driver;
 
@@ -29,6 +29,7 @@
 #include <errno.h>
 #include <metafs.h>
 #include <thread.h>
+#include <poll.h>
 
 #include <devfs.h>
 #include <devfs-private.h>
@@ -138,18 +139,40 @@ VFS_WRITE_FILE(devfs_write)
 {
 	register struct device_s *dev;
         uint8_t buff[TMP_BUFF_SZ];
+	struct ku_obj slice;
 	dev_request_t rq;
+	size_t size;
+	size_t done;
+	sint_t count;
 	
-	dev = (struct device_s*)file->f_private.dev;
-	
-	//FIXME avoid the extra copy ?
-	buffer->scpy_from_buff(buffer, (void*)&buff[0], TMP_BUFF_SZ);
-	rq.src   = (void*)&buff[0];
-	rq.count = buffer->size;
-	rq.flags = 0;
-	rq.file  = file;
-  
-	return dev->op.dev.write(dev, &rq);
+	dev   = (struct device_s*)file->f_private.dev;
+	size  = buffer->get_size(buffer);
+	slice = *buffer;
+
+	/* The buffer is handed to the device TMP_BUFF_SZ bytes at a time */
+	for(done = 0; done < size; done += count)
+	{
+		//FIXME avoid the extra copy ?
+		count = MIN(size - done, TMP_BUFF_SZ);
+		slice.scpy_from_buff(&slice, (void*)&buff[0], count);
+		slice.buff = (uint8_t*)slice.buff + count;
+
+		rq.src   = (void*)&buff[0];
+		rq.count = count;
+		rq.flags = 0;
+		rq.file  = file;
+
+		if((count = dev->op.dev.write(dev, &rq)) < 0)
+			return (done) ? (ssize_t)done : count;
+
+		if((size_t)count != rq.count)
+		{
+			done += count;
+			break;
+		}
+	}
+
+	return done;
 }
 
 VFS_LSEEK_FILE(devfs_lseek)
@@ -256,6 +279,18 @@ VFS_MMAP_FILE(devfs_munmap)
 	return dev->op.dev.munmap(dev, &rq);
 }
 
+VFS_POLL_FILE(devfs_poll)
+{
+	register struct device_s *dev;
+
+	dev = (struct device_s*)file->f_private.dev;
+
+	if((dev == NULL) || (dev->op.dev.poll == NULL))
+		return POLLIN | POLLOUT;
+
+	return dev->op.dev.poll(dev, entry);
+}
+
 
 const struct vfs_file_op_s devfs_f_op = 
 {
@@ -267,5 +302,6 @@ const struct vfs_file_op_s devfs_f_op =
 	.munmap  = devfs_munmap,
 	.readdir = devfs_readdir,
 	.close   = devfs_close,
-	.release = devfs_release
+	.release = devfs_release,
+	.poll    = devfs_poll
 };
@@ -88,6 +88,9 @@ error_t cpu_init(struct cpu_s *cpu, struct cluster_s *cluster, uint_t lid, uint_
 	cpu->irq_nr            = 0;
 	cpu->spurious_irq_nr   = 0;
 	cpu->rpc_working_thread = 0;
+	cpu->tickless          = false;
+	cpu->tickless_start    = 0;
+	cpu->tickless_nr       = 0;
 
 	alarm_manager_init(&cpu->alarm_mgr);
 	sched_init(&cpu->scheduler);
@@ -157,6 +160,12 @@ void cpu_compute_stats(struct cpu_s *cpu, sint_t threshold)
 	idle->ticks_nr   = 0;
 }
 
+/* 
+ * Account the whole ticks elapsed since the last update.  The time
+ * stamp only advances by these ticks, so that the remainder of a tick
+ * is carried to the next update rather than lost when it is called
+ * between ticks (tickless enter and exit).
+ */
 static void cpu_time_update(struct cpu_s *cpu)
 {
 	uint64_t cycles;
@@ -165,6 +174,7 @@ static void cpu_time_update(struct cpu_s *cpu)
 #if CONFIG_CPU_64BITS
 	cycles   = cpu_get_cycles(cpu);
 	ticks_nr = (cycles - cpu->time.cycles) / cpu->time.ticks_period;
+	cycles   = cpu->time.cycles + (uint64_t)ticks_nr * cpu->time.ticks_period;
 #else
 	register uint_t tm_now;
 	register uint_t elapsed;
@@ -182,9 +192,10 @@ static void cpu_time_update(struct cpu_s *cpu)
 	else
 		elapsed = tm_now - tm_stmp;
     
-	cycles  += elapsed;
 	ticks_nr = elapsed / cpu->time.ticks_period;
-	cpu->time.tmstmp = tm_now;
+	elapsed  = ticks_nr * cpu->time.ticks_period;
+	cycles  += elapsed;
+	cpu->time.tmstmp = tm_stmp + elapsed;
 #endif
 
 	cpu->time.cycles    = cycles;
@@ -202,15 +213,103 @@ void cpu_time_reset(struct cpu_s *cpu)
 	cpu_wbflush();
 }
 
+void cpu_tickless_enter(struct cpu_s *cpu)
+{
+#if CONFIG_CPU_TICKLESS_IDLE
+	register uint_t ticks;
+	uint_t deadline;
+
+	/* Cluster's BSCPU keeps the periodic tick to drive DQDT updates */
+	if((cpu->tickless) || (cpu == cpu->cluster->local_bscpu))
+		return;
+
+	cpu_time_update(cpu);
+	ticks = cpu_get_ticks(cpu);
+
+	if(alarm_next_deadline(&cpu->alarm_mgr, &deadline))
+		deadline = ticks + CONFIG_CPU_TICKLESS_MAX_TICKS;
+
+	if((sint_t)(deadline - ticks) <= 1)
+		return;
+
+	if((deadline - ticks) > CONFIG_CPU_TICKLESS_MAX_TICKS)
+		deadline = ticks + CONFIG_CPU_TICKLESS_MAX_TICKS;
+
+	cpu->tickless       = true;
+	cpu->tickless_start = ticks;
+	cpu->tickless_nr ++;
+
+	arch_cpu_set_tick(cpu, deadline - ticks);
+#endif
+}
+
+void cpu_tickless_exit(struct cpu_s *cpu)
+{
+#if CONFIG_CPU_TICKLESS_IDLE
+	register uint_t elapsed;
+
+	if(cpu->tickless == false)
+		return;
+
+	cpu_time_update(cpu);
+	arch_cpu_set_tick(cpu, 0);
+
+	/* Ticks skipped while stopped have been spent by the idle thread */
+	elapsed = cpu_get_ticks(cpu) - cpu->tickless_start;
+	cpu_get_thread_idle(cpu)->ticks_nr += (elapsed > 0) ? elapsed - 1 : 0;
+	cpu->tickless = false;
+	cpu_wbflush();
+#endif
+}
+
+/* 
+ * Bound the time a pending RPC waits for its handler: past 
+ * CONFIG_RPC_LATENCY_TICKS a manager is woken up and the current 
+ * thread is marked to be rescheduled, the RPC manager being a 
+ * service thread it is elected at the next preemption point.
+ */
+static void cpu_rpc_latency_check(struct cpu_s *cpu)
+{
+	struct thread_s *this;
+
+	if(!(rpc_check()))
+	{
+		cpu->rpc_wait_ticks = 0;
+		return;
+	}
+
+	cpu->rpc_wait_ticks ++;
+
+	if(cpu->rpc_wait_ticks > cpu->rpc_wait_max)
+		cpu->rpc_wait_max = cpu->rpc_wait_ticks;
+
+	if(cpu->rpc_wait_ticks < CONFIG_RPC_LATENCY_TICKS)
+		return;
+
+	this = current_thread;
+
+	if(thread_isService(this))
+		return;
+
+	cpu->rpc_overrun_nr ++;
+	cpu->rpc_wait_ticks = 0;
+
+	(void)wakeup_one(cpu->rpc_wq, WAIT_ANY);
+	thread_set_forced_yield(this);
+	thread_sched_activate(this);
+}
+
 void cpu_clock(struct cpu_s *cpu)
 {
 	register uint_t ticks;
 
+	cpu_tickless_exit(cpu);
 	cpu_time_update(cpu);
 
 	ticks = cpu_get_ticks(cpu);
 	alarm_clock(&cpu->alarm_mgr, ticks);
 	sched_clock(current_thread, ticks);
+	cpu_rpc_latency_check(cpu);
 	
 	if(((ticks % CONFIG_DQDT_MGR_PERIOD) == 0) && 
 			(cpu == cpu->cluster->local_bscpu))
@@ -366,6 +465,7 @@ static error_t cpu_sysfs_read_op(sysfs_entry_t *entry, sysfs_request_t *rq, uint
 	register uint_t th_nr;
 	register uint_t u_runnable;
 	register uint_t k_runnable;
+	register uint_t *class_ticks;
 
 	if(*offset != 0)
 	{
@@ -378,20 +478,30 @@ static error_t cpu_sysfs_read_op(sysfs_entry_t *entry, sysfs_request_t *rq, uint
 	u_runnable = cpu->scheduler.u_runnable;
 	k_runnable = cpu->scheduler.k_runnable;
 	th_nr      = cpu->scheduler.total_nr;
+	class_ticks = &cpu->scheduler.class_ticks[0];
   
 	sprintk((char*)rq->buffer, 
-		"%s\n\tUsage %d %%\n\tTimer-IRQs %d\n\tDev-IRQs %d\n"
-		"\tScheduler\n\t\tRunnable %d [k:%d u:%d]\n\t\tTotal %d [k:%d u:%d]\n",
+		"%s\n\tUsage %d %%\n\tTimer-IRQs %d\n\tTickless %d\n\tDev-IRQs %d\n"
+		"\tScheduler\n\t\tRunnable %d [k:%d u:%d]\n\t\tTotal %d [k:%d u:%d]\n"
+		"\t\tRuntime [s:%d k:%d u:%d i:%d]\n"
+		"\tRPC\n\t\tWait-Max %d\n\t\tOverruns %d\n",
 		cpu->name,
 		(cpu->usage >= 100) ? 100 : cpu->usage,
 		cpu_get_ticks(cpu),
+		cpu->tickless_nr,
 		cpu->irq_nr,
 		u_runnable + k_runnable,
 		k_runnable,
 		u_runnable,
 		th_nr,
 		cpu->scheduler.total_nr - cpu->scheduler.user_nr,
-		cpu->scheduler.user_nr);
+		cpu->scheduler.user_nr,
+		class_ticks[SCHED_CLASS_SERVICE],
+		class_ticks[SCHED_CLASS_KERNEL],
+		class_ticks[SCHED_CLASS_USER],
+		class_ticks[SCHED_CLASS_IDLE],
+		cpu->rpc_wait_max,
+		cpu->rpc_overrun_nr);
   
 	rq->count = strlen((const char*)rq->buffer);
 	*offset   = 0;
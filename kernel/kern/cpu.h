@@ -80,6 +80,11 @@ struct cpu_s
 	/* Time-Driven alarms manager */
 	struct alarm_s alarm_mgr;
 
+	/* Dynamic tick, periodic tick is stopped while idle */
+	uint_t tickless;
+	uint_t tickless_start;
+	uint_t tickless_nr;
+
 	/* Events Listners */
 	struct event_listner_s le_listner;
 	struct rpc_listner_s re_listner;
@@ -91,6 +96,9 @@ struct cpu_s
 	struct thread_s *rpc_mgr;
 	struct wait_queue_s *rpc_wq;
 	uint_t rpc_working_thread;	//synchro. by disabling interrupt
+	uint_t rpc_wait_ticks;		/* ticks a pending RPC has been left unhandled */
+	uint_t rpc_wait_max;
+	uint_t rpc_overrun_nr;		/* bound reached, handler forced in */
 
 	/* Scheduler */
 	struct scheduler_s scheduler;
@@ -128,6 +136,15 @@ void cpu_time_reset(struct cpu_s *cpu);
 
 /** Hardware events */
 void cpu_clock(struct cpu_s *cpu);
+
+/** 
+ * Stop the periodic tick of an idle CPU, its timer is programmed
+ * for the next alarm deadline only. Called with interrupts disabled.
+ */
+void cpu_tickless_enter(struct cpu_s *cpu);
+
+/** Resume the periodic tick, called with interrupts disabled */
+void cpu_tickless_exit(struct cpu_s *cpu);
 void cpu_ipi_notify(struct cpu_s *cpu, uint32_t ipi_val);
 
 /** Set CPU idle thread */
@@ -57,9 +57,16 @@ void do_interrupt(struct thread_s *this, uint_t irq_num)
 
 	arch_cpu_get_irq_entry(cpu, irq_num, &action);
 	action->irq_handler(action);
+
+	/* Nothing on our kernel stack is bound to this core past this point, *
+	 * the scheduler makes us stealable once our context is saved.        */
+	if(old_state == S_USR)
+		thread_request_steal(this);
 	   
 	cpu_yield();
 
+	thread_clear_stealable(this);
+
 	if(old_state != S_USR)//and not a kernel thread ?
 		return;
 
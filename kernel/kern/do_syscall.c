@@ -36,6 +36,9 @@
 #include <cond_var.h>
 #include <barrier.h>
 #include <rwlock.h>
+#include <futex.h>
+#include <uring.h>
+#include <poll.h>
 #include <vmm.h>
 #include <signal.h>
 #include <page.h>
@@ -97,7 +100,15 @@ static const sys_func_t sys_call_tbl[__SYS_CALL_SERVICES_NUM] = {
 	sys_rmdir,
 	sys_ftime,
 	sys_chmod,
-	sys_fsync
+	sys_fsync,
+	sys_futex,
+	sys_pread,
+	sys_pwrite,
+	sys_readv,
+	sys_writev,
+	sys_uring,
+	sys_sendfile,
+	sys_poll
 };
 
 reg_t do_syscall (reg_t arg0,
@@ -31,6 +31,7 @@ struct device_s;
 struct vfs_file_s;
 struct vm_region_s;
 struct irq_action_s;
+struct poll_entry_s;
 
 typedef struct dev_params_s
 {
@@ -70,6 +71,7 @@ typedef struct dev_request_s
 
 typedef sint_t (device_params_t)(struct device_s *dev, dev_params_t *params);
 typedef sint_t (device_request_t)(struct device_s *dev, dev_request_t *rq);
+typedef uint_t (device_poll_t)(struct device_s *dev, struct poll_entry_s *entry);
 
 /* Definition of driver operations for a typical device */
 struct dev_op
@@ -83,6 +85,7 @@ struct dev_op
 	device_request_t *munmap;
 	device_params_t  *set_params;
 	device_params_t  *get_params;
+	device_poll_t    *poll;
 };
 
 typedef error_t (device_init_t)(struct device_s *dev);
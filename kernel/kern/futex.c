@@ -0,0 +1,347 @@
+/*
+ * kern/futex.c - Fast user-space synchronization support
+ * 
+ * Copyright (c) 2008,2009,2010,2011,2012 Ghassan Almaless
+ * Copyright (c) 2011,2012 UPMC Sorbonne Universites
+ *
+ * This file is part of ALMOS-kernel.
+ *
+ * ALMOS-kernel is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2.0 of the License.
+ *
+ * ALMOS-kernel is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with ALMOS-kernel; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <types.h>
+#include <errno.h>
+#include <list.h>
+#include <spinlock.h>
+#include <thread.h>
+#include <task.h>
+#include <pid.h>
+#include <vmm.h>
+#include <vm_region.h>
+#include <pmm.h>
+#include <ppn.h>
+#include <kmem.h>
+#include <rpc.h>
+#include <scheduler.h>
+#include <kdmsg.h>
+#include <futex.h>
+
+/* 
+ * Every key has a home cluster, the cluster of its task pid or of its
+ * physical page, and its waiters are queued in the hash table of that
+ * cluster only: the waiters and wakers of a futex meet there wherever
+ * they run.  The table is reached by RPC, the local function being
+ * called directly when the caller already runs on the home cluster.
+ *
+ * A waiter is allocated in its home cluster and records the sleeping
+ * thread and its cluster, the waker unlinks it and pushes the thread
+ * on the wake list of its CPU with sched_wakeup_push.
+ */
+struct futex_waiter_s
+{
+	struct futex_key_s key;
+	struct thread_s *thread;
+	cid_t cid;
+	struct list_entry list;
+};
+
+static struct futex_bucket_s futex_tbl[FUTEX_BUCKETS_NR];
+
+void futex_manager_init(void)
+{
+	register uint_t i;
+
+	for(i = 0; i < FUTEX_BUCKETS_NR; i++)
+	{
+		spinlock_init(&futex_tbl[i].lock, "Futex");
+		list_root_init(&futex_tbl[i].root);
+	}
+}
+
+static inline cid_t futex_home(struct futex_key_s *key)
+{
+	return (key->type == FUTEX_KEY_SHARED) ? ppn_ppn2cid(key->id) : PID_GET_CLUSTER(key->id);
+}
+
+static inline struct futex_bucket_s* futex_bucket(struct futex_key_s *key)
+{
+	return &futex_tbl[((key->id << 4) ^ (key->offset >> 2)) % FUTEX_BUCKETS_NR];
+}
+
+static inline bool_t futex_key_equal(struct futex_key_s *k1, struct futex_key_s *k2)
+{
+	return ((k1->type == k2->type) && (k1->id == k2->id) && (k1->offset == k2->offset));
+}
+
+/* Read the user word, no lock is held here as it may fault */
+static error_t futex_get_key(uint_t *uaddr, struct futex_key_s *key, uint_t *val)
+{
+	struct vm_region_s *region;
+	struct task_s *task;
+	bool_t shared;
+	error_t err;
+
+	task = current_task;
+
+	if(((uint_t)uaddr & (sizeof(uint_t) - 1)) != 0)
+		return EINVAL;
+
+	if((err = vmm_check_address("usr futex", task, uaddr, sizeof(uint_t))))
+		return err;
+
+	/* Fault the page in before looking for its physical frame */
+	if((err = cpu_copy_from_uspace(val, uaddr, sizeof(uint_t))))
+		return err;
+
+	rwlock_rdlock(&task->vmm.rwlock);
+	region = vm_region_find(&task->vmm, (uint_t)uaddr);
+	shared = ((region != NULL) && (region->vm_flags & VM_REG_SHARED));
+	rwlock_unlock(&task->vmm.rwlock);
+
+	if(!shared)
+	{
+		key->type   = FUTEX_KEY_PRIVATE;
+		key->id     = task->pid;
+		key->offset = (uint_t)uaddr;
+		return 0;
+	}
+
+	key->type   = FUTEX_KEY_SHARED;
+	key->id     = task_vaddr2ppn(task, uaddr);
+	key->offset = (uint_t)uaddr & PMM_PAGE_MASK;
+
+	return (key->id == 0) ? EFAULT : 0;
+}
+
+RPC_DECLARE(__futex_enqueue,
+	    RPC_RET(RPC_RET_PTR(error_t, err)),
+	    RPC_ARG(RPC_ARG_VAL(struct futex_key_s, key),
+		    RPC_ARG_VAL(uint_t, thread),
+		    RPC_ARG_VAL(cid_t, cid)))
+{
+	struct futex_waiter_s *waiter;
+	struct futex_bucket_s *bucket;
+	kmem_req_t req;
+
+	req.type  = KMEM_GENERIC;
+	req.size  = sizeof(*waiter);
+	req.flags = AF_KERNEL;
+
+	if((waiter = kmem_alloc(&req)) == NULL)
+	{
+		*err = ENOMEM;
+		return;
+	}
+
+	waiter->key    = key;
+	waiter->thread = (struct thread_s*)thread;
+	waiter->cid    = cid;
+	bucket         = futex_bucket(&key);
+
+	spinlock_lock(&bucket->lock);
+	list_add_last(&bucket->root, &waiter->list);
+	spinlock_unlock(&bucket->lock);
+
+	*err = 0;
+}
+
+/* found is cleared when a waker has already unlinked the waiter */
+RPC_DECLARE(__futex_dequeue,
+	    RPC_RET(RPC_RET_PTR(uint_t, found)),
+	    RPC_ARG(RPC_ARG_VAL(struct futex_key_s, key),
+		    RPC_ARG_VAL(uint_t, thread)))
+{
+	struct futex_waiter_s *waiter;
+	struct futex_bucket_s *bucket;
+	struct list_entry *iter;
+	kmem_req_t req;
+
+	bucket = futex_bucket(&key);
+	waiter = NULL;
+
+	spinlock_lock(&bucket->lock);
+
+	list_foreach(&bucket->root, iter)
+	{
+		waiter = list_element(iter, struct futex_waiter_s, list);
+
+		if(((uint_t)waiter->thread == thread) && futex_key_equal(&waiter->key, &key))
+			break;
+
+		waiter = NULL;
+	}
+
+	if(waiter != NULL)
+		list_unlink(&waiter->list);
+
+	spinlock_unlock(&bucket->lock);
+
+	*found = (waiter != NULL);
+
+	if(waiter == NULL)
+		return;
+
+	req.type = KMEM_GENERIC;
+	req.ptr  = waiter;
+	kmem_free(&req);
+}
+
+RPC_DECLARE(__futex_wake,
+	    RPC_RET(RPC_RET_PTR(uint_t, woken)),
+	    RPC_ARG(RPC_ARG_VAL(struct futex_key_s, key),
+		    RPC_ARG_VAL(uint_t, count)))
+{
+	struct futex_waiter_s *waiter;
+	struct futex_bucket_s *bucket;
+	struct list_entry *iter;
+	struct list_entry root;
+	kmem_req_t req;
+	uint_t nr;
+
+	bucket = futex_bucket(&key);
+	nr     = 0;
+
+	list_root_init(&root);
+
+	spinlock_lock(&bucket->lock);
+
+	list_foreach(&bucket->root, iter)
+	{
+		if(nr == count)
+			break;
+
+		waiter = list_element(iter, struct futex_waiter_s, list);
+
+		if(!futex_key_equal(&waiter->key, &key))
+			continue;
+
+		list_unlink(&waiter->list);
+		list_add_last(&root, &waiter->list);
+		nr ++;
+	}
+
+	spinlock_unlock(&bucket->lock);
+
+	req.type = KMEM_GENERIC;
+
+	while(!list_empty(&root))
+	{
+		waiter = list_first(&root, struct futex_waiter_s, list);
+		list_unlink(&waiter->list);
+		sched_wakeup_push(waiter->thread, waiter->cid);
+		req.ptr = waiter;
+		kmem_free(&req);
+	}
+
+	*woken = nr;
+}
+
+/* 
+ * The waiter is queued first and the user word read again afterward,
+ * with no lock held: a waker that changes the word after this read
+ * finds the waiter queued, and one that changed it before is seen by
+ * the read, in which case the waiter dequeues itself.
+ */
+error_t futex_wait(uint_t *uaddr, uint_t val)
+{
+	struct futex_key_s key;
+	struct thread_s *this;
+	uint_t current;
+	uint_t thread;
+	uint_t found;
+	cid_t home;
+	cid_t cid;
+	error_t err;
+
+	if((err = futex_get_key(uaddr, &key, &current)))
+		return err;
+
+	if(current != val)
+		return EAGAIN;
+
+	this   = current_thread;
+	thread = (uint_t)this;
+	home   = futex_home(&key);
+	cid    = current_cid;
+
+	RCPC(home, RPC_PRIO_FUTEX, __futex_enqueue,
+	     RPC_RECV(RPC_RECV_OBJ(err)),
+	     RPC_SEND(RPC_SEND_OBJ(key), RPC_SEND_OBJ(thread), RPC_SEND_OBJ(cid)));
+
+	if(err)
+		return err;
+
+	if((err = cpu_copy_from_uspace(&current, uaddr, sizeof(uint_t))) || (current != val))
+	{
+		RCPC(home, RPC_PRIO_FUTEX, __futex_dequeue,
+		     RPC_RECV(RPC_RECV_OBJ(found)),
+		     RPC_SEND(RPC_SEND_OBJ(key), RPC_SEND_OBJ(thread)));
+
+		/* Too late, consume the wakeup pushed by the waker */
+		if(!found)
+			sched_sleep_check(this);
+
+		return (err) ? err : EAGAIN;
+	}
+
+	sched_sleep_check(this);
+	return 0;
+}
+
+error_t futex_wake(uint_t *uaddr, uint_t count, uint_t *woken)
+{
+	struct futex_key_s key;
+	uint_t current;
+	uint_t nr;
+	error_t err;
+
+	if((err = futex_get_key(uaddr, &key, &current)))
+		return err;
+
+	nr = 0;
+
+	RCPC(futex_home(&key), RPC_PRIO_FUTEX, __futex_wake,
+	     RPC_RECV(RPC_RECV_OBJ(nr)),
+	     RPC_SEND(RPC_SEND_OBJ(key), RPC_SEND_OBJ(count)));
+
+	*woken = nr;
+	return 0;
+}
+
+int sys_futex(uint_t *uaddr, uint_t operation, uint_t val, uint_t count)
+{
+	uint_t woken;
+	error_t err;
+
+	switch(operation)
+	{
+	case FUTEX_WAIT:
+		if((err = futex_wait(uaddr, val)))
+			break;
+
+		return 0;
+
+	case FUTEX_WAKE:
+		if((err = futex_wake(uaddr, count, &woken)))
+			break;
+
+		return (int)woken;
+
+	default:
+		err = EINVAL;
+	}
+
+	current_thread->info.errno = err;
+	return -1;
+}
@@ -0,0 +1,74 @@
+/*
+ * kern/futex.h - Fast user-space synchronization support
+ * 
+ * Copyright (c) 2008,2009,2010,2011,2012 Ghassan Almaless
+ * Copyright (c) 2011,2012 UPMC Sorbonne Universites
+ *
+ * This file is part of ALMOS-kernel.
+ *
+ * ALMOS-kernel is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2.0 of the License.
+ *
+ * ALMOS-kernel is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with ALMOS-kernel; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef _FUTEX_H_
+#define _FUTEX_H_
+
+#include <types.h>
+#include <list.h>
+#include <spinlock.h>
+
+typedef enum
+{
+	FUTEX_WAIT,
+	FUTEX_WAKE
+} futex_operation_t;
+
+#define FUTEX_BUCKETS_NR  CONFIG_FUTEX_BUCKETS_NR
+
+#define FUTEX_KEY_PRIVATE 0
+#define FUTEX_KEY_SHARED  1
+
+/* 
+ * A futex of a private mapping is identified by its task pid and user
+ * address, which survive the migration of the page holding the word.
+ * A futex of a shared mapping is identified by its physical page, so
+ * that the tasks sharing it meet on the same key.
+ */
+struct futex_key_s
+{
+	uint_t type;
+	uint_t id;		/* pid or ppn */
+	uint_t offset;		/* user address or offset in the page */
+};
+
+struct futex_bucket_s
+{
+	spinlock_t lock;
+	struct list_entry root;
+};
+
+/** Init the futex buckets of the local cluster, home of some of the keys */
+void futex_manager_init(void);
+
+/** 
+ * Put the calling thread into passive wait on the user word uaddr, 
+ * unless it no longer holds val in which case EAGAIN is returned 
+ */
+error_t futex_wait(uint_t *uaddr, uint_t val);
+
+/** Wakeup at most count threads waiting on the user word uaddr, return their number */
+error_t futex_wake(uint_t *uaddr, uint_t count, uint_t *woken);
+
+int sys_futex(uint_t *uaddr, uint_t operation, uint_t val, uint_t count);
+
+#endif	/* _FUTEX_H_ */
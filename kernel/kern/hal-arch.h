@@ -73,6 +73,9 @@ error_t arch_cpu_set_irq_entry(struct cpu_s *cpu, int irq_nr, struct irq_action_
 error_t arch_cpu_get_irq_entry(struct cpu_s *cpu, int irq_nr, struct irq_action_s **action);
 error_t arch_cpu_send_ipi(gid_t dest, uint32_t val);
 
+/* Program the CPU timer to fire once after ticks_nr ticks, 0 restores the periodic tick */
+error_t arch_cpu_set_tick(struct cpu_s *cpu, uint_t ticks_nr);
+
 /* Specific architecture-dependent DQDT macros & functions */
 #define DQDT_DIST_NOTSET     0	/* must be zero (c.f: see dqdt_attr_init in kern/dqdt.h) */
 #define DQDT_DIST_DEFAULT    1
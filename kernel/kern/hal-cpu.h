@@ -111,6 +111,7 @@ static inline uint_t cpu_set_stack(void* new_val);
 extern error_t cpu_copy_from_uspace(void *dst, void *src, uint_t count);//src is in uspace
 extern error_t cpu_copy_to_uspace(void *dst, void *src, uint_t count);//dest is in uspace
 extern error_t cpu_uspace_strlen(char *str, uint_t *len);//FIXME: rename as cpu_strlen_uspace
+extern error_t cpu_uspace_cas(void *ptr, uint_t old, uint_t new, bool_t *isAtomic);//ptr is in uspace
 
 /* IRQ register/enable/disable/restore */
 
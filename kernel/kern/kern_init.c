@@ -44,6 +44,7 @@
 #include <boot-info.h>
 #include <dqdt.h>
 #include <pid.h>
+#include <futex.h>
 
 #define BOOT_SIGNAL  0xA5A5B5B5
 #define die(args...) do {boot_dmsg(args); while(1);} while(0)
@@ -115,6 +116,7 @@ void kern_init (boot_info_t *info)
                 task_manager_init_finalize();
 		vfs_init();
 		sysconf_init();
+		futex_manager_init();
 
 		dqdt_init(info); 
 
@@ -63,6 +63,7 @@
 #define CONFIG_KERNEL_REPLICATE          yes
 #define CONFIG_USE_COA                   yes
 #define CONFIG_MAPPER_AUTO_MGRT          yes
+#define CONFIG_THREAD_STACK_MGRT         yes
 #define CONFIG_EXEC_LOCAL                no
 #define CONFIG_USE_SCHED_LOCKS           yes
 #define CONFIG_THREAD_LOCAL_ALLOC        yes
@@ -83,18 +84,26 @@
 #define CONFIG_DQDT_WAIT_FOR_UPDATE      no
 #define CONFIG_CPU_BALANCING_PERIOD      4
 #define CONFIG_CPU_LOAD_PERIOD           4
+#define CONFIG_CPU_TICKLESS_IDLE         yes
+#define CONFIG_CPU_TICKLESS_MAX_TICKS    1000
 #define CONFIG_CLUSTER_KEYS_NR           8
 #define CONFIG_REL_KFIFO_SIZE            32
 #define CONFIG_VFS_NODES_PER_CLUSTER     128
+#define CONFIG_PIPE_PAGES_NR             16
 #define CONFIG_SCHED_THREADS_NR          32
 #define CONFIG_BARRIER_WQDB_NR           4
 #define CONFIG_BARRIER_ACTIVE_WAIT       no
 #define CONFIG_BARRIER_BORADCAST_UREAD   no
 #define CONFIG_CPU_LOAD_BALANCING        no //yes, FIXME(40): manipulate dqdt
+#define CONFIG_SCHED_WORK_STEALING       yes
+#define CONFIG_SCHED_SERVICE_CLASS       yes
 #define CONFIG_PTHREAD_THREADS_MAX       2048
 #define CONFIG_PTHREAD_STACK_SIZE        512*1024
 #define CONFIG_PTHREAD_STACK_MIN         4096
 #define CONFIG_RPC_FIFO_SLOT_NR		 128
+#define CONFIG_RPC_THREAD_SLEEP          yes    /* Sleep on the wake list while waiting an RPC response */
+#define CONFIG_RPC_LATENCY_TICKS         2
+#define CONFIG_FUTEX_BUCKETS_NR          64
 #define CONFIG_ENV_MAX_SIZE              128
 
 ////////////////////////////////////////////////////
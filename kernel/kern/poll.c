@@ -0,0 +1,318 @@
+/*
+ * kern/poll.c - Readiness notification of files and devices
+ * 
+ * Copyright (c) 2008,2009,2010,2011,2012 Ghassan Almaless
+ * Copyright (c) 2011,2012 UPMC Sorbonne Universites
+ *
+ * This file is part of ALMOS-kernel.
+ *
+ * ALMOS-kernel is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2.0 of the License.
+ *
+ * ALMOS-kernel is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with ALMOS-kernel; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <types.h>
+#include <errno.h>
+#include <list.h>
+#include <spinlock.h>
+#include <wait_queue.h>
+#include <thread.h>
+#include <task.h>
+#include <scheduler.h>
+#include <event.h>
+#include <time.h>
+#include <kmem.h>
+#include <rpc.h>
+#include <distlock.h>
+#include <remote_access.h>
+#include <vfs.h>
+#include <poll.h>
+
+void poll_register(struct poll_queue_s *queue, spinlock_t *lock, struct poll_entry_s *entry)
+{
+	entry->lock  = lock;
+	entry->proxy = NULL;
+	entry->cid   = current_cid;
+	list_add_last(&queue->root, &entry->list);
+}
+
+struct poll_entry_s* poll_proxy_create(struct poll_entry_s *entry)
+{
+	struct poll_entry_s *proxy;
+	kmem_req_t req;
+
+	req.type  = KMEM_GENERIC;
+	req.size  = sizeof(*proxy);
+	req.flags = AF_KERNEL;
+
+	if((proxy = kmem_alloc(&req)) == NULL)
+		return NULL;
+
+	proxy->table     = entry->table;
+	proxy->table_cid = entry->table_cid;
+	proxy->events    = entry->events;
+	proxy->lock      = NULL;
+	proxy->proxy     = NULL;
+	return proxy;
+}
+
+static void poll_unlink(struct poll_entry_s *entry)
+{
+	uint_t irq_state;
+
+	spinlock_lock_noirq(entry->lock, &irq_state);
+	list_unlink(&entry->list);
+	spinlock_unlock_noirq(entry->lock, irq_state);
+
+	entry->lock = NULL;
+}
+
+RPC_DECLARE(__poll_unregister,
+		RPC_RET(RPC_RET_PTR(error_t, err)),
+		RPC_ARG(RPC_ARG_VAL(struct poll_entry_s*, proxy)))
+{
+	kmem_req_t req;
+
+	if(proxy->lock != NULL)
+		poll_unlink(proxy);
+
+	req.type = KMEM_GENERIC;
+	req.ptr  = proxy;
+	kmem_free(&req);
+
+	*err = 0;
+}
+
+void poll_unregister(struct poll_entry_s *entry)
+{
+	error_t err;
+
+	if(entry->proxy != NULL)
+	{
+		RCPC(entry->cid, RPC_PRIO_POLL, __poll_unregister,
+		     RPC_RECV(RPC_RECV_OBJ(err)),
+		     RPC_SEND(RPC_SEND_OBJ(entry->proxy)));
+
+		entry->proxy = NULL;
+		return;
+	}
+
+	if(entry->lock != NULL)
+		poll_unlink(entry);
+}
+
+/* Raise flag in a table of cluster cid and push its sleeper, if any.
+ * The sleeper is only pushed once, by whoever takes it off the table. */
+static void poll_table_wakeup(struct poll_table_s *table, cid_t cid, uint_t *flag)
+{
+	struct thread_s *sleeper;
+	uint_t irq_state;
+
+	cpu_disable_all_irq(&irq_state);
+	remote_spinlock_lock(&table->lock, cid);
+
+	remote_sw(flag, cid, true);
+	sleeper = (struct thread_s*)remote_lw(&table->sleeper, cid);
+
+	if(sleeper != NULL)
+	{
+		remote_sw(&table->sleeper, cid, 0);
+		sched_wakeup_push(sleeper, cid);
+	}
+
+	remote_spinlock_unlock(&table->lock, cid);
+	cpu_restore_irq(irq_state);
+}
+
+void poll_notify(struct poll_queue_s *queue, uint_t events)
+{
+	struct list_entry *iter;
+	struct poll_entry_s *entry;
+
+	list_foreach(&queue->root, iter)
+	{
+		entry = list_element(iter, struct poll_entry_s, list);
+
+		if(!(entry->events & events))
+			continue;
+
+		poll_table_wakeup(entry->table, entry->table_cid, &entry->table->isTriggered);
+	}
+}
+
+static EVENT_HANDLER(poll_alarm_event_handler)
+{
+	struct poll_table_s *table;
+
+	table = event_get_argument(event);
+	poll_table_wakeup(table, table->cid, &table->isTimedout);
+	return 0;
+}
+
+/* Check the level of each polled file, registering the entries on the
+ * first pass so that no edge is missed between the check and the sleep */
+static uint_t poll_scan(struct sys_pollfd_s *fds, 
+			struct poll_entry_s *entries, 
+			uint_t nfds, 
+			bool_t isFirst)
+{
+	struct vfs_file_s *file;
+	struct task_s *task;
+	uint_t count;
+	uint_t i;
+
+	task = current_task;
+
+	for(count = 0, i = 0; i < nfds; i++)
+	{
+		fds[i].revents = 0;
+
+		if(fds[i].fd < 0)
+			continue;
+
+		file = NULL;
+
+		if((fds[i].fd >= CONFIG_TASK_FILE_MAX_NR) || (task_fd_lookup(task, fds[i].fd, &file)))
+			fds[i].revents = POLLNVAL;
+		else
+			fds[i].revents = vfs_poll(file, (isFirst) ? &entries[i] : NULL) & entries[i].events;
+
+		if(fds[i].revents)
+			count ++;
+	}
+
+	return count;
+}
+
+int sys_poll(struct sys_pollfd_s *fds, uint_t nfds, sint_t timeout)
+{
+	struct sys_pollfd_s *kfds;
+	struct poll_entry_s *entries;
+	struct poll_table_s table;
+	struct thread_s *this;
+	struct event_s *event;
+	kmem_req_t req;
+	uint_t irq_state;
+	uint_t count;
+	uint_t i;
+	bool_t isArmed;
+	bool_t isFirst;
+	error_t err;
+
+	this = current_thread;
+
+	if(nfds > CONFIG_TASK_FILE_MAX_NR)
+	{
+		this->info.errno = EINVAL;
+		return -1;
+	}
+
+	req.type  = KMEM_GENERIC;
+	req.size  = (nfds) ? nfds * (sizeof(*kfds) + sizeof(*entries)) : sizeof(*kfds);
+	req.flags = AF_KERNEL;
+
+	if((kfds = kmem_alloc(&req)) == NULL)
+	{
+		this->info.errno = ENOMEM;
+		return -1;
+	}
+
+	entries = (struct poll_entry_s*)&kfds[nfds];
+
+	if((err = cpu_copy_from_uspace(kfds, fds, nfds * sizeof(*kfds))))
+		goto POLL_END;
+
+	spinlock_init(&table.lock, "Poll Table");
+	table.sleeper     = NULL;
+	table.cid         = current_cid;
+	table.isTriggered = false;
+	table.isTimedout  = false;
+
+	for(i = 0; i < nfds; i++)
+	{
+		entries[i].table     = &table;
+		entries[i].table_cid = table.cid;
+		entries[i].lock      = NULL;
+		entries[i].proxy     = NULL;
+		entries[i].events    = kfds[i].events | POLL_ALWAYS;
+	}
+
+	isArmed = false;
+	isFirst = true;
+
+	while(1)
+	{
+		spinlock_lock_noirq(&table.lock, &irq_state);
+		table.isTriggered = false;
+		table.sleeper     = NULL;
+		spinlock_unlock_noirq(&table.lock, irq_state);
+
+		count   = poll_scan(kfds, entries, nfds, isFirst);
+		isFirst = false;
+
+		if((count != 0) || (timeout == 0) || (table.isTimedout))
+			break;
+
+		if((timeout > 0) && (isArmed == false))
+		{
+			event = &this->info.alarm_event;
+			event_set_handler(event, &poll_alarm_event_handler);
+			event_set_priority(event, E_FUNC);
+			event_set_argument(event, &table);
+			this->info.alarm.event = event;
+			alarm_wait(&this->info.alarm, timeout);
+			isArmed = true;
+		}
+
+		spinlock_lock_noirq(&table.lock, &irq_state);
+
+		if(table.isTriggered || table.isTimedout)
+		{
+			spinlock_unlock_noirq(&table.lock, irq_state);
+			continue;
+		}
+
+		/* Whoever takes the sleeper off the table pushes it */
+		table.sleeper = this;
+		spinlock_unlock_noirq(&table.lock, irq_state);
+		sched_sleep_check(this);
+	}
+
+	/* The table lives on this stack: an expired alarm must have been
+	 * handled before leaving (this may have migrated meanwhile), up to
+	 * the release of the table lock that follows the flag */
+	if((isArmed) && (alarm_cancel(&current_thread->info.alarm) == ENOENT))
+	{
+		while(!(table.isTimedout))
+			sched_yield(current_thread);
+
+		spinlock_lock_noirq(&table.lock, &irq_state);
+		spinlock_unlock_noirq(&table.lock, irq_state);
+	}
+
+	for(i = 0; i < nfds; i++)
+		poll_unregister(&entries[i]);
+
+	err = cpu_copy_to_uspace(fds, kfds, nfds * sizeof(*kfds));
+
+POLL_END:
+	req.ptr = kfds;
+	kmem_free(&req);
+
+	if(err)
+	{
+		current_thread->info.errno = err;
+		return -1;
+	}
+
+	return count;
+}
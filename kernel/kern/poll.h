@@ -0,0 +1,130 @@
+/*
+ * kern/poll.h - Readiness notification of files and devices
+ * 
+ * Copyright (c) 2008,2009,2010,2011,2012 Ghassan Almaless
+ * Copyright (c) 2011,2012,2013,2014,2015 UPMC Sorbonne Universites
+ *
+ * This file is part of ALMOS-kernel.
+ *
+ * ALMOS-kernel is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2.0 of the License.
+ *
+ * ALMOS-kernel is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with ALMOS-kernel; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef _POLL_H_
+#define _POLL_H_
+
+#include <types.h>
+#include <list.h>
+#include <spinlock.h>
+
+/** Readiness events */
+#define POLLIN         0x001
+#define POLLPRI        0x002
+#define POLLOUT        0x004
+#define POLLERR        0x008
+#define POLLHUP        0x010
+#define POLLNVAL       0x020
+
+/** Events always reported, whether asked for or not */
+#define POLL_ALWAYS    (POLLERR | POLLHUP | POLLNVAL)
+
+/* 
+ * A pollable object (pipe, device) owns a poll queue protected by its
+ * own lock.  A polling thread links one entry per polled object to the
+ * object's queue, then sleeps on its poll table.  The object notifies
+ * its queue on each edge (empty to ready), waking up every table whose
+ * entry is interested in the event; the woken thread then checks the
+ * level of each object again.
+ *
+ * The table may live on another cluster than the object: notifiers
+ * reach it by remote accesses and push its sleeper on its cpu.  An
+ * object polled from another cluster is handled on its own cluster,
+ * where a proxy of the poller's entry is linked to its queue.
+ */
+
+struct thread_s;
+
+struct poll_table_s
+{
+	spinlock_t lock;
+	struct thread_s *sleeper;
+	cid_t cid;
+	uint_t isTriggered;
+	uint_t isTimedout;
+};
+
+struct poll_entry_s
+{
+	struct list_entry list;
+	struct poll_table_s *table;
+	cid_t table_cid;
+	spinlock_t *lock;
+	struct poll_entry_s *proxy;	/* linked on cluster cid instead */
+	cid_t cid;
+	uint_t events;
+};
+
+struct poll_queue_s
+{
+	struct list_entry root;
+};
+
+static inline void poll_queue_init(struct poll_queue_s *queue)
+{
+	list_root_init(&queue->root);
+}
+
+static inline void poll_queue_destroy(struct poll_queue_s *queue)
+{
+	assert(list_empty(&queue->root) && "Poll Queue is not empty");
+}
+
+/** 
+ * Link entry to the queue of an object, lock being the object's lock
+ * Caution: lock must be held by the caller 
+ */
+void poll_register(struct poll_queue_s *queue, spinlock_t *lock, struct poll_entry_s *entry);
+
+/** Unlink entry from its object queue, if it has been registered */
+void poll_unregister(struct poll_entry_s *entry);
+
+/** 
+ * Copy entry on the current cluster, the object's one, to be given to
+ * poll_register in its place; NULL if out of memory 
+ */
+struct poll_entry_s* poll_proxy_create(struct poll_entry_s *entry);
+
+/** Record in entry, on the poller's cluster, the proxy linked on cid */
+static inline void poll_proxy_set(struct poll_entry_s *entry, struct poll_entry_s *proxy, cid_t cid)
+{
+	entry->proxy = proxy;
+	entry->cid   = cid;
+}
+
+/** 
+ * Wakeup the tables of all entries interested in events 
+ * Caution: the object's lock must be held by the caller 
+ */
+void poll_notify(struct poll_queue_s *queue, uint_t events);
+
+/** System call */
+struct sys_pollfd_s
+{
+	sint_t fd;
+	uint16_t events;
+	uint16_t revents;
+};
+
+int sys_poll(struct sys_pollfd_s *fds, uint_t nfds, sint_t timeout);
+
+#endif	/* _POLL_H_ */
@@ -97,6 +97,7 @@ error_t rpc_send_sync(gid_t gid,  bool_t to_cid, size_t prio, void* func,
 {
 	struct rpc_listner_s *rl;
 	size_t final_ret_sz;
+	bool_t sleep;
 	uint_t cid = arch_cpu_cid(gid);
 	uint_t lid = arch_cpu_lid(gid);
 	int i;
@@ -117,6 +118,17 @@ error_t rpc_send_sync(gid_t gid,  bool_t to_cid, size_t prio, void* func,
 	rpc->ret_size = ret_size;
 	rpc->ret_rpc = ret_rpc;
 
+#if CONFIG_RPC_THREAD_SLEEP
+	/* Only threads allowed to yield may sleep, the idle and boot threads spin */
+	sleep = (prio < RPC_PRIO_LAZY)             && 
+		thread_isPreemptable(current_thread) &&
+		(current_thread->type != TH_IDLE)    &&
+		(current_thread->type != TH_BOOT);
+#else
+	sleep = false;
+#endif
+	rpc->sleep = sleep;
+
 	rpc_debug
 	//printk
 	(INFO, "[cpu: %d, thread:%x, tid: %d] Sending rpc \n",\
@@ -127,10 +139,10 @@ error_t rpc_send_sync(gid_t gid,  bool_t to_cid, size_t prio, void* func,
 
 	if(prio < RPC_PRIO_LAZY)
 	{
-#ifdef RPC_THREAD_SLEEP
-		//printk(INFO, "[%d]sleeping thread %p at %d\n",cpu_get_id(), current_thread, cpu_time_stamp()); 
-		sched_sleep_check(current_thread);//potentiel race with wakeup ?
-#endif
+		/* The response buffer is overwritten, rpc->sleep is no longer ours */
+		if(sleep)
+			sched_sleep_check(current_thread);
+
 		while(!rpc->response)
 			rpc_backoff();
 
@@ -211,6 +223,7 @@ error_t rpc_send_rsp(struct rpc_s* sender_rpc, struct rpc_s* rpc, size_t size, u
 	uint_t sender_gid;
 	struct rpc_listner_s *sender_rl;
 	struct rpc_s* ret_rpc;
+	bool_t sleep;
 
 	sender_gid = sender_rpc->gid;
 	sender_cid = arch_cpu_cid(sender_gid);
@@ -224,15 +237,13 @@ error_t rpc_send_rsp(struct rpc_s* sender_rpc, struct rpc_s* rpc, size_t size, u
 	rpc->size = size;
 	rpc->args_nb = nb_ret;
 
-#ifdef RPC_THREAD_SLEEP
-	rpc->response = true;
-#else
 	rpc->response = false;// done later when all the data have been copied
-#endif
+	rpc->sleep = false;
 	rpc->ret_size = 0;//no response expected
 	rpc->ret_rpc = NULL;//no response expected
 
 	ret_rpc = sender_rpc->ret_rpc;
+	sleep = sender_rpc->sleep;
 	assert(size == sender_rpc->ret_size);
 
 	rpc_debug(INFO, "[%d] sending response to RPC: origine %d, func %p\n", 
@@ -245,19 +256,16 @@ error_t rpc_send_rsp(struct rpc_s* sender_rpc, struct rpc_s* rpc, size_t size, u
 	remote_memcpy(ret_rpc, sender_cid, rpc, current_cid, size);
 	cpu_wbflush();
 
-#ifndef RPC_THREAD_SLEEP
 	remote_sw((void*)&ret_rpc->response, sender_cid, true);
-#endif
+	cpu_wbflush();
 
-	if(rpc->prio < RPC_PRIO_LAZY)//otherwise no responses!
+	if(sleep)//the sender is waiting for the response on its wake list
 	//remotly wakeup the wating thread
 	{
-#ifdef RPC_THREAD_SLEEP
 		rpc_debug(INFO, "[%d] RPC response wakening thread %x on cluster %d at %d\n", 
 			cpu_get_id(), rpc->sender, sender_cid, cpu_time_stamp());
 		
-		remote_sw(&rpc->sender->state, sender_cid, S_READY);
-		cpu_wbflush();
+		sched_wakeup_push(rpc->sender, sender_cid);
 		if(!(remote_lw((void*)&sender_rl->pending, sender_cid))) 
 		{
 			if(cpu_in_kernel(sender_cid, sender_lid)) return 0;
@@ -266,7 +274,6 @@ error_t rpc_send_rsp(struct rpc_s* sender_rpc, struct rpc_s* rpc, size_t size, u
 			rpc_debug(INFO, "[%d] sending IPI response to %d ...\n", cpu_get_id(), sender_cid);
 			(void)arch_cpu_send_ipi(sender_gid, (uint32_t)-1);
 		}
-#endif
 	}
 	//no sleeping since no response is expected!
 	
@@ -498,6 +505,7 @@ error_t rpc_thread_create(struct cpu_s *cpu, struct task_s *task)
 	wait_queue_init(&new_thread->info.wait_queue, "RPC Thread");
 
 	new_thread->task   = task;
+	thread_set_service(new_thread);
 
 	if((err = sched_register(new_thread)))
 		return err;
@@ -561,6 +569,9 @@ void rpc_manager_init(struct cpu_s *cpu)
 	kmem_req_t req;
 
 	cpu->rpc_working_thread = 0;
+	cpu->rpc_wait_ticks     = 0;
+	cpu->rpc_wait_max       = 0;
+	cpu->rpc_overrun_nr     = 0;
 
 	req.type  = KMEM_GENERIC;
 	req.flags = AF_KERNEL;
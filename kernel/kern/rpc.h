@@ -51,6 +51,8 @@ typedef enum
 #define RPC_PRIO_PS             RPC_PRIO_NRML
 #define RPC_PRIO_TSK_LOOKUP     RPC_PRIO_NRML
 #define RPC_PRIO_EXEC           RPC_PRIO_NRML
+#define RPC_PRIO_FUTEX          RPC_PRIO_NRML
+#define RPC_PRIO_POLL           RPC_PRIO_NRML
 
 /* RPC FIFO type */
 struct remote_fifo_s;
@@ -72,6 +74,7 @@ struct rpc_s
 	struct thread_s *sender;
 	rpc_handler_t *handler;
 	uint8_t args_nb;
+	uint8_t sleep;//is the sender sleeping until the response ?
 	volatile bool_t response;//is this message a response ?
 };
 
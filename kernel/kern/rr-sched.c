@@ -523,6 +523,7 @@ static const struct sched_ops_s rr_sched_op =
 	.add_created = &rr_add_created,
 	.add         = &rr_add_created,
 	.remove      = &rr_remove,
+	.steal       = NULL,
 
 #if CONFIG_CPU_LOAD_BALANCING
 	.elect       = &rr_elect_balancing,
@@ -50,6 +50,7 @@
 #define SCHED_SCOPE
 
 #define RR_QUANTUM          4	/* in TICs number */
+#define RR_STEAL_THRESHOLD  1	/* queued user threads required on a victim */
 #define SCHED_THREADS_NR    CONFIG_SCHED_THREADS_NR
 
 #if CONFIG_SCHED_DEBUG
@@ -74,6 +75,7 @@ typedef struct rQueues_s
 	uint_t u_runnable;
 	uint_t m_runnable;
 	struct scheduler_s *scheduler;
+	struct list_entry services;
 	struct list_entry kthreads;
 	struct list_entry runnable;
 	struct list_entry migrate;
@@ -321,11 +323,20 @@ SCHED_SCOPE void rr_wakeup (struct thread_s *thread)
 	if(type == KTHREAD)
 	{
 		rQueues->scheduler->k_runnable ++;
-		//list_add_last(&rQueues->kthreads, &thread->list);
-		list_add_first(&rQueues->kthreads, &thread->list);
 		this = current_thread;
-		thread_sched_activate(this);
-		thread_set_forced_yield(this);
+
+		if(thread_isService(thread))
+			list_add_last(&rQueues->services, &thread->list);
+		else
+			//list_add_last(&rQueues->kthreads, &thread->list);
+			list_add_first(&rQueues->kthreads, &thread->list);
+
+		/* A service thread is never preempted by an ordinary kthread */
+		if(thread_isService(thread) || !(thread_isService(this)))
+		{
+			thread_sched_activate(this);
+			thread_set_forced_yield(this);
+		}
 	}
 	else
 	{
@@ -356,8 +367,12 @@ SCHED_SCOPE void rr_add_created(struct thread_s *thread)
 	if(type == KTHREAD)
 	{
 		rQueues->scheduler->k_runnable ++;
-		//list_add_last(&rQueues->kthreads, &thread->list);
-		list_add_first(&rQueues->kthreads, &thread->list);
+
+		if(thread_isService(thread))
+			list_add_last(&rQueues->services, &thread->list);
+		else
+			//list_add_last(&rQueues->kthreads, &thread->list);
+			list_add_first(&rQueues->kthreads, &thread->list);
 	}
 	else
 	{
@@ -379,6 +394,109 @@ SCHED_SCOPE void rr_add_created(struct thread_s *thread)
 	cpu_spinlock_unlock(&rQueues->lock.val);
 }
 
+static inline bool_t rr_isStealable(struct thread_s *thread, struct cpu_s *victim)
+{
+	return ((thread->type == PTHREAD)                &&
+		(thread_isStealable(thread))             &&
+		(thread_migration_isEnabled(thread))     &&
+		!(thread_isExported(thread))             &&
+		!(thread_migration_isActivated(thread))  &&
+		(victim->fpu_owner != thread));
+}
+
+/*
+ * Intra-cluster work stealing, called by an idle CPU with interrupts 
+ * disabled. Sibling runqueues are only trylocked so that a thief never
+ * spins behind a busy core, and the coldest stealable thread (queue tail)
+ * is taken. The stolen thread keeps its state and is simply attached to
+ * the local scheduler, no thread migration is involved.
+ */
+SCHED_SCOPE bool_t rr_steal(struct sched_s *sched)
+{
+	register struct thread_s *thread;
+	register struct thread_s *candidate;
+	register rQueues_t *rQueues;
+	register rQueues_t *vQueues;
+	register struct sched_s *vsched;
+	struct list_entry *iter;
+	struct cluster_s *cluster;
+	struct cpu_s *victim;
+	struct cpu_s *cpu;
+	uint_t i;
+
+	rQueues = (rQueues_t*) sched->data;
+	cpu     = rQueues->cpu;
+	cluster = cpu->cluster;
+	thread  = NULL;
+
+	if(rQueues->scheduler->total_nr >= SCHED_THREADS_NR)
+		return false;
+
+	for(i = 1; (i < cluster->onln_cpu_nr) && (thread == NULL); i++)
+	{
+		victim  = &cluster->cpu_tbl[(cpu->lid + i) % cluster->onln_cpu_nr];
+		vsched  = &victim->scheduler.scheds_tbl[SCHED_RR];
+		vQueues = (rQueues_t*) vsched->data;
+
+		if(vQueues->u_runnable < RR_STEAL_THRESHOLD)
+			continue;
+
+		if(cpu_spinlock_trylock(&vQueues->lock.val))
+			continue;
+
+		list_foreach_backward(&vQueues->runnable, iter)
+		{
+			candidate = list_element(iter, struct thread_s, list);
+
+			if(rr_isStealable(candidate, victim))
+			{
+				thread = candidate;
+				break;
+			}
+		}
+
+		if(thread != NULL)
+		{
+			list_unlink(&thread->list);
+			vsched->count --;
+			vQueues->u_runnable --;
+			vQueues->scheduler->u_runnable --;
+			vQueues->scheduler->user_nr --;
+			vQueues->scheduler->total_nr --;
+			vQueues->scheduler->export_nr ++;
+		}
+
+		cpu_spinlock_unlock(&vQueues->lock.val);
+	}
+
+	if(thread == NULL)
+		return false;
+
+	sched_transfer(thread, cpu);
+
+	cpu_spinlock_lock(&rQueues->lock.val);
+
+	sched->count ++;
+	rQueues->u_runnable ++;
+	rQueues->scheduler->u_runnable ++;
+	rQueues->scheduler->user_nr ++;
+	rQueues->scheduler->total_nr ++;
+	rQueues->scheduler->import_nr ++;
+	list_add_last(&rQueues->runnable, &thread->list);
+
+	cpu_spinlock_unlock(&rQueues->lock.val);
+
+	rr_dmsg(INFO, "%s: cpu %d, stole pid %d, tid %d, state %s [%u]\n",
+		__FUNCTION__,
+		cpu->gid,
+		thread->task->pid,
+		thread->info.order,
+		thread_state_name[thread->state],
+		cpu_time_stamp());
+
+	return true;
+}
+
 SCHED_SCOPE struct thread_s *rr_elect_balancing(struct sched_s *sched)
 {
 	register struct thread_s *elected;
@@ -423,7 +541,11 @@ SCHED_SCOPE struct thread_s *rr_elect_balancing(struct sched_s *sched)
 			}
 			else
 			{
-				list_add_last(&rQueues->kthreads, &this->list);
+				if(thread_isService(this))
+					list_add_last(&rQueues->services, &this->list);
+				else
+					list_add_last(&rQueues->kthreads, &this->list);
+
 				rQueues->scheduler->k_runnable ++;
 				this->quantum = RR_QUANTUM;
 			}
@@ -433,7 +555,12 @@ SCHED_SCOPE struct thread_s *rr_elect_balancing(struct sched_s *sched)
 
 	if(count > 0)
 	{
-		if(!(list_empty(&rQueues->kthreads)))
+		if(!(list_empty(&rQueues->services)))
+		{
+			elected = list_first(&rQueues->services, struct thread_s, list);
+			rQueues->scheduler->k_runnable --;
+		}
+		else if(!(list_empty(&rQueues->kthreads)))
 		{
 			elected = list_first(&rQueues->kthreads, struct thread_s, list);
 			rQueues->scheduler->k_runnable --;
@@ -513,7 +640,11 @@ SCHED_SCOPE struct thread_s *rr_elect(struct sched_s *sched)
 		else
 		{
 			//list_add_first(&rQueues->kthreads, &this->list);
-			list_add_last(&rQueues->kthreads, &this->list);
+			if(thread_isService(this))
+				list_add_last(&rQueues->services, &this->list);
+			else
+				list_add_last(&rQueues->kthreads, &this->list);
+
 			rr_dmsg(INFO, "[%u] rr-elect adding on core %d: this %d, first thread %d, kthreads nbr %d\n", 
 					cpu_time_stamp(), current_cpu->gid, this, 
 					list_first(&rQueues->kthreads, struct thread_s, list),
@@ -525,7 +656,12 @@ SCHED_SCOPE struct thread_s *rr_elect(struct sched_s *sched)
    
 	if(count > 0)
 	{
-		if(!(list_empty(&rQueues->kthreads)))
+		if(!(list_empty(&rQueues->services)))
+		{
+			elected = list_first(&rQueues->services, struct thread_s, list);
+			rQueues->scheduler->k_runnable --;
+		}
+		else if(!(list_empty(&rQueues->kthreads)))
 		{
 			elected = list_first(&rQueues->kthreads, struct thread_s, list);
 			rr_dmsg(INFO, "[%u] rr-elect on core %d: this %x, elected %x, kthreads nbr %d\n",
@@ -570,6 +706,7 @@ static const struct sched_ops_s rr_sched_op =
 	.add_created = &rr_add_created,
 	.add         = &rr_add_created,
 	.remove      = &rr_remove,
+	.steal       = &rr_steal,
 
 #if CONFIG_CPU_LOAD_BALANCING
 	.elect       = &rr_elect_balancing,
@@ -594,10 +731,11 @@ error_t rr_sched_init(struct scheduler_s *scheduler, struct sched_s *sched)
 
 	spinlock_init(&rQueues->lock, "rQueues");
 
-	rQueues->cpu       = current_cpu;
+	rQueues->cpu       = list_container(scheduler, struct cpu_s, scheduler);
 	rQueues->period    = CONFIG_CPU_BALANCING_PERIOD * RR_QUANTUM;
 	rQueues->scheduler = scheduler;
 
+	list_root_init(&rQueues->services);
 	list_root_init(&rQueues->kthreads);
 	list_root_init(&rQueues->runnable);
 	list_root_init(&rQueues->migrate);
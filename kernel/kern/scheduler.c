@@ -34,6 +34,8 @@
 #include <rr-sched.h>
 #include <signal.h>
 #include <bits.h>
+#include <dqdt.h>
+#include <remote_access.h>
 #include <scheduler.h>
 
 #if CONFIG_USE_SCHED_LOCKS
@@ -101,7 +103,9 @@ error_t sched_init(struct scheduler_s *scheduler)
 #if CONFIG_USE_SCHED_LOCKS
 	spinlock_init(&db->lock, "Sched-db");
 #endif
-	list_root_init(&scheduler->sleep_check);
+	scheduler->wake_list = NULL;
+	scheduler->switched  = NULL;
+	memset(&scheduler->class_ticks[0], 0, sizeof(scheduler->class_ticks));
 
 	bitmap_set_range(db->bitmap, 0, SCHED_THREADS_NR);
 
@@ -286,6 +290,7 @@ void sched_clock(struct thread_s *this, uint_t ticks_nr)
 	scheduler = &cpu->scheduler;
 
 	this->ticks_nr ++;
+	scheduler->class_ticks[sched_class(this)] ++;
 
 	if(this->type == KTHREAD)
 		cpu_get_thread_idle(cpu)->ticks_nr ++;
@@ -298,6 +303,17 @@ void sched_clock(struct thread_s *this, uint_t ticks_nr)
 		scheduler->scheds_tbl[i].op.clock(this, ticks_nr);
 }
 
+uint_t sched_class(struct thread_s *thread)
+{
+	if(thread->type == TH_IDLE)
+		return SCHED_CLASS_IDLE;
+
+	if(thread->type == PTHREAD)
+		return SCHED_CLASS_USER;
+
+	return (thread_isService(thread)) ? SCHED_CLASS_SERVICE : SCHED_CLASS_KERNEL;
+}
+
 void sched_strategy(struct scheduler_s *scheduler)
 {
 	register uint_t i;
@@ -311,32 +327,130 @@ void sched_idle(struct thread_s *this)
 	sched_event_notify(&(thread_current_cpu(this)->scheduler));
 }
 
+uint_t sched_steal(struct scheduler_s *scheduler)
+{
+#if CONFIG_SCHED_WORK_STEALING
+	register uint_t i;
+
+	for(i = 0; i < SCHEDS_NR; i++)
+	{
+		if((scheduler->scheds_tbl[i].op.steal != NULL) &&
+		   (scheduler->scheds_tbl[i].op.steal(&scheduler->scheds_tbl[i])))
+			return 1;
+	}
+#endif
+	return 0;
+}
+
+void sched_transfer(struct thread_s *thread, struct cpu_s *cpu)
+{
+	struct cpu_s *old;
+	uint_t policy;
+	error_t err;
+
+	old    = thread_current_cpu(thread);
+	policy = sched_getpolicy(thread);
+
+	sched_unregister(thread);
+
+	thread_set_current_cpu(thread, cpu);
+	sched_setpolicy(thread, policy);
+
+	err = sched_register(thread);
+	assert(err == 0);
+
+	thread->info.attr.cpu_lid = cpu->lid;
+	thread->info.attr.cpu_gid = cpu->gid;
+
+	dqdt_update_threads_number(cpu->cluster->id, old->lid, -1);
+	dqdt_update_threads_number(cpu->cluster->id, cpu->lid, 1);
+
+	sched_notify_dmsg(thread, thread->ltid, "TRANSFER");
+}
+
+
+void sched_wakeup_push(struct thread_s *thread, cid_t cid)
+{
+	register struct cpu_s *cpu;
+	register struct thread_s *head;
+	register void *list;
+
+	/* Already queued: the pending wakeup covers this one too */
+	if(!(remote_atomic_cas((void*)&thread->wake_queued, cid, 0, 1)))
+		return;
+
+	cpu  = (struct cpu_s*) remote_lw((void*)&thread->lcpu, cid);
+	list = (void*)&cpu->scheduler.wake_list;
+
+	do
+	{
+		head = (struct thread_s*) remote_lw(list, cid);
+		remote_sw((void*)&thread->wake_next, cid, (uint_t)head);
+		cpu_wbflush();
+	}while(!(remote_atomic_cas(list, cid, (uint_t)head, (uint_t)thread)));
+}
 
 void check_sleeping(struct scheduler_s * scheduler)
 {
 	register struct thread_s *thread;
-	register struct list_entry *iter;
+	register struct thread_s *next;
+	uint_t irq_state;
 
-	list_foreach(&scheduler->sleep_check, iter)
+	cpu_disable_all_irq(&irq_state);
+
+	/* Detach the whole list at once, pushers never block on us */
+	do
 	{
-		thread = list_element(iter, struct thread_s, list);
-		if(thread->state == S_READY)
-		{
+		thread = scheduler->wake_list;
+	}while((thread != NULL) && !(cpu_atomic_cas((void*)&scheduler->wake_list, 
+						    (sint_t)thread, (sint_t)NULL)));
+
+	while(thread != NULL)
+	{
+		next = thread->wake_next;
+		thread->wake_next = NULL;
+		cpu_wbflush();
+		thread->wake_queued = 0;
+
 #if CONFIG_SCHED_DEBUG
-			isr_dmsg(INFO, "%s: [%d] wakening thread %x\n", 
-			__FUNCTION__,
-			cpu_get_id(),
-			thread);
+		isr_dmsg(INFO, "%s: [%d] wakening thread %x\n", 
+			 __FUNCTION__,
+			 cpu_get_id(),
+			 thread);
 #endif
-			list_unlink(&thread->list);
-			thread->state = S_WAIT;
+		/* The pusher has beaten the thread going to sleep */
+		if(thread->state != S_WAIT)
+			thread_set_wake_pending(thread);
+		else
 			sched_wakeup(thread);
-			break;
-		}
+
+		thread = next;
 	}
+
+	cpu_restore_irq(irq_state);
 }
 
 
+/* 
+ * Called on a core once its previous context switch is over, that is
+ * once the context of the switched out thread has been saved: only then
+ * another core may steal this thread and resume it.
+ */
+static inline void sched_switch_done(struct scheduler_s *scheduler)
+{
+	register struct thread_s *prev;
+
+	prev = scheduler->switched;
+
+	if(prev == NULL)
+		return;
+
+	scheduler->switched = NULL;
+
+	if(thread_isStealRequested(prev))
+		thread_set_stealable(prev);
+}
+
 /* to be called with interrupts disabled */
 SCHED_SCOPE void schedule(struct thread_s *this)
 {
@@ -351,9 +465,13 @@ SCHED_SCOPE void schedule(struct thread_s *this)
 	cpu       = current_cpu;
 	scheduler = &cpu->scheduler;
 
+	/* a newly created thread starts without going through the end of schedule */
+	sched_switch_done(scheduler);
+
 	sched_event_notify(scheduler);
 
-	check_sleeping(scheduler);
+	if(scheduler->wake_list != NULL)
+		check_sleeping(scheduler);
 
 	for(i=0; (i < SCHEDS_NR) && (elected == NULL); i++)
 	{
@@ -389,6 +507,9 @@ SCHED_SCOPE void schedule(struct thread_s *this)
     
 	if(elected != this)
 	{
+		if(thread_isStealRequested(this))
+			scheduler->switched = this;
+
 		if((ret = cpu_context_save(&this->pws)) == 0)
 		{  
 			if(elected->state == S_CREATE)
@@ -406,6 +527,10 @@ SCHED_SCOPE void schedule(struct thread_s *this)
 			cpu_context_restore(&elected->pws, 1);
 			PANIC ("Thread %x on CPU %d, must never to return here !!", elected, cpu->gid);
 		}
+
+		/* we may have been stolen meanwhile, our core is no longer cpu */
+		cpu = current_cpu;
+		sched_switch_done(&cpu->scheduler);
 	}
 	else
 		this->state = S_KERNEL;
@@ -572,6 +697,18 @@ void __sched_sleep(struct thread_s *this, bool_t add_to_sleep_check)
 
 	cpu_disable_all_irq(&irq_state);
 
+	if(add_to_sleep_check)
+	{
+		check_sleeping(&current_cpu->scheduler);
+
+		if(thread_isWake_pending(this))
+		{
+			thread_clear_wake_pending(this);
+			cpu_restore_irq(irq_state);
+			return;
+		}
+	}
+
 	if(thread_isCapWakeup(this))
 		thread_set_wakeable(this);
 
@@ -581,13 +718,6 @@ void __sched_sleep(struct thread_s *this, bool_t add_to_sleep_check)
 		this->info.before_sleep(this);
 
 	this->local_sched->op.sleep(this);
-	
-	if(add_to_sleep_check)
-	{
-		list_add_last(	&current_cpu->scheduler.sleep_check, 
-				&this->list);
-	}
-		
 	schedule(this);
 
 	thread_clear_wakeable(this);
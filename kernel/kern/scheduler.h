@@ -31,6 +31,7 @@
 struct sched_s;
 struct thread_s;
 struct scheduler_s;
+struct cpu_s;
 
 typedef error_t sched_init_t     (struct scheduler_s *scheduler, struct sched_s *sched);
 typedef void sched_add_t         (struct thread_s *thread);
@@ -44,6 +45,7 @@ typedef void sched_sleep_t    (struct thread_s *thread);
 typedef void sched_wakeup_t   (struct thread_s *thread);
 typedef void sched_clock_t    (struct thread_s *thread, uint_t ticks_nr);
 typedef void sched_setprio_t  (struct thread_s *thread, uint_t prio);
+typedef bool_t sched_steal_t  (struct sched_s *sched);
 
 typedef struct thread_s* sched_elect_t (struct sched_s *sched);
 
@@ -59,6 +61,7 @@ struct sched_ops_s
 	sched_strategy_t    *strategy;
 	sched_clock_t       *clock;
 	sched_add_created_t *add_created;
+	sched_steal_t       *steal;
 };
 
 struct sched_s
@@ -79,6 +82,13 @@ struct sched_param
 
 #define SCHEDS_NR           1
 
+/* Runtime accounting classes */
+#define SCHED_CLASS_SERVICE 0
+#define SCHED_CLASS_KERNEL  1
+#define SCHED_CLASS_USER    2
+#define SCHED_CLASS_IDLE    3
+#define SCHED_CLASS_NR      4
+
 #define SCHED_OP_NOP
 #define SCHED_OP_WAKEUP
 #define SCHED_OP_UWAKEUP
@@ -95,7 +105,9 @@ struct scheduler_s
 	uint16_t export_nr;
 	uint16_t import_nr;
 	struct sched_db_s *db;
-	struct list_entry sleep_check;
+	struct thread_s * volatile wake_list;
+	struct thread_s *switched;	/* last switched out, see sched_switch_done */
+	uint_t class_ticks[SCHED_CLASS_NR];
 	struct sched_s scheds_tbl[SCHEDS_NR];
 };
 
@@ -134,13 +146,21 @@ void sched_sleep(struct thread_s *this);
 
 
 /** Put the calling thread into passive wait state 
- * The thread is to be checked at each schedule ... */
+ * until it get pushed on its CPU wake list by sched_wakeup_push.
+ * Return at once if such a push has already been consumed */
 void sched_sleep_check(struct thread_s *this);
 
 /** Wakeup the given thread from its passive wait */
 void sched_wakeup(struct thread_s *thread);
 
-/** Check threads sleeping on the sleep_check list */
+/** 
+ * Push the given thread, living in cluster cid, on the lock-free 
+ * wake list of its CPU scheduler, can be called from any cluster.
+ * Pushing a thread already on the list is a no-op.
+ */
+void sched_wakeup_push(struct thread_s *thread, cid_t cid);
+
+/** Wakeup all threads pushed on the wake list of the given scheduler */
 void check_sleeping(struct scheduler_s *scheduler);
 
 /** Enable the scheduler to balance its load and do some internal strategie */
@@ -152,6 +172,22 @@ void sched_clock(struct thread_s *this, uint_t ticks_nr);
 /** When current thread is idle inform the scheduler */
 void sched_idle(struct thread_s *this);
 
+/** 
+ * Called by an idle CPU to steal a runnable thread from 
+ * a sibling core of the same cluster, return the number 
+ * of stolen threads. Must be called with interrupts disabled.
+ */
+uint_t sched_steal(struct scheduler_s *scheduler);
+
+/** 
+ * Attach a thread, which has been removed from its runqueue 
+ * by a stealing policy, to the scheduler of given CPU 
+ */
+void sched_transfer(struct thread_s *thread, struct cpu_s *cpu);
+
+/** Return the runtime accounting class of the given thread */
+uint_t sched_class(struct thread_s *thread);
+
 /** Return runnable threads count (User & Kernel) */
 static inline uint_t sched_runnable_count(struct scheduler_s *scheduler);
 
@@ -211,7 +247,8 @@ static inline uint_t sched_runnable_count(struct scheduler_s *scheduler)
 	volatile uint16_t *ptr;
 	uint_t count;
 
-	check_sleeping(scheduler);
+	if(scheduler->wake_list != NULL)
+		check_sleeping(scheduler);
 
 	ptr = &scheduler->u_runnable;
 	count = *ptr;
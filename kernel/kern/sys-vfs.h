@@ -28,6 +28,15 @@
 
 struct vfs_usp_dirent_s;
 
+/* User I/O vector, same layout as struct iovec */
+struct sys_iovec_s
+{
+	void *iov_base;
+	size_t iov_len;
+};
+
+#define SYS_IOV_MAX   16
+
 /* Files related system call */
 int sys_open (char *pathname, uint_t flags, uint_t mode);
 int sys_stat (char *path, struct vfs_stat_s *buf, int fd);
@@ -35,6 +44,11 @@ int sys_creat (char *pathname, uint_t mode);
 int sys_read (uint_t fd, void *buf, size_t count);
 int sys_write (uint_t fd, void *buf, size_t count);
 int sys_lseek (uint_t fd, off_t offset, int whence);
+int sys_pread (uint_t fd, void *buf, size_t count, off_t offset);
+int sys_pwrite (uint_t fd, void *buf, size_t count, off_t offset);
+int sys_readv (uint_t fd, struct sys_iovec_s *iov, int iovcnt);
+int sys_writev (uint_t fd, struct sys_iovec_s *iov, int iovcnt);
+int sys_sendfile (uint_t out_fd, uint_t in_fd, off_t *offset, size_t count);
 int sys_unlink (char *pathname);
 int sys_close (uint_t fd);
 
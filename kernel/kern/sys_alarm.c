@@ -41,21 +41,25 @@ EVENT_HANDLER(sys_alarm_event_handler)
 int sys_alarm (unsigned nb_sec)
 {
 	struct thread_s *this;
-	struct event_s event;
-	struct alarm_info_s info;
+	struct event_s *event;
+	struct alarm_info_s *info;
 
 	if( nb_sec == 0)
 		return 0;
 
-	this = current_thread;
-	event_set_handler(&event, &sys_alarm_event_handler);
-	event_set_priority(&event, E_FUNC);
-	event_set_argument(&event,this);
-	info.event = &event;
+	this  = current_thread;
+	event = &this->info.alarm_event;
+	info  = &this->info.alarm;
 
-	alarm_wait(&info, nb_sec * 4);
+	event_set_handler(event, &sys_alarm_event_handler);
+	event_set_priority(event, E_FUNC);
+	event_set_argument(event,this);
+	info->event = event;
+
+	alarm_wait(info, nb_sec * 4);
 	sched_sleep(this);
+
+	/* Woken up before expiry (this may have migrated) */
+	(void)alarm_cancel(&current_thread->info.alarm);
 	return 0;
 }
-
-
@@ -90,6 +90,12 @@ int sys_mmap(mmap_attr_t *mattr)
 			this->info.errno = EBADFD;
 			return (int)VM_FAILED;
 		}
+
+		if(file->f_attr & VFS_PIPE)
+		{
+			this->info.errno = ENODEV;
+			return (int)VM_FAILED;
+		}
      
 		//atomic_add(&file->f_count, 1);
 		vfs_file_up(file);//FIXME coalsce access to remote node info
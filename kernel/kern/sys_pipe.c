@@ -20,6 +20,8 @@
  * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include <errno.h>
+#include <config.h>
 #include <vfs.h>
 #include <sys-vfs.h>
 #include <task.h>
@@ -28,6 +30,44 @@
 
 int sys_pipe (uint_t *pipefd)
 {
-	current_thread->info.errno = ENOSYS;
+	register struct thread_s *this;
+	register struct task_s *task;
+	struct vfs_file_s *file[2];
+	uint_t fd[2];
+	error_t err;
+
+	this = current_thread;
+	task = current_task;
+
+	if((pipefd == NULL) || NOT_IN_USPACE((uint_t)pipefd))
+	{
+		this->info.errno = EFAULT;
+		return -1;
+	}
+
+	if((err = task_fd_get(task, &fd[0], &file[0])))
+		goto SYS_PIPE_ERR;
+
+	if((err = task_fd_get(task, &fd[1], &file[1])))
+		goto SYS_PIPE_ERR1;
+
+	if((err = vfs_pipe(file)))
+		goto SYS_PIPE_ERR2;
+
+	if((err = cpu_copy_to_uspace(pipefd, &fd[0], sizeof(fd))))
+	{
+		vfs_close(file[0], NULL);
+		vfs_close(file[1], NULL);
+		goto SYS_PIPE_ERR2;
+	}
+
+	return 0;
+
+SYS_PIPE_ERR2:
+	task_fd_put(task, fd[1]);
+SYS_PIPE_ERR1:
+	task_fd_put(task, fd[0]);
+SYS_PIPE_ERR:
+	this->info.errno = err;
 	return -1;
 }
@@ -0,0 +1,98 @@
+/*
+ * kern/sys_readv.c - vectored read and write of an opened file
+ * 
+ * Copyright (c) 2008,2009,2010,2011,2012 Ghassan Almaless
+ * Copyright (c) 2011,2012,2013,2014,2015 UPMC Sorbonne Universites
+ *
+ * This file is part of ALMOS-kernel.
+ *
+ * ALMOS-kernel is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2.0 of the License.
+ *
+ * ALMOS-kernel is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with ALMOS-kernel; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <errno.h>
+#include <thread.h>
+#include <vfs.h>
+#include <sys-vfs.h>
+#include <task.h>
+
+static int sys_rw_vector (uint_t fd, struct sys_iovec_s *iov, int iovcnt, bool_t isRead)
+{
+	struct sys_iovec_s kiov[SYS_IOV_MAX];
+	struct ku_obj kub[SYS_IOV_MAX];
+	struct thread_s *this;
+	struct task_s *task;
+	struct vfs_file_s *file;
+	size_t total;
+	ssize_t err;
+	int i;
+
+	file = NULL;
+	this = current_thread;
+	task = current_task;
+
+	if((fd >= CONFIG_TASK_FILE_MAX_NR) || (task_fd_lookup(task, fd, &file)))
+	{
+		this->info.errno = EBADFD;
+		return -1;
+	}
+
+	if((iovcnt <= 0) || (iovcnt > SYS_IOV_MAX))
+	{
+		this->info.errno = EINVAL;
+		return -1;
+	}
+
+	if((iov == NULL) || NOT_IN_USPACE((uint_t)iov) ||
+	   cpu_copy_from_uspace(&kiov[0], iov, sizeof(*iov) * iovcnt))
+	{
+		this->info.errno = EFAULT;
+		return -1;
+	}
+
+	for(total = 0, i = 0; i < iovcnt; i++)
+	{
+		/* The total must fit in the returned ssize_t */
+		if((ssize_t)(total + kiov[i].iov_len) < (ssize_t)total)
+		{
+			this->info.errno = EINVAL;
+			return -1;
+		}
+
+		total += kiov[i].iov_len;
+		KU_SLICE_BUFF(kub[i], kiov[i].iov_base, kiov[i].iov_len);
+	}
+
+	if(isRead)
+		err = vfs_readv(file, &kub[0], iovcnt);
+	else
+		err = vfs_writev(file, &kub[0], iovcnt);
+
+	if(err < 0)
+	{
+		this->info.errno = -err;
+		return -1;
+	}
+
+	return err;
+}
+
+int sys_readv (uint_t fd, struct sys_iovec_s *iov, int iovcnt)
+{
+	return sys_rw_vector(fd, iov, iovcnt, true);
+}
+
+int sys_writev (uint_t fd, struct sys_iovec_s *iov, int iovcnt)
+{
+	return sys_rw_vector(fd, iov, iovcnt, false);
+}
@@ -0,0 +1,81 @@
+/*
+ * kern/sys_sendfile.c - copy between two opened files within the kernel
+ * 
+ * Copyright (c) 2008,2009,2010,2011,2012 Ghassan Almaless
+ * Copyright (c) 2011,2012,2013,2014,2015 UPMC Sorbonne Universites
+ *
+ * This file is part of ALMOS-kernel.
+ *
+ * ALMOS-kernel is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2.0 of the License.
+ *
+ * ALMOS-kernel is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with ALMOS-kernel; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <errno.h>
+#include <thread.h>
+#include <vfs.h>
+#include <sys-vfs.h>
+#include <task.h>
+
+int sys_sendfile (uint_t out_fd, uint_t in_fd, off_t *offset, size_t count)
+{
+	struct vfs_file_s *out;
+	struct vfs_file_s *in;
+	struct thread_s *this;
+	struct task_s *task;
+	size_t pos;
+	off_t uoffset;
+	ssize_t err;
+
+	out  = NULL;
+	in   = NULL;
+	this = current_thread;
+	task = current_task;
+
+	if((out_fd >= CONFIG_TASK_FILE_MAX_NR) || (task_fd_lookup(task, out_fd, &out)) ||
+	   (in_fd >= CONFIG_TASK_FILE_MAX_NR) || (task_fd_lookup(task, in_fd, &in)))
+	{
+		this->info.errno = EBADFD;
+		return -1;
+	}
+
+	if(offset != NULL)
+	{
+		if((err = cpu_copy_from_uspace(&uoffset, offset, sizeof(uoffset))))
+		{
+			this->info.errno = err;
+			return -1;
+		}
+
+		if(uoffset < 0)
+		{
+			this->info.errno = EINVAL;
+			return -1;
+		}
+
+		pos = (size_t)uoffset;
+	}
+
+	if((err = vfs_sendfile(out, in, (offset) ? &pos : NULL, count)) < 0)
+	{
+		this->info.errno = -err;
+		return -1;
+	}
+
+	if(offset != NULL)
+	{
+		uoffset = (off_t)pos;
+		cpu_copy_to_uspace(offset, &uoffset, sizeof(uoffset));
+	}
+
+	return err;
+}
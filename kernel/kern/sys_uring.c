@@ -0,0 +1,419 @@
+/*
+ * kern/sys_uring.c - Asynchronous system call ring
+ * 
+ * Copyright (c) 2008,2009,2010,2011,2012 Ghassan Almaless
+ * Copyright (c) 2011,2012 UPMC Sorbonne Universites
+ *
+ * This file is part of ALMOS-kernel.
+ *
+ * ALMOS-kernel is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2.0 of the License.
+ *
+ * ALMOS-kernel is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with ALMOS-kernel; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <types.h>
+#include <errno.h>
+#include <config.h>
+#include <cpu.h>
+#include <thread.h>
+#include <task.h>
+#include <scheduler.h>
+#include <vmm.h>
+#include <sys-vfs.h>
+#include <futex.h>
+#include <uring.h>
+
+static inline error_t uring_get(volatile uint_t *uaddr, uint_t *val)
+{
+	return cpu_copy_from_uspace(val, (void*)uaddr, sizeof(*val));
+}
+
+static inline error_t uring_put(volatile uint_t *uaddr, uint_t val)
+{
+	return cpu_copy_to_uspace((void*)uaddr, &val, sizeof(val));
+}
+
+static sint_t uring_exec(struct uring_sqe_s *sqe)
+{
+	struct thread_s *this;
+	sint_t ret;
+
+	this = current_thread;
+	this->info.errno = 0;
+
+	switch(sqe->opcode)
+	{
+	case URING_OP_NOP:
+		return 0;
+
+	case URING_OP_READ:
+		ret = sys_read(sqe->fd, sqe->addr, sqe->len);
+		break;
+
+	case URING_OP_WRITE:
+		ret = sys_write(sqe->fd, sqe->addr, sqe->len);
+		break;
+
+	case URING_OP_PREAD:
+		ret = sys_pread(sqe->fd, sqe->addr, sqe->len, sqe->offset);
+		break;
+
+	case URING_OP_PWRITE:
+		ret = sys_pwrite(sqe->fd, sqe->addr, sqe->len, sqe->offset);
+		break;
+
+	case URING_OP_OPEN:
+		ret = sys_open(sqe->addr, sqe->len, sqe->offset);
+		break;
+
+	case URING_OP_CLOSE:
+		ret = sys_close(sqe->fd);
+		break;
+
+	case URING_OP_STAT:
+		/* sys_stat reports success through errno only */
+		ret = sys_stat(sqe->addr2, sqe->addr, sqe->fd);
+		return (ret == -1) ? -((sint_t)this->info.errno) : -ret;
+
+	case URING_OP_FSYNC:
+		ret = sys_fsync(sqe->fd);
+		break;
+
+	default:
+		return -EINVAL;
+	}
+
+	if(ret < 0)
+		return -((sint_t)this->info.errno);
+
+	return ret;
+}
+
+static error_t uring_load(struct uring_s *ring, struct uring_s *kring)
+{
+	if((ring == NULL) || NOT_IN_USPACE((uint_t)ring))
+		return EFAULT;
+
+	if(cpu_copy_from_uspace(kring, ring, sizeof(*kring)))
+		return EFAULT;
+
+	if((kring->entries == 0) || 
+	   (kring->entries > URING_ENTRIES_MAX) ||
+	   (kring->entries & (kring->entries - 1)))
+		return EINVAL;
+
+	if(NOT_IN_USPACE((uint_t)kring->sqes) || NOT_IN_USPACE((uint_t)kring->cqes))
+		return EFAULT;
+
+	return 0;
+}
+
+/* Atomic on the user word, a fault is reported as EFAULT */
+static inline error_t uring_cas(volatile uint_t *uaddr, uint_t old, uint_t new, bool_t *isAtomic)
+{
+	if((uint_t)uaddr & (sizeof(uint_t) - 1))
+		return EFAULT;
+
+	return cpu_uspace_cas((void*)uaddr, old, new, isAtomic);
+}
+
+/* 
+ * Release the claim.  Task threads may set URING_KWAIT meanwhile to be
+ * woken up on the kflags futex, hence the CAS.
+ */
+static void uring_release(struct uring_s *ring)
+{
+	bool_t isAtomic;
+	uint_t kflags;
+	uint_t woken;
+
+	cpu_wbflush();
+
+	do
+	{
+		if(uring_get(&ring->kflags, &kflags) ||
+		   uring_cas(&ring->kflags, kflags, 0, &isAtomic))
+			return;
+	}while(!isAtomic);
+
+	cpu_wbflush();
+
+	if(kflags & URING_KWAIT)
+		futex_wake((uint_t*)&ring->kflags, CONFIG_PTHREAD_THREADS_MAX, &woken);
+}
+
+/* 
+ * Claim the ring for this thread, setting flag (URING_KBUSY or
+ * URING_WORKER_ON) in kflags if no other kernel thread holds it, then
+ * reload the words only a claim holder writes.
+ */
+static error_t uring_claim(struct uring_s *ring, struct uring_s *kring, uint_t flag)
+{
+	bool_t isAtomic;
+	uint_t kflags;
+	error_t err;
+
+	while(1)
+	{
+		if((err = uring_get(&ring->kflags, &kflags)))
+			return err;
+
+		kring->kflags = kflags;
+
+		if(kflags & (URING_KBUSY | URING_WORKER_ON))
+			return EBUSY;
+
+		if((err = uring_cas(&ring->kflags, kflags, kflags | flag, &isAtomic)))
+			return err;
+
+		if(isAtomic) break;
+	}
+
+	kring->kflags = kflags | flag;
+
+	if((err = uring_get(&ring->sq_head, (uint_t*)&kring->sq_head)) ||
+	   (err = uring_get(&ring->cq_head, (uint_t*)&kring->cq_head)) ||
+	   (err = uring_get(&ring->cq_tail, (uint_t*)&kring->cq_tail)))
+	{
+		uring_release(ring);
+		return err;
+	}
+
+	return 0;
+}
+
+/* Wake up the task threads waiting for completions, if any */
+static void uring_notify(struct uring_s *ring)
+{
+	uint_t uflags;
+	uint_t woken;
+
+	cpu_wbflush();
+
+	if(uring_get(&ring->uflags, &uflags))
+		return;
+
+	if(uflags & URING_CQ_WAIT)
+		futex_wake((uint_t*)&ring->cq_tail, CONFIG_PTHREAD_THREADS_MAX, &woken);
+}
+
+/* 
+ * Consume at most max submissions, the ring being claimed.  kring
+ * caches sq_head and cq_tail, which only the claim holder writes.
+ * Return EBUSY when stopped by a full completion queue.
+ */
+static error_t uring_consume(struct uring_s *ring, struct uring_s *kring, uint_t max, uint_t *count)
+{
+	struct uring_sqe_s sqe;
+	struct uring_cqe_s cqe;
+	uint_t mask;
+	uint_t done;
+	error_t err;
+
+	mask = kring->entries - 1;
+	done = 0;
+	err  = 0;
+
+	while(done < max)
+	{
+		if((err = uring_get(&ring->sq_tail, (uint_t*)&kring->sq_tail)))
+			break;
+
+		if(kring->sq_head == kring->sq_tail)
+			break;
+
+		if((kring->cq_tail - kring->cq_head) >= kring->entries)
+		{
+			if((err = uring_get(&ring->cq_head, (uint_t*)&kring->cq_head)))
+				break;
+
+			if((kring->cq_tail - kring->cq_head) >= kring->entries)
+			{
+				err = EBUSY;
+				break;
+			}
+		}
+
+		if((err = cpu_copy_from_uspace(&sqe, &kring->sqes[kring->sq_head & mask], sizeof(sqe))))
+			break;
+
+		kring->sq_head ++;
+
+		if((err = uring_put(&ring->sq_head, kring->sq_head)))
+			break;
+
+		cqe.user_data = sqe.user_data;
+		cqe.res       = uring_exec(&sqe);
+
+		if((err = cpu_copy_to_uspace(&kring->cqes[kring->cq_tail & mask], &cqe, sizeof(cqe))))
+			break;
+
+		cpu_wbflush();
+		kring->cq_tail ++;
+
+		if((err = uring_put(&ring->cq_tail, kring->cq_tail)))
+			break;
+
+		done ++;
+	}
+
+	if(done != 0)
+		uring_notify(ring);
+
+	*count = done;
+	return err;
+}
+
+static error_t uring_worker(struct uring_s *ring, struct uring_s *kring)
+{
+	uint_t uflags;
+	uint_t value;
+	uint_t count;
+	error_t err;
+
+	/* An inline consumer only holds the ring for a while */
+	while(((err = uring_claim(ring, kring, URING_WORKER_ON)) == EBUSY) &&
+	      !(kring->kflags & URING_WORKER_ON))
+		sched_yield(current_thread);
+
+	if(err) return err;
+
+	while(1)
+	{
+		if((err = uring_get(&ring->uflags, &uflags)))
+			break;
+
+		if(uflags & URING_WORKER_STOP)
+			break;
+
+		err = uring_consume(ring, kring, kring->entries, &count);
+
+		if(err == EBUSY)
+		{
+			uring_put(&ring->kflags, URING_WORKER_ON | URING_CQ_FULL);
+			cpu_wbflush();
+
+			if((err = uring_get(&ring->cq_head, &value)))
+				break;
+
+			if(value == kring->cq_head)
+				futex_wait((uint_t*)&ring->cq_head, value);
+
+			uring_put(&ring->kflags, URING_WORKER_ON);
+			continue;
+		}
+
+		if(err) break;
+
+		if(count != 0)
+			continue;
+
+		/* Nothing to do, go idle unless the task has just submitted */
+		uring_put(&ring->kflags, URING_WORKER_ON | URING_WORKER_IDLE);
+		cpu_wbflush();
+
+		if((err = uring_get(&ring->sq_tail, &value)) || 
+		   (err = uring_get(&ring->uflags, &uflags)))
+			break;
+
+		if((value == kring->sq_head) && !(uflags & URING_WORKER_STOP))
+			futex_wait((uint_t*)&ring->sq_tail, value);
+
+		uring_put(&ring->kflags, URING_WORKER_ON);
+	}
+
+	uring_release(ring);
+	return err;
+}
+
+/* 
+ * Consume inline under an URING_KBUSY claim.  A submission made while
+ * another thread held the claim may have been missed by it, so the
+ * queue is checked again once the claim is released.
+ */
+static error_t uring_enter(struct uring_s *ring, struct uring_s *kring, uint_t max, uint_t *count)
+{
+	uint_t woken;
+	uint_t done;
+	uint_t tail;
+	error_t err;
+
+	*count = 0;
+
+	while(1)
+	{
+		err = uring_claim(ring, kring, URING_KBUSY);
+
+		if(err == EBUSY)
+		{
+			/* The worker is the only consumer while it runs,
+			 * an inline holder serves the queue till empty */
+			if((kring->kflags & URING_WORKER_ON) && (kring->kflags & URING_WORKER_IDLE))
+				futex_wake((uint_t*)&ring->sq_tail, 1, &woken);
+			return 0;
+		}
+
+		if(err) return err;
+
+		err = uring_consume(ring, kring, max - *count, &done);
+		uring_release(ring);
+
+		*count += done;
+
+		if(err || (*count == max))
+			return err;
+
+		if((err = uring_get(&ring->sq_tail, &tail)))
+			return err;
+
+		if(tail == kring->sq_head)
+			return 0;
+	}
+}
+
+int sys_uring(struct uring_s *ring, uint_t operation, uint_t arg)
+{
+	struct uring_s kring;
+	struct thread_s *this;
+	uint_t count;
+	error_t err;
+
+	this  = current_thread;
+	count = 0;
+
+	if((err = uring_load(ring, &kring)))
+		goto SYS_URING_ERR;
+
+	switch(operation)
+	{
+	case URING_ENTER:
+		err = uring_enter(ring, &kring, arg, &count);
+
+		if(err == EBUSY)
+			err = (count) ? 0 : EBUSY;
+		break;
+
+	case URING_WORKER:
+		err = uring_worker(ring, &kring);
+		break;
+
+	default:
+		err = EINVAL;
+	}
+
+	if(err == 0)
+		return count;
+
+SYS_URING_ERR:
+	this->info.errno = err;
+	return -1;
+}
@@ -149,6 +149,8 @@ struct thread_info
 	uint_t kstack_size;
 	struct event_s *e_info;
 	struct page_s *page;
+	struct alarm_info_s alarm;          /*! per-thread alarm (timed sleeps) */
+	struct event_s alarm_event;         /*! event sent on alarm expiry */
 };
 
 
@@ -180,6 +182,8 @@ struct thread_s
 	struct cpu_context_s pws;     /*! processor work state (register saved zone) */
 	struct list_entry list;       /*! next/pred threads at the same state */
 	struct list_entry rope;       /*! next/pred threads in the __rope list of thread */
+	struct thread_s *wake_next;   /*! next thread in the wake list of its CPU scheduler */
+	volatile uint_t wake_queued;  /*! set while the thread is on that wake list */
 	struct thread_info info;      /*! (exit value, statistics, ...) */
 	uint_t signature;
 };
@@ -228,6 +232,11 @@ struct thread_s
 #define thread_clear_signaled(thread)
 #define thread_isSignaled(thread)
 #define thread_isStack_overflow(thread)
+#define thread_request_steal(thread)
+#define thread_isStealRequested(thread)
+#define thread_set_stealable(thread)
+#define thread_clear_stealable(thread)
+#define thread_isStealable(thread)
 
 /* Currents task, thread, cluster, cpu  */
 #define current_task
@@ -313,6 +322,10 @@ EVENT_HANDLER(thread_destroy_handler);
 #define TH_IMPORTED         0x200
 #define TH_FORCED_YIELD     0x400
 #define TH_DOING_SIGNAL     0x800
+#define TH_CAN_STEAL        0x1000
+#define TH_WAKE_PENDING     0x2000
+#define TH_SERVICE          0x4000
+#define TH_STEAL_REQ        0x8000
 
 /* Thread Attributes */
 #undef thread_isJoinable
@@ -358,6 +371,11 @@ EVENT_HANDLER(thread_destroy_handler);
 #undef thread_clear_signaled
 #undef thread_isSignaled
 #undef thread_isStack_overflow
+#undef thread_request_steal
+#undef thread_isStealRequested
+#undef thread_set_stealable
+#undef thread_clear_stealable
+#undef thread_isStealable
 
 #define thread_isJoinable(_th)         ((_th)->joinable != 0)
 #define thread_set_joinable(_th)     do{(_th)->joinable = 1;}while(0)
@@ -481,6 +499,27 @@ EVENT_HANDLER(thread_destroy_handler);
 
 #define thread_isStack_overflow(_th) ((_th)->signature != THREAD_ID)
 
+/* Preempted on its way back to user space: can be resumed by another core of the *
+ * cluster, but only once its context has been saved (see sched_switch_done)      */
+#define thread_request_steal(_th)     do{(_th)->flags |= TH_STEAL_REQ;}while(0)
+#define thread_isStealRequested(_th)  ((_th)->flags & TH_STEAL_REQ)
+#define thread_set_stealable(_th)     do{(_th)->flags |= TH_CAN_STEAL;}while(0)
+#define thread_clear_stealable(_th)   do{(_th)->flags &= ~(TH_CAN_STEAL | TH_STEAL_REQ);}while(0)
+#define thread_isStealable(_th)     (((_th)->state == S_CREATE) || ((_th)->flags & TH_CAN_STEAL))
+
+/* Wakeup pushed before the thread went to sleep: its next sched_sleep_check returns at once */
+#define thread_set_wake_pending(_th)   do{(_th)->flags |= TH_WAKE_PENDING;}while(0)
+#define thread_clear_wake_pending(_th) do{(_th)->flags &= ~TH_WAKE_PENDING;}while(0)
+#define thread_isWake_pending(_th)     ((_th)->flags & TH_WAKE_PENDING)
+
+/* Service kthread (RPC, events, kvfsd): elected before any other thread of its CPU */
+#if CONFIG_SCHED_SERVICE_CLASS
+#define thread_set_service(_th)     do{(_th)->flags |= TH_SERVICE;}while(0)
+#else
+#define thread_set_service(_th)     do{}while(0)
+#endif
+#define thread_isService(_th)       ((_th)->flags & TH_SERVICE)
+
 /* Currents task, thread, cluster, cpu  */
 #undef current_task
 #undef current_thread
@@ -58,6 +58,8 @@ error_t thread_dup(struct task_s *task,
 	// Initialize dst thread
 	spinlock_init(&dst->lock, "Thread");
 	dst->flags                           = 0;
+	dst->wake_next                       = NULL;
+	dst->wake_queued                     = 0;
 	thread_clear_joinable(dst);
 	dst->locks_count                     = 0;
 	dst->ticks_nr                        = 0;
@@ -77,6 +79,7 @@ error_t thread_dup(struct task_s *task,
 	dst->info.tm_wait                    = 0;
 	signal_init(dst);
 	dst->info.join                       = NULL;
+	dst->info.alarm.state                = ALARM_IDLE;
 	wait_queue_init(&dst->info.wait_queue, "Join/Exit Sync");
 	dst->info.attr.sched_policy          = sched_policy;
 	dst->info.attr.cid                   = cid;
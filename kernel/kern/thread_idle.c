@@ -101,6 +101,7 @@ void* thread_idle(void *arg)
 
 	thread->task   = this->task;
 	cpu->event_mgr = thread;
+	thread_set_service(thread);
 	wait_queue_init(&thread->info.wait_queue, "Events");
 
 	err = sched_register(thread);
@@ -163,6 +164,7 @@ void* thread_idle(void *arg)
 			}
 
 			thread->task  = this->task;
+			thread_set_service(thread);
 			wait_queue_init(&thread->info.wait_queue, "KVFSD");
 			err           = sched_register(thread);
 			assert(err == 0);
@@ -187,6 +189,14 @@ void* thread_idle(void *arg)
 
 		count = sched_runnable_count(&cpu->scheduler);
 
+		if(count == 0)
+			count = sched_steal(&cpu->scheduler);
+
+		if(count == 0)
+			cpu_tickless_enter(cpu);
+		else
+			cpu_tickless_exit(cpu);
+
 		cpu_enable_all_irq(NULL);
 
 		if(count != 0)
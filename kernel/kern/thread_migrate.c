@@ -163,6 +163,18 @@ error_t thread_migrate(struct thread_s *this, sint_t target_gid)
 			vmm_set_auto_migrate(&task->vmm, task->vmm.data_start, MGRT_STACK);
 		}
 
+#if CONFIG_THREAD_STACK_MGRT
+		/* Other threads share the data, only our stack and TLS follow us */
+		if((task->threads_count > 1) &&
+		   (current_cluster->id != cpu->cluster->id) &&
+		   (this->info.attr.flags & PT_ATTR_AUTO_MGRT))
+		{
+			vmm_set_auto_migrate(&task->vmm, 
+					     (uint_t)this->info.attr.stack_addr, 
+					     MGRT_THREAD_STACK);
+		}
+#endif
+
 		return 0;
 	}
 
@@ -182,6 +194,9 @@ error_t thread_migrate(struct thread_s *this, sint_t target_gid)
 
 	thread_set_exported(this);
 
+	/* Pending alarm follows the thread, it is rearmed by do_migrate */
+	(void)alarm_detach(&this->info.alarm);
+
 	event_send(&info.event, arch_cpu_gid(attr.cid, attr.cpu_id));
  
 	sched_sleep(this);
@@ -192,6 +207,7 @@ error_t thread_migrate(struct thread_s *this, sint_t target_gid)
 	{
 		this->info.migration_fail_cntr ++;
 		thread_clear_exported(this);
+		(void)alarm_attach(&this->info.alarm);
 		return err;
 	}
 
@@ -279,6 +295,12 @@ error_t do_migrate(th_migrate_info_t *info)
 
 	wait_queue_init2(&new->info.wait_queue, &victim->info.wait_queue);
 
+	if(new->info.alarm.state == ALARM_DETACHED)
+	{
+		new->info.alarm.event = &new->info.alarm_event;
+		event_set_argument(&new->info.alarm_event, new);
+	}
+
 	spinlock_unlock(&victim->lock);
 	spinlock_unlock(&new->lock);
 	spinlock_unlock(&task->th_lock);
@@ -291,6 +313,7 @@ error_t do_migrate(th_migrate_info_t *info)
 	/* TODO: put a threshold on the migration number to prevent against permanent migration */
 	new->info.migration_cntr ++;
 	sched_add(new);
+	(void)alarm_attach(&new->info.alarm);
 	return 0;
 
 fail_nomem:
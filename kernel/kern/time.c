@@ -21,6 +21,7 @@
  */
 
 #include <types.h>
+#include <errno.h>
 #include <thread.h>
 #include <task.h>
 #include <scheduler.h>
@@ -29,13 +30,65 @@
 #include <rt_timer.h>
 #include <kmagics.h>
 
+static void alarm_wheel_add(struct alarm_s *alarm, struct alarm_info_s *info)
+{
+	register uint_t expire;
+	register uint_t delta;
+	register uint_t level;
+	register uint_t index;
+
+	expire = info->tm_wakeup;
+	delta  = expire - alarm->tm_now;
+
+	if((sint_t)delta < 0)
+	{
+		level = 0;
+		index = alarm->tm_now & ALARM_WHEEL_MASK;
+	}
+	else
+	{
+		if(delta >= ALARM_WHEEL_SPAN)
+		{
+			/* Parked on the last level, it will be cascaded again */
+			delta  = ALARM_WHEEL_SPAN - 1;
+			expire = alarm->tm_now + delta;
+		}
+
+		for(level = 0; level < (ALARM_WHEEL_LEVELS - 1); level++)
+		{
+			if(delta < (1U << ((level + 1) * ALARM_WHEEL_BITS)))
+				break;
+		}
+
+		index = (expire >> (level * ALARM_WHEEL_BITS)) & ALARM_WHEEL_MASK;
+	}
+
+	list_add_last(&alarm->wheel[level][index], &info->list);
+}
+
+static void alarm_wheel_cascade(struct alarm_s *alarm, uint_t level, uint_t index)
+{
+	register struct alarm_info_s *info;
+	struct list_entry root;
+
+	if(list_empty(&alarm->wheel[level][index]))
+		return;
+
+	list_replace(&alarm->wheel[level][index], &root);
+	list_root_init(&alarm->wheel[level][index]);
+
+	while(!(list_empty(&root)))
+	{
+		info = list_first(&root, struct alarm_info_s, list);
+		list_unlink(&info->list);
+		alarm_wheel_add(alarm, info);
+	}
+}
+
 error_t alarm_wait(struct alarm_info_s *info, uint_t msec)
 {
-	register uint_t tm_now;
 	struct cpu_s *cpu;
 	struct alarm_s *alarm_mgr;
-	struct list_entry *iter;
-	struct alarm_info_s *current;
 	uint_t irq_state;
 
 	cpu       = current_cpu;
@@ -43,57 +96,217 @@ error_t alarm_wait(struct alarm_info_s *info, uint_t msec)
 
 	cpu_disable_all_irq(&irq_state);
 
-	tm_now          = cpu_get_ticks(cpu) * MSEC_PER_TICK;
 	info->signature = ALRM_INFO_ID;
-	info->tm_wakeup = tm_now + msec;
+	info->tm_wakeup = cpu_get_ticks(cpu) + ((msec + MSEC_PER_TICK - 1) / MSEC_PER_TICK);
+	info->state     = ALARM_PENDING;
+	info->mgr       = alarm_mgr;
 
-	if(list_empty(&alarm_mgr->wait_queue))
-		list_add_first(&alarm_mgr->wait_queue, &info->list);
-	else
+	alarm_wheel_add(alarm_mgr, info);
+	alarm_mgr->count ++;
+
+	cpu_restore_irq(irq_state);
+	return 0;
+}
+
+error_t alarm_cancel(struct alarm_info_s *info)
+{
+	uint_t irq_state;
+	error_t err;
+
+	cpu_disable_all_irq(&irq_state);
+
+	switch(info->state)
 	{
-		list_foreach_forward(&alarm_mgr->wait_queue, iter)
-		{
-			current = list_element(iter, struct alarm_info_s, list);
-      
-			if(info->tm_wakeup <= current->tm_wakeup) 
-			{
-				list_add_pred(iter, &info->list);
-				goto NEXT_TRAITMENT;
-			}
-		}
-		list_add_last(&alarm_mgr->wait_queue, &info->list);
+	case ALARM_PENDING:
+		assert((info->mgr == &current_cpu->alarm_mgr) && "Remote alarm cancel");
+		list_unlink(&info->list);
+		info->mgr->count --;
+		info->state = ALARM_IDLE;
+		err = 0;
+		break;
+
+	case ALARM_DETACHED:
+		info->state = ALARM_IDLE;
+		err = 0;
+		break;
+
+	default:
+		err = ENOENT;
+	}
+
+	cpu_restore_irq(irq_state);
+	return err;
+}
+
+error_t alarm_detach(struct alarm_info_s *info)
+{
+	uint_t irq_state;
+	uint_t ticks;
+
+	cpu_disable_all_irq(&irq_state);
+
+	if(info->state != ALARM_PENDING)
+	{
+		cpu_restore_irq(irq_state);
+		return ENOENT;
 	}
 
-NEXT_TRAITMENT:
+	assert((info->mgr == &current_cpu->alarm_mgr) && "Remote alarm detach");
+
+	ticks = cpu_get_ticks(current_cpu);
+	list_unlink(&info->list);
+	info->mgr->count --;
+	info->tm_remain = ((sint_t)(info->tm_wakeup - ticks) > 0) ? info->tm_wakeup - ticks : 0;
+	info->mgr       = NULL;
+	info->state     = ALARM_DETACHED;
+
 	cpu_restore_irq(irq_state);
 	return 0;
 }
 
+error_t alarm_attach(struct alarm_info_s *info)
+{
+	struct cpu_s *cpu;
+	struct alarm_s *alarm_mgr;
+	uint_t irq_state;
+
+	cpu       = current_cpu;
+	alarm_mgr = &cpu->alarm_mgr;
+
+	cpu_disable_all_irq(&irq_state);
+
+	if(info->state != ALARM_DETACHED)
+	{
+		cpu_restore_irq(irq_state);
+		return ENOENT;
+	}
+
+	info->tm_wakeup = cpu_get_ticks(cpu) + info->tm_remain;
+	info->state     = ALARM_PENDING;
+	info->mgr       = alarm_mgr;
+
+	alarm_wheel_add(alarm_mgr, info);
+	alarm_mgr->count ++;
+
+	cpu_restore_irq(irq_state);
+	return 0;
+}
+
+/* to be called with interrupts disabled */
 void alarm_clock(struct alarm_s *alarm, uint_t ticks_nr)
 {
-	register uint_t tm_msec;
-	register struct list_entry *iter;
 	register struct alarm_info_s *info;
-  
-	tm_msec = ticks_nr * MSEC_PER_TICK;
+	register struct list_entry *root;
+	register uint_t tm_now;
+	register uint_t level;
+	register uint_t index;
+
+	while((sint_t)(ticks_nr - alarm->tm_now) >= 0)
+	{
+		if(alarm->count == 0)
+		{
+			alarm->tm_now = ticks_nr + 1;
+			break;
+		}
+
+		tm_now = alarm->tm_now;
+		index  = tm_now & ALARM_WHEEL_MASK;
+
+		for(level = 1; (index == 0) && (level < ALARM_WHEEL_LEVELS); level++)
+		{
+			index = (tm_now >> (level * ALARM_WHEEL_BITS)) & ALARM_WHEEL_MASK;
+			alarm_wheel_cascade(alarm, level, index);
+		}
+
+		root = &alarm->wheel[0][tm_now & ALARM_WHEEL_MASK];
+
+		while(!(list_empty(root)))
+		{
+			info = list_first(root, struct alarm_info_s, list);
+
+			assert((info->signature == ALRM_INFO_ID) && "Not an ALRM info object");
+
+			list_unlink(&info->list);
+			alarm->count --;
+			info->state = ALARM_IDLE;
+			info->mgr   = NULL;
+			event_send(info->event, current_cpu->gid);
+		}
+
+		alarm->tm_now = tm_now + 1;
+	}
+}
+
+error_t alarm_next_deadline(struct alarm_s *alarm, uint_t *ticks_nr)
+{
+	register struct alarm_info_s *info;
+	register struct list_entry *iter;
+	register struct list_entry *root;
+	register uint_t level;
+	register uint_t index;
+	register uint_t i;
+	register uint_t next;
+	register bool_t found;
+
+	if(alarm->count == 0)
+		return ENOENT;
+
+	found = false;
+	next  = 0;
+
+	/* Level 0 slots hold exact dates, the first non-empty one wins */
+	for(i = 0; i < ALARM_WHEEL_SIZE; i++)
+	{
+		if(!(list_empty(&alarm->wheel[0][(alarm->tm_now + i) & ALARM_WHEEL_MASK])))
+		{
+			next  = alarm->tm_now + i;
+			found = true;
+			break;
+		}
+	}
 
-	list_foreach_forward(&alarm->wait_queue, iter)
+	/* Upper levels: scan the first non-empty slot of each level */
+	for(level = 1; level < ALARM_WHEEL_LEVELS; level++)
 	{
-		info = list_element(iter, struct alarm_info_s, list);
+		index = (alarm->tm_now >> (level * ALARM_WHEEL_BITS)) & ALARM_WHEEL_MASK;
 
-		assert((info->signature == ALRM_INFO_ID) && "Not an ALRM info object");
+		for(i = 1; i <= ALARM_WHEEL_SIZE; i++)
+		{
+			root = &alarm->wheel[level][(index + i) & ALARM_WHEEL_MASK];
+
+			if(list_empty(root))
+				continue;
+
+			list_foreach(root, iter)
+			{
+				info = list_element(iter, struct alarm_info_s, list);
 
-		if(tm_msec < info->tm_wakeup)
+				if((found == false) || ((sint_t)(info->tm_wakeup - next) < 0))
+				{
+					next  = info->tm_wakeup;
+					found = true;
+				}
+			}
 			break;
-    
-		list_unlink(iter);
-		event_send(info->event, current_cpu->gid);
+		}
 	}
+
+	*ticks_nr = next;
+	return 0;
 }
 
 error_t alarm_manager_init(struct alarm_s *alarm)
 {
-	list_root_init(&alarm->wait_queue);
+	register uint_t level;
+	register uint_t index;
+
+	alarm->tm_now = 0;
+	alarm->count  = 0;
+
+	for(level = 0; level < ALARM_WHEEL_LEVELS; level++)
+		for(index = 0; index < ALARM_WHEEL_SIZE; index++)
+			list_root_init(&alarm->wheel[level][index]);
+
 	return 0;
 }
 
@@ -29,6 +29,18 @@
 
 struct event_s;
 
+/** Alarm states */
+#define ALARM_IDLE          0
+#define ALARM_PENDING       1
+#define ALARM_DETACHED      2
+
+/** Hierarchical timing wheel geometry */
+#define ALARM_WHEEL_BITS    6
+#define ALARM_WHEEL_SIZE    (1 << ALARM_WHEEL_BITS)
+#define ALARM_WHEEL_MASK    (ALARM_WHEEL_SIZE - 1)
+#define ALARM_WHEEL_LEVELS  4
+#define ALARM_WHEEL_SPAN    (1U << (ALARM_WHEEL_BITS * ALARM_WHEEL_LEVELS))
+
 struct alarm_info_s 
 {
 	uint_t signature;
@@ -37,13 +49,18 @@ struct alarm_info_s
 	struct event_s *event;
 
 	/* Private members */
-	uint_t tm_wakeup;
+	uint_t state;
+	uint_t tm_wakeup;		/* expiry date in ticks */
+	uint_t tm_remain;		/* remaining ticks while detached */
+	struct alarm_s *mgr;		/* wheel holding this alarm */
 	struct list_entry list;
 };
 
 struct alarm_s
 { 
-	struct list_entry wait_queue;
+	uint_t tm_now;			/* next tick to be processed */
+	uint_t count;			/* number of pending alarms */
+	struct list_entry wheel[ALARM_WHEEL_LEVELS][ALARM_WHEEL_SIZE];
 };
 
 
@@ -58,8 +75,31 @@ struct timeb {
 error_t alarm_manager_init(struct alarm_s *alarm);
 error_t alarm_wait(struct alarm_info_s *info, uint_t msec);
 
+/** 
+ * Cancel a pending alarm before its expiry, must be called
+ * on the CPU where the alarm has been armed. Return ENOENT
+ * if the alarm has already fired or was never armed.
+ */
+error_t alarm_cancel(struct alarm_info_s *info);
+
+/** 
+ * Remove a pending alarm from the current CPU wheel keeping its
+ * remaining delay, used by thread_migrate before leaving the CPU.
+ */
+error_t alarm_detach(struct alarm_info_s *info);
+
+/** Rearm a detached alarm on the current CPU wheel */
+error_t alarm_attach(struct alarm_info_s *info);
+
 void alarm_clock(struct alarm_s *alarm, uint_t ticks_nr);
 
+/** 
+ * Get the date (in ticks) of the nearest pending alarm,
+ * return ENOENT if there is no pending alarm.
+ * Must be called with interrupts disabled.
+ */
+error_t alarm_next_deadline(struct alarm_s *alarm, uint_t *ticks_nr);
+
 int sys_clock (uint64_t *val);
 int sys_alarm (unsigned nb_sec);
 int sys_ftime(struct timeb *utime);
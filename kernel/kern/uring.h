@@ -0,0 +1,126 @@
+/*
+ * kern/uring.h - Asynchronous system call ring
+ * 
+ * Copyright (c) 2008,2009,2010,2011,2012 Ghassan Almaless
+ * Copyright (c) 2011,2012 UPMC Sorbonne Universites
+ *
+ * This file is part of ALMOS-kernel.
+ *
+ * ALMOS-kernel is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2.0 of the License.
+ *
+ * ALMOS-kernel is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with ALMOS-kernel; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef _URING_H_
+#define _URING_H_
+
+#include <types.h>
+
+/* 
+ * A ring is allocated by the task in its own address space and shared
+ * with the kernel.  The task produces submission entries (sqes) at
+ * sq_tail, the kernel consumes them at sq_head and produces completion
+ * entries (cqes) at cq_tail, that the task consumes at cq_head.  Both
+ * queues have the same number of entries, which is a power of two.
+ *
+ * Entries are either consumed inline by URING_ENTER, several per trap,
+ * or by a worker thread of the task that called URING_WORKER and stays
+ * in the kernel serving the ring.  kflags is written by the kernel and
+ * uflags by the task threads, with atomic operations.  A kernel thread
+ * only consumes the ring once it has claimed it, by a CAS on kflags
+ * setting URING_KBUSY (inline) or URING_WORKER_ON (worker) while both
+ * are clear, and then is the only writer of kflags, sq_head and cq_tail
+ * until it releases the claim; but for URING_KWAIT, which a task thread
+ * sets by a CAS while URING_KBUSY is held to sleep on the kflags futex
+ * until the release.  When there is
+ * nothing to do, the worker sets URING_WORKER_IDLE and sleeps on the
+ * sq_tail futex; when the completion queue is full, it sets
+ * URING_CQ_FULL and sleeps on the cq_head futex.  A task thread waiting
+ * for completions adds URING_CQ_WAITER and sleeps on the cq_tail futex.
+ */
+
+/* Must match <sys/uring.h> */
+typedef enum
+{
+	URING_OP_NOP,
+	URING_OP_READ,
+	URING_OP_WRITE,
+	URING_OP_PREAD,
+	URING_OP_PWRITE,
+	URING_OP_OPEN,
+	URING_OP_CLOSE,
+	URING_OP_STAT,
+	URING_OP_FSYNC,
+	URING_OP_NR
+} uring_opcode_t;
+
+typedef enum
+{
+	URING_ENTER,
+	URING_WORKER
+} uring_operation_t;
+
+/* kflags */
+#define URING_WORKER_ON     0x01
+#define URING_WORKER_IDLE   0x02
+#define URING_CQ_FULL       0x04
+#define URING_KBUSY         0x08
+#define URING_KWAIT         0x10
+
+/* uflags, the upper bits count the task threads waiting for completions */
+#define URING_WORKER_STOP   0x01
+#define URING_CQ_WAITER     0x100
+#define URING_CQ_WAIT       0xFFFFFF00
+
+#define URING_ENTRIES_MAX   4096
+
+/* open: addr is the path, len the flags, offset the mode.
+ * stat: addr is the stat buffer, addr2 the path (fd is -1) */
+struct uring_sqe_s
+{
+	uint_t opcode;
+	sint_t fd;
+	void *addr;
+	void *addr2;
+	uint_t len;
+	uint_t offset;
+	uint_t user_data;
+	uint_t pad;
+};
+
+struct uring_cqe_s
+{
+	uint_t user_data;
+	sint_t res;		/* result or -errno */
+};
+
+struct uring_s
+{
+	volatile uint_t sq_head;
+	volatile uint_t sq_tail;
+	volatile uint_t cq_head;
+	volatile uint_t cq_tail;
+	volatile uint_t kflags;
+	volatile uint_t uflags;
+	uint_t entries;
+	struct uring_sqe_s *sqes;
+	struct uring_cqe_s *cqes;
+};
+
+/** 
+ * URING_ENTER: consume at most arg submissions inline and return their
+ * number, or only wake up the worker if there is one.
+ * URING_WORKER: serve the ring until URING_WORKER_STOP is set.
+ */
+int sys_uring(struct uring_s *ring, uint_t operation, uint_t arg);
+
+#endif	/* _URING_H_ */
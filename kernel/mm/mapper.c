@@ -571,10 +571,106 @@ ppn_t mapper_get_ppn(struct mapper_s* mapper, uint_t index, uint_t flags)
 	return ret;
 }
 
-error_t __mapper_request_(struct mapper_s* mapper, struct mapper_buff_s *buff, uint_t flags, char read)
+RPC_DECLARE(__mapper_get_ppns, 
+		RPC_RET(RPC_RET_PTR(error_t, err), RPC_RET_PTR(struct mapper_ppns_s, tbl)), 
+		RPC_ARG(RPC_ARG_VAL(struct mapper_s*, mapper),
+		RPC_ARG_VAL(size_t, offset),
+		RPC_ARG_VAL(size_t, size),
+		RPC_ARG_VAL(uint_t, flags)))
+{
+	struct page_s *page;
+	size_t isize;
+	size_t end;
+	uint_t index;
+
+	assert(mapper->m_inode);
+
+	*err        = 0;
+	tbl->size   = 0;
+	tbl->nb_ppn = 0;
+	isize       = mapper->m_inode->i_size;
+
+	if(offset >= isize)
+		return;
+
+	end = MIN(isize - offset, size) + offset;
+	end = MIN(end, (offset & ~PMM_PAGE_MASK) + MAPPER_PPNS_BATCH * PMM_PAGE_SIZE);
+
+	for(index = offset >> PMM_PAGE_SHIFT; (index << PMM_PAGE_SHIFT) < end; index++)
+	{
+		if((page = mapper_get_page(mapper, index, flags)) == NULL)
+		{
+			/* Keep the pages already held, if any */
+			if(tbl->nb_ppn == 0)
+				*err = current_thread->info.errno;
+			else
+				end = index << PMM_PAGE_SHIFT;
+			break;
+		}
+
+		page_refcount_up(page);
+		tbl->ppns[tbl->nb_ppn ++] = ppm_page2ppn(page);
+	}
+
+	if(tbl->nb_ppn)
+		tbl->size = end - offset;
+}
+
+error_t mapper_get_ppns(struct mapper_s* mapper, size_t offset, size_t size, uint_t flags, struct mapper_ppns_s *tbl)
+{
+	error_t err;
+
+	RCPC(mapper->m_home_cid, RPC_PRIO_MAPPER, __mapper_get_ppns,
+		RPC_RECV(RPC_RECV_OBJ(err), RPC_RECV_OBJ(*tbl)), 
+		RPC_SEND(RPC_SEND_OBJ(mapper->m_home),
+			RPC_SEND_OBJ(offset),
+			RPC_SEND_OBJ(size),
+			RPC_SEND_OBJ(flags)));
+
+	return err;
+}
+
+RPC_DECLARE(__mapper_put_ppns, 
+		RPC_RET(RPC_RET_PTR(error_t, err)), 
+		RPC_ARG(RPC_ARG_PTR(struct mapper_ppns_s, tbl)))
+{
+	uint_t i;
+
+	for(i = 0; i < tbl->nb_ppn; i++)
+	{
+		if(ppn_is_local(tbl->ppns[i]))
+			ppm_free_pages(ppm_ppn2page(&current_cluster->ppm, tbl->ppns[i]));
+		else
+			ppn_refcount_down(tbl->ppns[i]);
+	}
+
+	*err = 0;
+}
+
+void mapper_put_ppns(struct mapper_s* mapper, struct mapper_ppns_s *tbl)
+{
+	error_t err;
+
+	if(tbl->nb_ppn == 0)
+		return;
+
+	RCPC(mapper->m_home_cid, RPC_PRIO_MAPPER, __mapper_put_ppns,
+		RPC_RECV(RPC_RECV_OBJ(err)), 
+		RPC_SEND(RPC_SEND_MEM(tbl, sizeof(*tbl))));
+
+	tbl->nb_ppn = 0;
+}
+
+/* Copy between the mapper and a table of buffers in one pass.  When the
+ * first buffer carries a file, the transfer starts at the file offset,
+ * which is held (and advanced) for the whole table; otherwise it starts
+ * at data_offset and no offset lock is taken (pread/pwrite). */
+ssize_t __mapper_request_(struct mapper_s* mapper, struct mapper_buff_s *buff_tbl, 
+			  size_t nb_buff, uint_t flags, char read)
 {
 	struct vfs_inode_s *inode;
 	struct vfs_file_remote_s *file;
+	struct mapper_buff_s *buff;
 	struct page_s *page;
 	uint8_t *psrc;
 	uint8_t *preq;
@@ -583,89 +679,120 @@ error_t __mapper_request_(struct mapper_s* mapper, struct mapper_buff_s *buff, u
 	size_t csize;//slice to copy size
 	size_t rsize;//slice request size
 	size_t ssize;//slice source size
+	size_t done;
 	uint_t current_offset;
 	uint_t buff_offset;
+	uint_t i;
 	cid_t req_cid;
+	error_t err;
  
-	bsize		= buff->size;
-	file		= buff->file;
-	if(bsize == 0) return 0;
-
+	file		= buff_tbl[0].file;
+	page		= NULL;
+	done		= 0;
+	err		= 0;
 
 	if(file)
 	{
 		rwlock_wrlock(&file->fr_rwlock);
 		current_offset	= file->fr_offset;
 	}else
-		current_offset	= buff->data_offset;
-
-	buff_offset	= buff->buff_offset;
-	ssize		= 0;
-	rsize		= 0;
-	preq		= NULL;
-	psrc		= NULL;
-	req_cid		= 0;//CID_HOLE
+		current_offset	= buff_tbl[0].data_offset;
 
 	assert(mapper->m_inode);
 	inode		= mapper->m_inode;
 
+	for(i = 0; i < nb_buff; i++)
+	{
+		buff		= &buff_tbl[i];
+		bsize		= buff->size;
+		buff_offset	= buff->buff_offset;
+		ssize		= 0;
+		rsize		= 0;
+		preq		= NULL;
+		psrc		= NULL;
+		req_cid		= 0;//CID_HOLE
+
+		if(read) isize	= inode->i_size;//synchro ?
+		else isize = current_offset + bsize;
+
+		while((bsize > 0) && (current_offset < isize)) 
+		{
+			assert(!(ssize && rsize));//they cannot be both full
 
-	if(read) isize	= inode->i_size;//synchro ?
-	else isize = current_offset + bsize;
+			if(!ssize)
+			{
+				if(page != NULL)
+					ppm_free_pages(page);
+
+				/* Only the lookup is serialized, the page being
+				 * held by a reference while it is copied */
+				spinlock_lock(&mapper->m_cache_lock);
+				page = mapper_get_page(mapper,
+						       current_offset >> PMM_PAGE_SHIFT, 
+						       MAPPER_SYNC_OP);
+				if(page != NULL)
+					page_refcount_up(page);
+				spinlock_unlock(&mapper->m_cache_lock);
 
-	while((bsize > 0) && (current_offset < isize)) 
-	{
-		assert(!(ssize && rsize));//they cannot be both full
+				if (page == NULL)
+				{
+					err = VFS_IO_ERR;
+					goto MAPPER_REQUEST_END;
+				}
 
-		if(!ssize)
-		{
-			if ((page = mapper_get_page(mapper,
-						    current_offset >> PMM_PAGE_SHIFT, 
-						    MAPPER_SYNC_OP)) == NULL)
-				return -VFS_IO_ERR;
-
-			psrc  = (uint8_t*) ppm_page2addr(page);
-			psrc += current_offset % PMM_PAGE_SIZE;
-			ssize = ((isize - current_offset) > PMM_PAGE_SIZE) ? 
-				PMM_PAGE_SIZE : (isize - current_offset);
-		}
+				psrc  = (uint8_t*) ppm_page2addr(page);
+				psrc += current_offset % PMM_PAGE_SIZE;
+				ssize = MIN(PMM_PAGE_SIZE - (current_offset % PMM_PAGE_SIZE), 
+					    isize - current_offset);
+			}
 
-		if(!rsize)
-		{
-			preq		= (void*)ppn_ppn2vma(buff->buff_ppns[buff_offset >> PMM_PAGE_SHIFT]);
-			preq		+= buff_offset % PMM_PAGE_SIZE;
-			req_cid		= ppn_ppn2cid(buff->buff_ppns[buff_offset >> PMM_PAGE_SHIFT]);
-			rsize		= MIN(PMM_PAGE_SIZE - (buff_offset%PMM_PAGE_SIZE), bsize);
-		}
+			if(!rsize)
+			{
+				preq		= (void*)ppn_ppn2vma(buff->buff_ppns[buff_offset >> PMM_PAGE_SHIFT]);
+				preq		+= buff_offset % PMM_PAGE_SIZE;
+				req_cid		= ppn_ppn2cid(buff->buff_ppns[buff_offset >> PMM_PAGE_SHIFT]);
+				rsize		= MIN(PMM_PAGE_SIZE - (buff_offset%PMM_PAGE_SIZE), bsize);
+			}
     
-		csize = MIN(rsize, ssize);
+			csize = MIN(rsize, ssize);
 		
-		//copy to preq
-		//buffer->scpy_to_buff(buffer, psrc, csize);
-		if(read)
-			remote_memcpy(preq, req_cid, psrc, current_cid, csize);
-		else
-			remote_memcpy(psrc, current_cid, preq, req_cid, csize);
+			if(read)
+				remote_memcpy(preq, req_cid, psrc, current_cid, csize);
+			else
+				remote_memcpy(psrc, current_cid, preq, req_cid, csize);
+
+			psrc += csize;
+			preq += csize;
+			rsize -= csize;
+			ssize -= csize;
+			bsize -= csize;
+			current_offset	+= csize;
+			buff_offset	+= csize;
+		}
 
-		rsize -= csize;
-		ssize -= csize;
-		bsize -= csize;
-		current_offset	+= csize;
-		buff_offset	+= csize;
-		
-		//if(thread_sched_isActivated(current_thread))
-		//	sched_yield(current_thread);
+		done += buff->size - bsize;
+
+		/* End of file */
+		if(bsize) break;
 	}
 
+MAPPER_REQUEST_END:
+	if(page != NULL)
+		ppm_free_pages(page);
+
 	//TODO: update atime ...
+	/* Concurrent writers no longer hold the cache lock while copying,
+	 * the size only grows under it */
+	spinlock_lock(&mapper->m_cache_lock);
 	if(current_offset > inode->i_size)
 	{
-		inode->i_size = current_offset;//synchro ?
+		inode->i_size = current_offset;
 		//TODO if flags & SYNC or ...
 		cpu_wbflush();
 		VFS_SET(inode->i_state, VFS_DIRTY);//synch ?
 		cpu_wbflush();
 	}
+	spinlock_unlock(&mapper->m_cache_lock);
 	
 	if(file)
 	{
@@ -673,62 +800,70 @@ error_t __mapper_request_(struct mapper_s* mapper, struct mapper_buff_s *buff, u
 		rwlock_unlock(&file->fr_rwlock);
 	}	
 
-	return buff->size - bsize;
+	return ((err) && (done == 0)) ? -err : (ssize_t)done;
 }
-#define MAPPER_OP_FIRST 0x1
-#define MAPPER_OP_LAST	0x2
-#define MAPPER_OP_READ	0x4
 
-//FIXME: tacking lock over multiple buffer!
-RPC_DECLARE(__mapper_request, RPC_RET(RPC_RET_PTR(size_t, size)), 
+#define MAPPER_OP_READ	   0x1
+#define MAPPER_OP_SHIFT	   8
+
+RPC_DECLARE(__mapper_request, RPC_RET(RPC_RET_PTR(ssize_t, size)), 
 		RPC_ARG(RPC_ARG_VAL(struct mapper_s*, mapper), 
 			RPC_ARG_PTR(struct mapper_buff_s, mp_buffs), 
 			RPC_ARG_PTR(ppn_t, ppns), 
 			RPC_ARG_VAL(uint_t, flags),
 			RPC_ARG_VAL(uint_t, op_flag)))
 {
-	mp_buffs->buff_ppns = ppns;
+	size_t nb_buff;
+	uint_t i;
 
-	if(op_flag & MAPPER_OP_FIRST)
-		spinlock_lock(&mapper->m_cache_lock);
+	nb_buff = op_flag >> MAPPER_OP_SHIFT;
 
-	*size = __mapper_request_(mapper, mp_buffs, flags, op_flag & MAPPER_OP_READ);
-	
-	if(op_flag & MAPPER_OP_LAST)
-		spinlock_unlock(&mapper->m_cache_lock);
+	/* The ppns of all the buffers were sent as one table */
+	for(i = 0; i < nb_buff; i++)
+	{
+		mp_buffs[i].buff_ppns = ppns;
+		ppns += mp_buffs[i].max_ppns;
+	}
+
+	*size = __mapper_request_(mapper, mp_buffs, nb_buff, flags, op_flag & MAPPER_OP_READ);
 }
 
-//FIXME improve (for multiple buff)...
-error_t mapper_request(struct mapper_s* mapper, struct mapper_buff_s *mp_buffs, size_t nb_buff, char read, uint_t flags)
+/* The buff_ppns of mp_buffs must be consecutive slices of one table,
+ * starting at mp_buffs[0].buff_ppns, so that the whole request is
+ * shipped to the mapper home cluster in a single RPC.  The caller keeps
+ * the request within RPC_ALLOCATE_ON_STACK_SZ (see vfs_mapper_rw). */
+ssize_t mapper_request(struct mapper_s* mapper, struct mapper_buff_s *mp_buffs, size_t nb_buff, char read, uint_t flags)
 {
-	size_t size;
+	ssize_t size;
 	uint_t op_flag;
+	size_t nb_ppns;
 	uint_t i;
 
-	op_flag = MAPPER_OP_FIRST;
+	if(nb_buff == 0) return 0;
+
+	op_flag = nb_buff << MAPPER_OP_SHIFT;
 	if(read) op_flag |= MAPPER_OP_READ;
-	for(i=0; i < nb_buff; i++)
-	{
-		if(i == (nb_buff-1))
-			op_flag |= MAPPER_OP_LAST;
-		RCPC(mapper->m_home_cid, RPC_PRIO_MAPPER, __mapper_request,
-					RPC_RECV(RPC_RECV_OBJ(size)), 
-					RPC_SEND(RPC_SEND_OBJ(mapper->m_home),
-						RPC_SEND_MEM(mp_buffs, sizeof(struct mapper_buff_s)),
-						RPC_SEND_MEM(mp_buffs->buff_ppns, sizeof(ppn_t)*mp_buffs->max_ppns),
-						RPC_SEND_OBJ(flags), RPC_SEND_OBJ(op_flag)));
-	}
+
+	for(nb_ppns = 0, i = 0; i < nb_buff; i++)
+		nb_ppns += mp_buffs[i].max_ppns;
+
+	RCPC(mapper->m_home_cid, RPC_PRIO_MAPPER, __mapper_request,
+				RPC_RECV(RPC_RECV_OBJ(size)), 
+				RPC_SEND(RPC_SEND_OBJ(mapper->m_home),
+					RPC_SEND_MEM(mp_buffs, sizeof(struct mapper_buff_s)*nb_buff),
+					RPC_SEND_MEM(mp_buffs[0].buff_ppns, sizeof(ppn_t)*nb_ppns),
+					RPC_SEND_OBJ(flags), RPC_SEND_OBJ(op_flag)));
 	return size;
 }
 
 //Atomically read from the mapper content
-size_t mapper_read(struct mapper_s* mapper, struct mapper_buff_s *mp_buffs, size_t nb_buff, uint_t flags)
+ssize_t mapper_read(struct mapper_s* mapper, struct mapper_buff_s *mp_buffs, size_t nb_buff, uint_t flags)
 {
 	return mapper_request(mapper, mp_buffs, nb_buff, 1, flags);
 }
 
 //Atomically write to the mapper content
-size_t mapper_write(struct mapper_s* mapper, struct mapper_buff_s *mp_buffs, size_t nb_buff, uint_t flags)
+ssize_t mapper_write(struct mapper_s* mapper, struct mapper_buff_s *mp_buffs, size_t nb_buff, uint_t flags)
 {
 	return mapper_request(mapper, mp_buffs, nb_buff, 0, flags);
 }
@@ -116,6 +116,14 @@ struct mapper_buff_s{
 	ppn_t *buff_ppns;
 };
 
+/* Pages of a mapper held by mapper_get_ppns */
+#define MAPPER_PPNS_BATCH	16
+
+struct mapper_ppns_s{
+	size_t size;
+	uint_t nb_ppn;
+	ppn_t ppns[MAPPER_PPNS_BATCH];
+};
 
 #define MAPPER_IS_MIGRATABLE(mapper)	\
 	(MAPPER_IS_HOME(mapper) \
@@ -147,11 +155,20 @@ error_t mapper_init(struct mapper_s *mapper,
 //similar to mapper_get_page but also hold the refcount!
 ppn_t mapper_get_ppn(struct mapper_s* mapper, uint_t index, uint_t flags);
 
-//Atomically read from the mapper content
-size_t mapper_read(struct mapper_s* mapper, struct mapper_buff_s *buff_tbl, size_t nb_buff, uint_t flags);
+//Get and hold, in a single request, the pages backing at most size
+//bytes from offset, up to the end of file and MAPPER_PPNS_BATCH pages.
+//tbl->size is set to the number of bytes they hold (0 at end of file)
+error_t mapper_get_ppns(struct mapper_s* mapper, size_t offset, size_t size, uint_t flags, struct mapper_ppns_s *tbl);
+
+//Release the pages held by mapper_get_ppns
+void mapper_put_ppns(struct mapper_s* mapper, struct mapper_ppns_s *tbl);
+
+//Atomically read from the mapper content, the ppns of all the buffers
+//being consecutive slices of one table
+ssize_t mapper_read(struct mapper_s* mapper, struct mapper_buff_s *buff_tbl, size_t nb_buff, uint_t flags);
 
-//Atomically write to the mapper content
-size_t mapper_write(struct mapper_s* mapper, struct mapper_buff_s *buff_tbl, size_t nb_buff, uint_t flags);
+//Atomically write to the mapper content (same layout as mapper_read)
+ssize_t mapper_write(struct mapper_s* mapper, struct mapper_buff_s *buff_tbl, size_t nb_buff, uint_t flags);
 
 
 //
@@ -435,6 +435,16 @@ error_t vmm_set_auto_migrate(struct vmm_s *vmm, uint_t start, uint_t flags)
 	region = vm_region_find(vmm, start);
 	rwlock_unlock(&vmm->rwlock);
   
+	if(flags & MGRT_THREAD_STACK)
+	{
+		/* Stack and signal stack of one thread, which share a region */
+		if((region == NULL) || (region->vm_start > start) ||
+		   !(region->vm_flags & VM_REG_STACK))
+			return ESRCH;
+
+		return vmm_madvise_migrate(vmm, region->vm_start, region->vm_limit - region->vm_start);
+	}
+
 	if((region == NULL) || (region->vm_start < start))
 		return ESRCH;
 
@@ -461,6 +471,70 @@ error_t vmm_set_auto_migrate(struct vmm_s *vmm, uint_t start, uint_t flags)
 	return 0;
 }
 
+/* 
+ * Replace the page of ppn old, mapped at vaddr in a private anonymous
+ * region, by the page of ppn new whose reference is given to the vmm.
+ * The old page is then released.  Fail with EAGAIN if the mapping has
+ * changed meanwhile or is still shared (COW).
+ */
+error_t vmm_swap_page(struct vmm_s *vmm, uint_t vaddr, ppn_t old, ppn_t new)
+{
+	struct vm_region_s *region;
+	pmm_page_info_t current;
+	pmm_page_info_t info;
+	error_t err;
+
+	rwlock_rdlock(&vmm->rwlock);
+	region = vm_region_find(vmm, vaddr);
+
+	if((region == NULL) || 
+	   (vaddr < region->vm_start) || (vaddr >= region->vm_limit) ||
+	   ((region->vm_flags & VM_REG_PVSH) != VM_REG_PRIVATE) ||
+	   !(region->vm_flags & VM_REG_ANON) ||
+	   !(region->vm_prot & VM_REG_WR))
+	{
+		err = EINVAL;
+		goto SWAP_END;
+	}
+
+	if((err = pmm_lock_page(&vmm->pmm, vaddr, &current)))
+		goto SWAP_END;
+
+	if((current.isAtomic == false) || (current.ppn != old)  ||
+	   !(current.attr & PMM_PRESENT) || !(current.attr & PMM_WRITE) ||
+	   (current.attr & (PMM_COW | PMM_MIGRATE)))
+	{
+		(void)pmm_unlock_page(&vmm->pmm, vaddr, &current);
+		err = EAGAIN;
+		goto SWAP_END;
+	}
+
+	info.attr    = region->vm_pgprot | PMM_WRITE;
+	info.attr   &= ~(PMM_COW | PMM_MIGRATE);
+	info.ppn     = new;
+	info.cluster = NULL;
+
+	//this also unlock the table entry (if no error)
+	if((err = pmm_set_page(&vmm->pmm, vaddr, &info)))
+	{
+		(void)pmm_unlock_page(&vmm->pmm, vaddr, &current);
+		goto SWAP_END;
+	}
+
+	pmm_tlb_flush_vaddr(vaddr, PMM_DATA);
+
+	if(!ppn_is_local(new))
+		current_thread->info.remote_pages_cntr ++;
+
+SWAP_END:
+	rwlock_unlock(&vmm->rwlock);
+
+	if(err == 0)
+		ppn_refcount_down(old);
+
+	return err;
+}
+
 error_t vmm_madvise_willneed(struct vmm_s *vmm, uint_t start, uint_t len)
 {
 	register error_t err;
@@ -97,6 +97,7 @@ struct vmm_s
 
 #define MGRT_DEFAULT       0x0
 #define MGRT_STACK         0x1
+#define MGRT_THREAD_STACK  0x2  /* only the stack region holding start */
 
 typedef struct mmap_attr_s
 {
@@ -140,6 +141,9 @@ error_t vmm_madvise_willneed(struct vmm_s *vmm, uint_t start, uint_t len);
 
 error_t vmm_set_auto_migrate(struct vmm_s *vmm, uint_t start, uint_t flags);
 
+/* Give the page of ppn new to the private page at vaddr, of ppn old */
+error_t vmm_swap_page(struct vmm_s *vmm, uint_t vaddr, ppn_t old, ppn_t new);
+
 /* Hypothesis: the region is shared-anon, mapper list is rdlocked, page is locked */
 error_t vmm_broadcast_inval(struct vm_region_s *region, struct page_s *page, struct page_s **new);
 
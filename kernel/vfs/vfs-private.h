@@ -76,6 +76,8 @@ struct vfs_file_s* vfs_file_get(struct vfs_context_s *ctx,
 struct vfs_file_remote_s* 
 vfs_file_remote_get(struct vfs_inode_s *inode);
 
+void vfs_file_remote_put(struct vfs_file_remote_s* fremote);
+
 sint_t vfs_file_remote_down(struct vfs_file_remote_s *file);
 
 /* dirent/inodes references count */
@@ -33,6 +33,11 @@
 #include <ppm.h>
 #include <cpu-trace.h>
 #include <kmem.h>
+#include <ppn.h>
+#include <cluster.h>
+#include <remote_access.h>
+#include <mapper.h>
+#include <poll.h>
 
 
 struct __vfs_stat_s
@@ -82,6 +87,12 @@ error_t vfs_stat(struct vfs_file_s *cwd, struct ku_obj *path, struct vfs_stat_s*
 
 	vfs_dmsg(1,"%s: called, isByPath %d\n", __FUNCTION__, !!file);
 
+	if((file != NULL) && (file->f_attr & VFS_PIPE))
+	{
+		vfs_pipe_stat(file, &stat.buff);
+		return cpu_copy_to_uspace(ustat, &stat.buff, sizeof(struct vfs_stat_s));
+	}
+
 	do{
 		if(!file)
 		{
@@ -470,61 +481,6 @@ error_t vfs_get_path(struct vfs_file_s *file, struct ku_obj *buff)
 
 
 
-//secondary
-error_t vfs_pipe(struct vfs_file_s *pipefd[2]) {
-#ifdef CONFIG_DRIVER_FS_PIPE
-	/* FIXME: CODE HERE IS SOMEHOW OBSOLET */
-	struct vfs_inode_s *node;
-	struct vfs_file_s *fd_in;
-	struct vfs_file_s *fd_out;
-
-	spinlock_lock(&vfs_node_freelist.lock);
-
-	if((node = vfs_node_freelist_get(vfs_pipe_ctx)) == NULL)
-	{
-		spinlock_unlock(&vfs_node_freelist.lock);
-		return ENOMEM;
-	}
-
-	spinlock_unlock(&vfs_node_freelist.lock);
-
-	VFS_SET(node->i_attr,VFS_PIPE);
-
-	vfs_dmsg(1,"vfs_pipe: got a node, do n_op->init(node)\n");
-	vfs_dmsg(1,"vfs_pipe: do n_op->init(node) OK\n");
-
-	vfs_node_up(node);
-	vfs_node_up(node);
-
-	node->i_readers = 1;
-	node->i_writers = 1;
-
-	if((fd_in = vfs_file_get(node)) == NULL)
-		goto VFS_PIPE_ERROR_FILE;
-
-	if((fd_out = vfs_file_freelist_get(node)) == NULL) {
-		vfs_file_freelist_add(fd_in);
-		goto VFS_PIPE_ERROR_FILE;
-	}
-
-	VFS_SET(fd_in->f_flags, VFS_O_PIPE | VFS_O_WRONLY);
-	VFS_SET(fd_out->f_flags,VFS_O_PIPE | VFS_O_RDONLY);
-	pipefd[0] = fd_out;
-	pipefd[1] = fd_in;
-	return 0;
-
-VFS_PIPE_ERROR_FILE:
-	spinlock_lock(&vfs_node_freelist.lock);
-	vfs_node_freelist_add(node,1);
-	spinlock_unlock(&vfs_node_freelist.lock);
-	return ENOMEM;
-
-#else
-	return ENOTSUPPORTED;
-#endif
-}
-
-
 //secondary
 error_t vfs_mkfifo(struct vfs_file_s *cwd, struct ku_obj *pathname, uint_t mode) {
 #ifdef CONFIG_DRIVER_FS_PIPE
@@ -842,6 +798,257 @@ VFS_WRITE_ERROR:
 	return size;
 }
 
+/* Positional and vectored I/O only go through the mapper for files
+ * using the default read/write methods, other files (devices, pipes)
+ * have no offset to start from. */
+#define VFS_HAS_MAPPER_IO(_file) ((_file)->f_op->read == vfs_default_read)
+
+ssize_t vfs_pread(struct vfs_file_s *file, struct ku_obj *buffer, size_t offset)
+{
+	if(VFS_IS(file->f_flags, VFS_O_DIRECTORY))
+		return -EISDIR;
+
+	if(!(VFS_IS(file->f_flags, VFS_O_RDONLY)))
+		return -EBADF;
+
+	if(!(VFS_HAS_MAPPER_IO(file)) || (file->f_attr & VFS_FIFO))
+		return -ESPIPE;
+
+	if(buffer->get_size(buffer) == 0)
+		return 0;
+
+	return vfs_mapper_rw(file, buffer, 1, true, offset, true);
+}
+
+ssize_t vfs_pwrite(struct vfs_file_s *file, struct ku_obj *buffer, size_t offset)
+{
+	if(VFS_IS(file->f_flags, VFS_O_DIRECTORY))
+		return -EISDIR;
+
+	if(!(VFS_IS(file->f_flags, VFS_O_WRONLY)))
+		return -EBADF;
+
+	if(!(VFS_HAS_MAPPER_IO(file)) || (file->f_attr & VFS_FIFO))
+		return -ESPIPE;
+
+	if(buffer->get_size(buffer) == 0)
+		return 0;
+
+	return vfs_mapper_rw(file, buffer, 1, true, offset, false);
+}
+
+static ssize_t vfs_rw_vector(struct vfs_file_s *file, struct ku_obj *buff_tbl, uint_t count, bool_t isRead)
+{
+	ssize_t size;
+	ssize_t done;
+	uint_t i;
+
+	if(VFS_HAS_MAPPER_IO(file) && !(file->f_attr & VFS_FIFO))
+		return vfs_mapper_rw(file, buff_tbl, count, false, 0, isRead);
+
+	for(done = 0, i = 0; i < count; i++)
+	{
+		if(buff_tbl[i].get_size(&buff_tbl[i]) == 0)
+			continue;
+
+		if(isRead)
+			size = file->f_op->read(file, &buff_tbl[i]);
+		else
+			size = file->f_op->write(file, &buff_tbl[i]);
+
+		if(size < 0)
+			return (done) ? done : size;
+
+		done += size;
+
+		if((size_t)size != buff_tbl[i].get_size(&buff_tbl[i]))
+			break;
+	}
+
+	return done;
+}
+
+ssize_t vfs_readv(struct vfs_file_s *file, struct ku_obj *buff_tbl, uint_t count)
+{
+	if(VFS_IS(file->f_flags, VFS_O_DIRECTORY))
+		return -EISDIR;
+
+	if(!(VFS_IS(file->f_flags, VFS_O_RDONLY)))
+		return -EBADF;
+
+	return vfs_rw_vector(file, buff_tbl, count, true);
+}
+
+ssize_t vfs_writev(struct vfs_file_s *file, struct ku_obj *buff_tbl, uint_t count)
+{
+	if(VFS_IS(file->f_flags, VFS_O_DIRECTORY))
+		return -EISDIR;
+
+	if(!(VFS_IS(file->f_flags, VFS_O_WRONLY)))
+		return -EBADF;
+
+	return vfs_rw_vector(file, buff_tbl, count, false);
+}
+
+/* Hand the source pages to the write method of a file that has no
+ * mapper (device, pipe).  Local pages are passed as they are, remote
+ * ones are staged in one local page first. */
+static ssize_t vfs_sendfile_write(struct vfs_file_s *out, 
+				  struct mapper_ppns_s *tbl, 
+				  size_t pg_offset,
+				  struct page_s **bounce)
+{
+	struct ku_obj kub;
+	kmem_req_t req;
+	uint8_t *src;
+	size_t chunk;
+	ssize_t size;
+	ssize_t done;
+	uint_t i;
+
+	for(done = 0, i = 0; (size_t)done < tbl->size; i++, pg_offset = 0)
+	{
+		chunk = MIN(PMM_PAGE_SIZE - pg_offset, tbl->size - done);
+
+		if(ppn_is_local(tbl->ppns[i]))
+		{
+			src  = ppm_page2addr(ppm_ppn2page(&current_cluster->ppm, tbl->ppns[i]));
+			src += pg_offset;
+		}
+		else
+		{
+			if(*bounce == NULL)
+			{
+				req.type  = KMEM_PAGE;
+				req.size  = 0;
+				req.flags = AF_KERNEL;
+
+				if((*bounce = kmem_alloc(&req)) == NULL)
+					return (done) ? done : -ENOMEM;
+			}
+
+			src = ppm_page2addr(*bounce);
+			remote_memcpy(src, current_cid, 
+				      (uint8_t*)ppn_ppn2vma(tbl->ppns[i]) + pg_offset, 
+				      ppn_ppn2cid(tbl->ppns[i]), chunk);
+		}
+
+		KK_SZ_BUFF(kub, src, chunk);
+
+		if((size = out->f_op->write(out, &kub)) < 0)
+			return (done) ? done : size;
+
+		done += size;
+
+		if((size_t)size != chunk)
+			break;
+	}
+
+	return done;
+}
+
+/* Copy count bytes of the page cache of in to out without crossing the
+ * user space: the source pages are held MAPPER_PPNS_BATCH at a time, and
+ * either copied page to page into the mapper of out (one request per
+ * batch) or given to its write method.  The transfer starts at *offset
+ * when given, which is then advanced instead of the offset of in. */
+ssize_t vfs_sendfile(struct vfs_file_s *out, struct vfs_file_s *in, size_t *offset, size_t count)
+{
+	struct mapper_ppns_s tbl;
+	struct mapper_buff_s mp_buff;
+	struct page_s *bounce;
+	kmem_req_t req;
+	size_t pos;
+	size_t done;
+	ssize_t size;
+	error_t err;
+
+	if(VFS_IS(in->f_flags, VFS_O_DIRECTORY) || VFS_IS(out->f_flags, VFS_O_DIRECTORY))
+		return -EISDIR;
+
+	if(!(VFS_IS(in->f_flags, VFS_O_RDONLY)) || !(VFS_IS(out->f_flags, VFS_O_WRONLY)))
+		return -EBADF;
+
+	if(!(VFS_HAS_MAPPER_IO(in)) || (in->f_attr & VFS_FIFO))
+		return -EINVAL;
+
+	if(offset != NULL)
+		pos = *offset;
+	else if((err = vfs_lseek(in, 0, VFS_SEEK_CUR, &pos)))
+		return -err;
+
+	bounce = NULL;
+	size   = 0;
+
+	for(done = 0; done < count; done += size)
+	{
+		if((err = mapper_get_ppns(&in->f_mapper, pos + done, count - done, MAPPER_SYNC_OP, &tbl)))
+		{
+			size = -err;
+			break;
+		}
+
+		if(tbl.size == 0)
+		{
+			size = 0;
+			break;
+		}
+
+		if(VFS_HAS_MAPPER_IO(out) && !(out->f_attr & VFS_FIFO))
+		{
+			mp_buff.file        = out->f_remote;
+			mp_buff.data_offset = 0;
+			mp_buff.size        = tbl.size;
+			mp_buff.buff_offset = (pos + done) & PMM_PAGE_MASK;
+			mp_buff.max_ppns    = tbl.nb_ppn;
+			mp_buff.buff_ppns   = &tbl.ppns[0];
+
+			size = mapper_write(&out->f_mapper, &mp_buff, 1, out->f_flags);
+		}
+		else
+			size = vfs_sendfile_write(out, &tbl, (pos + done) & PMM_PAGE_MASK, &bounce);
+
+		mapper_put_ppns(&in->f_mapper, &tbl);
+
+		if(size < 0)
+			break;
+
+		if((size_t)size != tbl.size)
+		{
+			done += size;
+			size  = 0;
+			break;
+		}
+	}
+
+	if(bounce != NULL)
+	{
+		req.type = KMEM_PAGE;
+		req.ptr  = bounce;
+		kmem_free(&req);
+	}
+
+	if((done == 0) && (size < 0))
+		return size;
+
+	if(offset != NULL)
+		*offset = pos + done;
+	else
+		vfs_lseek(in, pos + done, VFS_SEEK_SET, &pos);
+
+	return done;
+}
+
+/* Files without a poll method (regular files, most devices) never
+ * block, they are always ready */
+uint_t vfs_poll(struct vfs_file_s *file, struct poll_entry_s *entry)
+{
+	if(file->f_op->poll == NULL)
+		return POLLIN | POLLOUT;
+
+	return file->f_op->poll(file, entry);
+}
+
 error_t __vfs_lseek(struct vfs_file_remote_s *fremote, 
 	size_t offset, uint_t whence, size_t *new_offset_ptr)
 {
@@ -927,6 +1134,9 @@ error_t vfs_lseek(struct vfs_file_s *file, size_t offset, uint_t whence, size_t
 	if(VFS_IS(file->f_flags, VFS_O_DIRECTORY))
 		return EBADF;
 
+	if(file->f_attr & VFS_PIPE)
+		return ESPIPE;
+
 	RCPC(file->f_inode.cid, RPC_PRIO_FS, _vfs_lseek,
 				RPC_RECV(RPC_RECV_OBJ(err), RPC_RECV_OBJ(*new_offset_ptr)), 
 				RPC_SEND(
@@ -49,6 +49,7 @@ struct vm_region_s;
 struct vfs_dirent_s;
 struct vfs_lookup_request_s;
 struct vfs_lookup_response_s;
+struct poll_entry_s;
 
 //function to be executed remotly on the found dentry
 #define VFS_LOOKUP_FUNC(n) error_t (n)(struct vfs_dirent_s *dint,		\
@@ -315,6 +316,7 @@ struct vfs_dirent_op_s
 #define VFS_WRITE_FILE(n)   ssize_t (n) (struct vfs_file_s *file, struct ku_obj *buffer)
 #define VFS_MMAP_FILE(n)    error_t (n) (struct vfs_file_s *file, struct vm_region_s *region)
 #define VFS_MUNMAP_FILE(n)  error_t (n) (struct vfs_file_s *file, struct vm_region_s *region)
+#define VFS_POLL_FILE(n)    uint_t (n) (struct vfs_file_s *file, struct poll_entry_s *entry)
 
 
 typedef VFS_OPEN_FILE(vfs_open_file_t);
@@ -326,6 +328,7 @@ typedef VFS_RELEASE_FILE(vfs_release_file_t);
 typedef VFS_READ_DIR(vfs_read_dir_t);
 typedef VFS_MMAP_FILE(vfs_mmap_file_t);
 typedef VFS_MUNMAP_FILE(vfs_munmap_file_t);
+typedef VFS_POLL_FILE(vfs_poll_file_t);
 
 struct vfs_file_op_s
 {
@@ -338,6 +341,7 @@ struct vfs_file_op_s
 	vfs_release_file_t *release;
 	vfs_mmap_file_t *mmap;
 	vfs_munmap_file_t *munmap;
+	vfs_poll_file_t *poll;
 };
 
 /* Default/generic methods */
@@ -346,6 +350,16 @@ VFS_MMAP_FILE(vfs_default_munmap_file);
 VFS_READ_FILE(vfs_default_read);
 VFS_WRITE_FILE(vfs_default_write);
 
+/* Number of ppns a mapper transfer ships per RPC, on the kernel stack */
+#define VFS_PPNS_ON_STACK    64
+
+ssize_t vfs_mapper_rw(struct vfs_file_s *file, 
+		      struct ku_obj *buff_tbl, 
+		      uint_t count,
+		      bool_t isPositional,
+		      size_t offset,
+		      bool_t isRead);
+
 
 sint_t vfs_file_up(struct vfs_file_s *file);
 sint_t vfs_file_down(struct vfs_file_s *file);
@@ -375,6 +389,12 @@ error_t vfs_open(struct vfs_file_s *cwd,
 
 ssize_t vfs_read(struct vfs_file_s *file, struct ku_obj *buff);//ok: need cleaning
 ssize_t vfs_write (struct vfs_file_s *file, struct ku_obj *buff);//ok
+ssize_t vfs_pread(struct vfs_file_s *file, struct ku_obj *buff, size_t offset);
+ssize_t vfs_pwrite(struct vfs_file_s *file, struct ku_obj *buff, size_t offset);
+ssize_t vfs_readv(struct vfs_file_s *file, struct ku_obj *buff_tbl, uint_t count);
+ssize_t vfs_writev(struct vfs_file_s *file, struct ku_obj *buff_tbl, uint_t count);
+ssize_t vfs_sendfile(struct vfs_file_s *out, struct vfs_file_s *in, size_t *offset, size_t count);
+uint_t vfs_poll(struct vfs_file_s *file, struct poll_entry_s *entry);
 error_t vfs_lseek(struct vfs_file_s *file, size_t offset, uint_t whence, size_t *new_offset_ptr);//ok
 error_t vfs_close(struct vfs_file_s *file, uint_t *refcount);//ok
 error_t vfs_unlink(struct vfs_file_s *cwd, struct ku_obj *path);//ok
@@ -393,6 +413,7 @@ error_t vfs_closedir(struct vfs_file_s *file, uint_t *refcount);//ok
 
 /** Generic FIFO operations */
 error_t vfs_pipe(struct vfs_file_s *pipefd[2]);
+error_t vfs_pipe_stat(struct vfs_file_s *file, struct vfs_stat_s *stat);
 error_t vfs_mkfifo(struct vfs_file_s *cwd, struct ku_obj *path, uint_t mode);
 
 /** Caches functions **/
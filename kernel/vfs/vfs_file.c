@@ -249,77 +249,169 @@ VFS_MUNMAP_FILE(vfs_default_munmap_file)
 }
 
 
-VFS_READ_FILE(vfs_default_read) 
-{  
-	struct mapper_buff_s mp_buff;
-	uint_t buff_offset;
-	uint_t nb_ppn;
-	size_t size;
- 
-	if(file->f_attr & VFS_FIFO)
-		return -EINVAL;
+/* Reserve size bytes of the shared file offset: the offset is advanced
+ * at once and its previous value, the start of the reservation, is
+ * returned.  When start is not VFS_OFFSET_RESERVE, give back the part
+ * of the reservation [start, start + size) that has not been used,
+ * unless a later transfer or lseek has moved the offset meanwhile. */
+#define VFS_OFFSET_RESERVE   ((size_t)-1)
+
+RPC_DECLARE(__vfs_offset_reserve, RPC_RET(RPC_RET_PTR(size_t, old)),
+		RPC_ARG(RPC_ARG_VAL(struct vfs_file_remote_s*, fremote),
+			RPC_ARG_VAL(size_t, start),
+			RPC_ARG_VAL(size_t, size),
+			RPC_ARG_VAL(size_t, used)))
+{
+	rwlock_wrlock(&fremote->fr_rwlock);
+
+	*old = fremote->fr_offset;
 
-	size = buffer->get_size(buffer);
-	if(buffer->size == 0) return 0;
+	if(start == VFS_OFFSET_RESERVE)
+		fremote->fr_offset += size;
+	else if(fremote->fr_offset == start + size)
+		fremote->fr_offset = start + used;
 
-	nb_ppn = buffer->get_ppn_max(buffer);	
+	rwlock_unlock(&fremote->fr_rwlock);
+}
+
+static size_t vfs_offset_reserve(struct vfs_file_s *file, size_t start, size_t size, size_t used)
+{
+	size_t old;
+
+	RCPC(file->f_inode.cid, RPC_PRIO_FS, __vfs_offset_reserve,
+				RPC_RECV(RPC_RECV_OBJ(old)), 
+				RPC_SEND(RPC_SEND_OBJ(file->f_remote),
+					RPC_SEND_OBJ(start),
+					RPC_SEND_OBJ(size),
+					RPC_SEND_OBJ(used)));
+	return old;
+}
 
-	if(nb_ppn > 64)
+/* Transfer count buffers from/to the file's mapper.  The buffers are
+ * handed to the mapper in batches whose ppns fit in VFS_PPNS_ON_STACK,
+ * a larger buffer being sliced, so that each batch is a single RPC to
+ * the mapper home cluster and stays within the RPC on-stack limit.
+ * When isPositional is set, the transfer starts at offset and the
+ * shared file offset is neither used nor locked.  Otherwise a transfer
+ * needing more than one batch reserves its whole range of the shared
+ * offset first, so that a concurrent transfer cannot interleave. */
+ssize_t vfs_mapper_rw(struct vfs_file_s *file, 
+		      struct ku_obj *buff_tbl, 
+		      uint_t count,
+		      bool_t isPositional,
+		      size_t offset,
+		      bool_t isRead)
+{
+	struct mapper_buff_s mp_buffs[count];
+	ppn_t ppns[VFS_PPNS_ON_STACK + 1];
+	struct ku_obj *buffer;
+	struct ku_obj slice;
+	size_t nb_ppn;
+	size_t index;
+	size_t chunk;
+	size_t wanted;
+	size_t pos;
+	ssize_t size;
+	ssize_t done;
+	size_t total;
+	bool_t isReserved;
+	uint_t nb_buff;
+	uint_t i;
+
+	for(total = 0, i = 0; i < count; i++)
+		total += buff_tbl[i].get_size(&buff_tbl[i]);
+
+	isReserved = false;
+
+	for(done = 0, pos = 0, i = 0; i < count; )
 	{
-		//TODO allocate on mem!
-		printk(ERROR, "Error in file %s at func %s line %d\n", 
-				__FILE__, __FUNCTION__, __LINE__);
-		while(1);
+		for(nb_buff = 0, index = 0, wanted = 0; i < count; nb_buff++)
+		{
+			buffer = &buff_tbl[i];
+			chunk  = MIN(buffer->get_size(buffer) - pos, 
+				     (VFS_PPNS_ON_STACK - 2) * PMM_PAGE_SIZE);
+
+			slice      = *buffer;
+			slice.buff = (uint8_t*)buffer->buff + pos;
+			slice.size = chunk;
+			nb_ppn     = slice.get_ppn_max(&slice);
+
+			if(index + nb_ppn > VFS_PPNS_ON_STACK)
+				break;
+
+			mp_buffs[nb_buff].file        = (isPositional) ? NULL : file->f_remote;
+			mp_buffs[nb_buff].data_offset = offset + done;
+			mp_buffs[nb_buff].size        = chunk;
+			mp_buffs[nb_buff].max_ppns    = nb_ppn;
+			mp_buffs[nb_buff].buff_ppns   = &ppns[index];
+			mp_buffs[nb_buff].buff_offset = slice.get_ppn(&slice, &ppns[index], nb_ppn);
+
+			index  += nb_ppn;
+			wanted += chunk;
+			pos    += chunk;
+
+			if(pos == buffer->get_size(buffer))
+			{
+				pos = 0;
+				i ++;
+			}
+		}
+
+		if(!isPositional && (i < count))
+		{
+			offset       = vfs_offset_reserve(file, VFS_OFFSET_RESERVE, total, 0);
+			isPositional = true;
+			isReserved   = true;
+
+			for(index = 0; index < nb_buff; index++)
+			{
+				mp_buffs[index].file        = NULL;
+				mp_buffs[index].data_offset = offset;
+			}
+		}
+
+		if(isRead)
+			size = mapper_read(&file->f_mapper, &mp_buffs[0], nb_buff, file->f_flags);
+		else
+			size = mapper_write(&file->f_mapper, &mp_buffs[0], nb_buff, file->f_flags);
+
+		if(size < 0)
+		{
+			if(done == 0)
+				done = size;
+			break;
+		}
+
+		done += size;
+
+		/* End of file */
+		if((size_t)size != wanted)
+			break;
 	}
 
-	ppn_t ppns[nb_ppn];
+	if(isReserved && ((size_t)done != total))
+		(void)vfs_offset_reserve(file, offset, total, (done < 0) ? 0 : done);
+
+	return done;
+}
 
-	buff_offset = buffer->get_ppn(buffer, ppns, nb_ppn);
+VFS_READ_FILE(vfs_default_read) 
+{  
+	if(file->f_attr & VFS_FIFO)
+		return -EINVAL;
 
-	mp_buff.data_offset = 0;
-	mp_buff.file = file->f_remote;
-	mp_buff.buff_offset = buff_offset;
-	mp_buff.buff_ppns = &ppns[0];
-	mp_buff.max_ppns = nb_ppn;
-	mp_buff.size = size;
+	if(buffer->get_size(buffer) == 0) return 0;
 
-	return mapper_read(&file->f_mapper, &mp_buff, 1, file->f_flags);
+	return vfs_mapper_rw(file, buffer, 1, false, 0, true);
 }
 
 
 VFS_WRITE_FILE(vfs_default_write) 
 {
-	struct mapper_buff_s mp_buff;
-	uint_t buff_offset;
-	uint_t nb_ppn;
-	size_t size;
- 
 	if(file->f_attr & VFS_FIFO)
 		return -EINVAL;
 
-	size = buffer->get_size(buffer);
-	if(buffer->size == 0) return 0;
-
-	nb_ppn = buffer->get_ppn_max(buffer);	
-
-	if(nb_ppn > 64)
-	{
-		//TODO allocate on mem!
-		printk(ERROR, "Error in file %s at func %s line %d\n", 
-				__FILE__, __FUNCTION__, __LINE__);
-		while(1);
-	}
-
-	ppn_t ppns[nb_ppn];
-
-	buff_offset = buffer->get_ppn(buffer, ppns, nb_ppn);
-
-	mp_buff.data_offset = 0;
-	mp_buff.file = file->f_remote;
-	mp_buff.buff_offset = buff_offset;
-	mp_buff.buff_ppns = &ppns[0];
-	mp_buff.max_ppns = nb_ppn;
-	mp_buff.size = size;
+	if(buffer->get_size(buffer) == 0) return 0;
 
-	return mapper_write(&file->f_mapper, &mp_buff, 1, file->f_flags);
+	return vfs_mapper_rw(file, buffer, 1, false, 0, false);
 }
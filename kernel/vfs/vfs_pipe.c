@@ -0,0 +1,927 @@
+/*
+ * vfs/vfs_pipe.c - anonymous pipes backed by a ring of pages
+ *
+ * Copyright (c) 2008,2009,2010,2011,2012 Ghassan Almaless
+ * Copyright (c) 2011,2012,2013,2014,2015 UPMC Sorbonne Universites
+ *
+ * This file is part of ALMOS-kernel.
+ *
+ * ALMOS-kernel is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2.0 of the License.
+ *
+ * ALMOS-kernel is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with ALMOS-kernel; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <bits.h>
+#include <thread.h>
+#include <task.h>
+#include <signal.h>
+#include <scheduler.h>
+#include <spinlock.h>
+#include <rwlock.h>
+#include <wait_queue.h>
+#include <poll.h>
+#include <kmem.h>
+#include <page.h>
+#include <ppm.h>
+#include <pmm.h>
+#include <vmm.h>
+#include <ku_transfert.h>
+#include <ppn.h>
+#include <rpc.h>
+#include <remote_access.h>
+#include <vfs.h>
+#include <vfs-private.h>
+
+/*
+ * A pipe is a ring of CONFIG_PIPE_PAGES_NR slots, each slot owning
+ * one whole page.  Writers fill the tail slot and, once it is full,
+ * link a fresh page to the ring; readers drain the head slot and
+ * unlink its page once it has been entirely consumed.  Pages are thus
+ * handed from the writer to the reader by reference and never packed
+ * into a contiguous byte buffer.  The page of the last drained slot is
+ * kept as a spare so that a steady stream does not go through the
+ * page allocator.
+ *
+ * Data is copied to and from user space without holding the pipe
+ * spinlock: only the writer touches the tail slot beyond its length
+ * and only the reader touches the head slot before it, writers (resp.
+ * readers) being serialized by wr_lock (resp. rd_lock).
+ *
+ * The pipe lives on the cluster of its creator, its home, while its
+ * descriptors are inherited by tasks placed on other clusters (fork,
+ * exec).  Such tasks never touch the pipe: their requests are shipped
+ * to the home cluster by RPC, as the refcount and close of any file
+ * already are through f_inode.cid.  A reader of another cluster is
+ * handed the full head pages that cover whole pages of its buffer:
+ * they are unlinked from the ring and mapped in place of the buffer
+ * pages (vmm_swap_page) instead of being copied.
+ */
+
+struct pipe_slot_s
+{
+	struct page_s *page;
+	uint_t len;
+};
+
+struct vfs_pipe_s
+{
+	spinlock_t lock;
+	struct rwlock_s rd_lock;
+	struct rwlock_s wr_lock;
+	struct wait_queue_s rd_wq;
+	struct wait_queue_s wr_wq;
+	struct poll_queue_s poll_q;
+	uint_t readers;
+	uint_t writers;
+	uint_t rdidx;
+	uint_t rdoff;
+	uint_t count;
+	uint_t size;
+	struct page_s *spare;
+	struct pipe_slot_s slots[CONFIG_PIPE_PAGES_NR];
+};
+
+/* A request coming from another cluster describes its buffer by the
+ * physical pages backing it, as mapper requests do */
+struct pipe_io_s
+{
+	struct ku_obj kub;
+	ppn_t *ppns;
+	ppn_t *handoff;
+	uint_t offset;
+};
+
+/* Buffer pages per remote request, the ppns being sent on the RPC stack */
+#define PIPE_RPC_PPNS          64
+
+/* Remote requests */
+#define PIPE_IO_WRITE          0
+#define PIPE_IO_READ           1
+#define PIPE_IO_HANDOFF        2
+
+/* Pipe pages handed off to a remote reader, by page of its buffer */
+struct pipe_handoff_s
+{
+	ppn_t ppns[PIPE_RPC_PPNS];
+};
+
+#define PIPE_SLOT(_pipe, _idx) (&(_pipe)->slots[(_idx) % CONFIG_PIPE_PAGES_NR])
+#define PIPE_TAIL(_pipe)       PIPE_SLOT(_pipe, (_pipe)->rdidx + (_pipe)->count - 1)
+
+static struct page_s* pipe_page_get(struct vfs_pipe_s *pipe)
+{
+	struct page_s *page;
+	kmem_req_t req;
+
+	spinlock_lock(&pipe->lock);
+	page = pipe->spare;
+	pipe->spare = NULL;
+	spinlock_unlock(&pipe->lock);
+
+	if(page != NULL)
+		return page;
+
+	req.type  = KMEM_PAGE;
+	req.size  = 0;
+	req.flags = AF_USER;
+
+	return kmem_alloc(&req);
+}
+
+static void pipe_page_put(struct page_s *page)
+{
+	kmem_req_t req;
+
+	if(page == NULL)
+		return;
+
+	req.type = KMEM_PAGE;
+	req.ptr  = page;
+	kmem_free(&req);
+}
+
+/* Unlink the head slot and return its page, the pipe lock held */
+static struct page_s* pipe_head_unlink(struct vfs_pipe_s *pipe)
+{
+	struct pipe_slot_s *slot;
+	struct page_s *page;
+
+	slot        = PIPE_SLOT(pipe, pipe->rdidx);
+	page        = slot->page;
+	slot->page  = NULL;
+	slot->len   = 0;
+	pipe->rdoff = 0;
+	pipe->rdidx ++;
+	pipe->count --;
+
+	wakeup_all(&pipe->wr_wq);
+	poll_notify(&pipe->poll_q, POLLOUT);
+	return page;
+}
+
+/* Unlink the head slot if it has been drained and another slot follows
+ * it, or if it is full (no writer will append to it anymore).  Called
+ * with the pipe lock held, returns the page to be freed, if any. */
+static struct page_s* pipe_head_release(struct vfs_pipe_s *pipe)
+{
+	struct pipe_slot_s *slot;
+	struct page_s *page;
+
+	if(pipe->count == 0)
+		return NULL;
+
+	slot = PIPE_SLOT(pipe, pipe->rdidx);
+
+	if((pipe->rdoff != slot->len) ||
+	   ((slot->len != PMM_PAGE_SIZE) && (pipe->count == 1)))
+		return NULL;
+
+	page = pipe_head_unlink(pipe);
+
+	if(pipe->spare == NULL)
+	{
+		pipe->spare = page;
+		return NULL;
+	}
+
+	return page;
+}
+
+static void pipe_destroy(struct vfs_pipe_s *pipe)
+{
+	kmem_req_t req;
+	uint_t i;
+
+	for(i = 0; i < CONFIG_PIPE_PAGES_NR; i++)
+		pipe_page_put(pipe->slots[i].page);
+
+	pipe_page_put(pipe->spare);
+
+	wait_queue_destroy(&pipe->rd_wq);
+	wait_queue_destroy(&pipe->wr_wq);
+	poll_queue_destroy(&pipe->poll_q);
+	rwlock_destroy(&pipe->rd_lock);
+	rwlock_destroy(&pipe->wr_lock);
+
+	req.type = KMEM_GENERIC;
+	req.ptr  = pipe;
+	kmem_free(&req);
+}
+
+/* Copy size bytes between addr, in a pipe page, and the request
+ * buffer, advancing the buffer past them */
+static uint_t pipe_copy(struct pipe_io_s *io, uint8_t *addr, uint_t size, bool_t isRead)
+{
+	uint8_t *ptr;
+	uint_t chunk;
+	uint_t done;
+	ppn_t ppn;
+	cid_t cid;
+
+	if(io->ppns == NULL)
+	{
+		if(isRead)
+			done = io->kub.scpy_to_buff(&io->kub, addr, size);
+		else
+			done = io->kub.scpy_from_buff(&io->kub, addr, size);
+
+		io->kub.buff = (uint8_t*)io->kub.buff + done;
+		return done;
+	}
+
+	for(done = 0; done < size; done += chunk)
+	{
+		ppn   = io->ppns[io->offset >> PMM_PAGE_SHIFT];
+		ptr   = (uint8_t*)ppn_ppn2vma(ppn) + (io->offset & PMM_PAGE_MASK);
+		cid   = ppn_ppn2cid(ppn);
+		chunk = MIN(PMM_PAGE_SIZE - (io->offset & PMM_PAGE_MASK), size - done);
+
+		if(isRead)
+			remote_memcpy(ptr, cid, addr + done, current_cid, chunk);
+		else
+			remote_memcpy(addr + done, current_cid, ptr, cid, chunk);
+
+		io->offset += chunk;
+	}
+
+	return done;
+}
+
+/* Runs on the pipe home cluster */
+static ssize_t pipe_read(struct vfs_pipe_s *pipe, struct pipe_io_s *io, uint_t size)
+{
+	struct pipe_slot_s *slot;
+	struct page_s *page;
+	uint_t done;
+	uint_t avail;
+	uint_t offset;
+	uint_t chunk;
+	uint8_t *addr;
+	error_t err;
+
+	done = 0;
+	err  = 0;
+
+	rwlock_wrlock(&pipe->rd_lock);
+	spinlock_lock(&pipe->lock);
+
+	while(pipe->size == 0)
+	{
+		if(pipe->writers == 0)
+		{
+			spinlock_unlock(&pipe->lock);
+			goto PIPE_READ_END;
+		}
+
+		wait_on(&pipe->rd_wq, WAIT_LAST);
+		spinlock_unlock_nosched(&pipe->lock);
+		sched_sleep(current_thread);
+		spinlock_lock(&pipe->lock);
+	}
+
+	while((done < size) && (pipe->size != 0))
+	{
+		page = pipe_head_release(pipe);
+
+		if(page != NULL)
+		{
+			spinlock_unlock(&pipe->lock);
+			pipe_page_put(page);
+			spinlock_lock(&pipe->lock);
+		}
+
+		slot   = PIPE_SLOT(pipe, pipe->rdidx);
+		offset = pipe->rdoff;
+		avail  = slot->len - offset;
+		addr   = ppm_page2addr(slot->page);
+
+		/* A full page for a whole page of a remote reader buffer */
+		if((io->handoff != NULL) && (offset == 0) && 
+		   (avail == PMM_PAGE_SIZE) && ((size - done) >= PMM_PAGE_SIZE) &&
+		   !(io->offset & PMM_PAGE_MASK))
+		{
+			page        = pipe_head_unlink(pipe);
+			pipe->size -= PMM_PAGE_SIZE;
+			spinlock_unlock(&pipe->lock);
+
+			page->mapper = NULL;
+			io->handoff[io->offset >> PMM_PAGE_SHIFT] = ppm_page2ppn(page);
+			io->offset += PMM_PAGE_SIZE;
+			done       += PMM_PAGE_SIZE;
+
+			spinlock_lock(&pipe->lock);
+			continue;
+		}
+
+		spinlock_unlock(&pipe->lock);
+
+		chunk = MIN(avail, size - done);
+
+		if(pipe_copy(io, addr + offset, chunk, true) != chunk)
+		{
+			err = EFAULT;
+			spinlock_lock(&pipe->lock);
+			break;
+		}
+
+		done += chunk;
+
+		spinlock_lock(&pipe->lock);
+		pipe->rdoff += chunk;
+		pipe->size  -= chunk;
+	}
+
+	page = pipe_head_release(pipe);
+	spinlock_unlock(&pipe->lock);
+	pipe_page_put(page);
+
+PIPE_READ_END:
+	rwlock_unlock(&pipe->rd_lock);
+	return ((err) && (done == 0)) ? -err : (ssize_t)done;
+}
+
+/* Runs on the pipe home cluster */
+static ssize_t pipe_write(struct vfs_pipe_s *pipe, struct pipe_io_s *io, uint_t size)
+{
+	struct pipe_slot_s *slot;
+	struct page_s *page;
+	uint_t done;
+	uint_t offset;
+	uint_t chunk;
+	bool_t isNew;
+	error_t err;
+
+	done = 0;
+	err  = 0;
+
+	rwlock_wrlock(&pipe->wr_lock);
+
+	while(done < size)
+	{
+		spinlock_lock(&pipe->lock);
+
+		while(1)
+		{
+			if(pipe->readers == 0)
+			{
+				spinlock_unlock(&pipe->lock);
+				err = EPIPE;
+				goto PIPE_WRITE_END;
+			}
+
+			if((pipe->count != 0) && (PIPE_TAIL(pipe)->len != PMM_PAGE_SIZE))
+			{
+				isNew = false;
+				break;
+			}
+
+			if(pipe->count != CONFIG_PIPE_PAGES_NR)
+			{
+				isNew = true;
+				break;
+			}
+
+			wait_on(&pipe->wr_wq, WAIT_LAST);
+			spinlock_unlock_nosched(&pipe->lock);
+			sched_sleep(current_thread);
+			spinlock_lock(&pipe->lock);
+		}
+
+		if(isNew)
+		{
+			spinlock_unlock(&pipe->lock);
+
+			if((page = pipe_page_get(pipe)) == NULL)
+			{
+				err = ENOMEM;
+				goto PIPE_WRITE_END;
+			}
+
+			offset = 0;
+		}
+		else
+		{
+			slot   = PIPE_TAIL(pipe);
+			page   = slot->page;
+			offset = slot->len;
+			spinlock_unlock(&pipe->lock);
+		}
+
+		chunk = MIN(PMM_PAGE_SIZE - offset, size - done);
+
+		if(pipe_copy(io, (uint8_t*)ppm_page2addr(page) + offset, chunk, false) != chunk)
+		{
+			if(isNew) pipe_page_put(page);
+			err = EFAULT;
+			goto PIPE_WRITE_END;
+		}
+
+		done += chunk;
+
+		spinlock_lock(&pipe->lock);
+
+		if(isNew)
+		{
+			pipe->count ++;
+			slot       = PIPE_TAIL(pipe);
+			slot->page = page;
+			slot->len  = chunk;
+		}
+		else
+			PIPE_TAIL(pipe)->len += chunk;
+
+		/* Readers' pollers only care about the empty to ready edge */
+		if(pipe->size == 0)
+			poll_notify(&pipe->poll_q, POLLIN);
+
+		pipe->size += chunk;
+		wakeup_all(&pipe->rd_wq);
+		spinlock_unlock(&pipe->lock);
+	}
+
+PIPE_WRITE_END:
+	rwlock_unlock(&pipe->wr_lock);
+	return ((err) && (done == 0)) ? -err : (ssize_t)done;
+}
+
+RPC_DECLARE(__vfs_pipe_rw, 
+		RPC_RET(RPC_RET_PTR(ssize_t, size), RPC_RET_PTR(struct pipe_handoff_s, handoff)),
+		RPC_ARG(RPC_ARG_VAL(struct vfs_file_remote_s*, fremote),
+			RPC_ARG_PTR(ppn_t, ppns),
+			RPC_ARG_VAL(uint_t, offset),
+			RPC_ARG_VAL(uint_t, count),
+			RPC_ARG_VAL(uint_t, mode)))
+{
+	struct pipe_io_s io;
+
+	io.ppns    = ppns;
+	io.offset  = offset;
+	io.handoff = NULL;
+
+	switch(mode)
+	{
+	case PIPE_IO_HANDOFF:
+		memset(handoff, 0, sizeof(*handoff));
+		io.handoff = &handoff->ppns[0];
+		/* fall through */
+	case PIPE_IO_READ:
+		*size = pipe_read(fremote->fr_pv, &io, count);
+		break;
+	default:
+		*size = pipe_write(fremote->fr_pv, &io, count);
+	}
+}
+
+/* Fault in the user page of addr, and unshare it for a write, without
+ * storing anything to it: the CAS of a word with its own value does
+ * not change it, and if it fails a user store has unshared the page */
+static error_t pipe_touch(uint8_t *addr, bool_t isWrite)
+{
+	bool_t isAtomic;
+	uint_t *ptr;
+	uint_t val;
+
+	ptr = (uint_t*)((uint_t)addr & ~(sizeof(uint_t) - 1));
+
+	if(cpu_copy_from_uspace(&val, ptr, sizeof(val)))
+		return EFAULT;
+
+	if((isWrite) && cpu_uspace_cas(ptr, val, val, &isAtomic))
+		return EFAULT;
+
+	return 0;
+}
+
+/* Map the pipe pages handed off to this reader in place of the pages
+ * of its buffer, or copy them if a buffer page cannot be replaced */
+static void pipe_handoff_map(uint8_t *buff, ppn_t *ppns, struct pipe_handoff_s *handoff)
+{
+	struct task_s *task;
+	uint_t vaddr;
+	ppn_t ppn;
+	uint_t i;
+
+	task  = current_task;
+	vaddr = (uint_t)buff & ~PMM_PAGE_MASK;
+
+	for(i = 0; i < PIPE_RPC_PPNS; i++, vaddr += PMM_PAGE_SIZE)
+	{
+		if(handoff->ppns[i] == 0)
+			continue;
+
+		if(vmm_swap_page(&task->vmm, vaddr, ppns[i], handoff->ppns[i]) == 0)
+			continue;
+
+		if((pipe_touch((uint8_t*)vaddr, true) == 0) &&
+		   ((ppn = task_vaddr2ppn(task, (void*)vaddr)) != 0))
+			ppn_copy(ppn, handoff->ppns[i]);
+
+		ppn_refcount_down(handoff->ppns[i]);
+	}
+}
+
+/* Ship a request to the pipe home cluster, at most PIPE_RPC_PPNS pages
+ * of the buffer at a time.  The pages of a user buffer are faulted in
+ * (and unshared for a read) before their ppns are taken, and a user
+ * buffer being read can be given pipe pages.  A read stops at its
+ * first RPC, as a local one would return as soon as some data has
+ * been read. */
+static ssize_t pipe_remote_rw(struct vfs_file_s *file, struct ku_obj *buffer, bool_t isRead)
+{
+	ppn_t ppns[PIPE_RPC_PPNS + 1];
+	struct pipe_handoff_s handoff;
+	struct ku_obj kub;
+	uint8_t *buff;
+	uint8_t *addr;
+	uint_t offset;
+	uint_t count;
+	uint_t size;
+	uint_t done;
+	uint_t mode;
+	bool_t isUser;
+	ssize_t ret;
+
+	size   = buffer->get_size(buffer);
+	isUser = (buffer->get_ppn == ku_get_ppn);
+
+	if(isRead)
+		mode = (isUser) ? PIPE_IO_HANDOFF : PIPE_IO_READ;
+	else
+		mode = PIPE_IO_WRITE;
+
+	for(done = 0; done < size; done += ret)
+	{
+		buff  = (uint8_t*)buffer->buff + done;
+		count = MIN(size - done, PIPE_RPC_PPNS * PMM_PAGE_SIZE - ((uint_t)buff & PMM_PAGE_MASK));
+
+		kub      = *buffer;
+		kub.buff = buff;
+		kub.size = count;
+
+		for(addr = buff; (isUser) && (addr < buff + count); 
+		    addr = (uint8_t*)(((uint_t)addr & ~PMM_PAGE_MASK) + PMM_PAGE_SIZE))
+		{
+			if(pipe_touch(addr, isRead))
+			{
+				ret = -EFAULT;
+				goto PIPE_REMOTE_END;
+			}
+		}
+
+		offset = kub.get_ppn(&kub, &ppns[0], PIPE_RPC_PPNS);
+
+		RCPC(file->f_inode.cid, RPC_PRIO_FS, __vfs_pipe_rw,
+		     RPC_RECV(RPC_RECV_OBJ(ret), RPC_RECV_OBJ(handoff)),
+		     RPC_SEND(RPC_SEND_OBJ(file->f_remote),
+			      RPC_SEND_MEM(&ppns[0], sizeof(ppns)),
+			      RPC_SEND_OBJ(offset),
+			      RPC_SEND_OBJ(count),
+			      RPC_SEND_OBJ(mode)));
+
+		if((mode == PIPE_IO_HANDOFF) && (ret > 0))
+			pipe_handoff_map(buff, &ppns[0], &handoff);
+
+		if((ret <= 0) || (isRead) || ((uint_t)ret != count))
+			goto PIPE_REMOTE_END;
+	}
+
+	return done;
+
+PIPE_REMOTE_END:
+	if(ret > 0) done += ret;
+	return (done) ? (ssize_t)done : ret;
+}
+
+/* Writing with no reader left raises SIGPIPE on the writer */
+static void pipe_sigpipe(void)
+{
+	struct thread_s *this;
+
+	this = current_thread;
+
+	spinlock_lock(&this->lock);
+	this->info.sig_state |= (1 << SIGPIPE);
+	spinlock_unlock(&this->lock);
+}
+
+VFS_READ_FILE(vfs_pipe_read)
+{
+	struct pipe_io_s io;
+	uint_t size;
+
+	if((size = buffer->get_size(buffer)) == 0)
+		return 0;
+
+	if(file->f_inode.cid != current_cid)
+		return pipe_remote_rw(file, buffer, true);
+
+	io.kub     = *buffer;
+	io.ppns    = NULL;
+	io.handoff = NULL;
+
+	return pipe_read(file->f_remote->fr_pv, &io, size);
+}
+
+VFS_WRITE_FILE(vfs_pipe_write)
+{
+	struct pipe_io_s io;
+	uint_t size;
+	ssize_t ret;
+
+	if((size = buffer->get_size(buffer)) == 0)
+		return 0;
+
+	if(file->f_inode.cid != current_cid)
+		ret = pipe_remote_rw(file, buffer, false);
+	else
+	{
+		io.kub     = *buffer;
+		io.ppns    = NULL;
+		io.handoff = NULL;
+
+		ret = pipe_write(file->f_remote->fr_pv, &io, size);
+	}
+
+	if(ret == -EPIPE)
+		pipe_sigpipe();
+
+	return ret;
+}
+
+static error_t vfs_pipe_close(struct vfs_file_remote_s *file, bool_t isReader)
+{
+	struct vfs_pipe_s *pipe;
+	bool_t isLast;
+
+	pipe = file->fr_pv;
+
+	spinlock_lock(&pipe->lock);
+
+	if(isReader)
+	{
+		pipe->readers --;
+		wakeup_all(&pipe->wr_wq);
+
+		if(pipe->readers == 0)
+			poll_notify(&pipe->poll_q, POLLERR);
+	}
+	else
+	{
+		pipe->writers --;
+		wakeup_all(&pipe->rd_wq);
+
+		if(pipe->writers == 0)
+			poll_notify(&pipe->poll_q, POLLHUP);
+	}
+
+	isLast = ((pipe->readers == 0) && (pipe->writers == 0));
+	spinlock_unlock(&pipe->lock);
+
+	if(isLast)
+		pipe_destroy(pipe);
+
+	file->fr_pv = NULL;
+	return 0;
+}
+
+VFS_CLOSE_FILE(vfs_pipe_rd_close)
+{
+	return vfs_pipe_close(file, true);
+}
+
+VFS_CLOSE_FILE(vfs_pipe_wr_close)
+{
+	return vfs_pipe_close(file, false);
+}
+
+VFS_RELEASE_FILE(vfs_pipe_release)
+{
+	return 0;
+}
+
+VFS_LSEEK_FILE(vfs_pipe_lseek)
+{
+	return ESPIPE;
+}
+
+VFS_MMAP_FILE(vfs_pipe_mmap)
+{
+	return ENODEV;
+}
+
+/* Both ends share the pipe poll queue, an entry only being woken up for
+ * the events it asked for.  Runs on the pipe home cluster. */
+static uint_t pipe_poll(struct vfs_pipe_s *pipe, struct poll_entry_s *entry, bool_t isReader)
+{
+	uint_t revents;
+
+	revents = 0;
+
+	spinlock_lock(&pipe->lock);
+
+	if(isReader)
+	{
+		if(pipe->size != 0)
+			revents |= POLLIN;
+
+		if(pipe->writers == 0)
+			revents |= POLLHUP;
+	}
+	else
+	{
+		if((pipe->count != CONFIG_PIPE_PAGES_NR) || (PIPE_TAIL(pipe)->len != PMM_PAGE_SIZE))
+			revents |= POLLOUT;
+
+		if(pipe->readers == 0)
+			revents |= POLLERR;
+	}
+
+	if(entry != NULL)
+		poll_register(&pipe->poll_q, &pipe->lock, entry);
+
+	spinlock_unlock(&pipe->lock);
+	return revents;
+}
+
+/* A poller of another cluster gets a proxy of its entry registered */
+RPC_DECLARE(__vfs_pipe_poll,
+		RPC_RET(RPC_RET_PTR(uint_t, revents), RPC_RET_PTR(struct poll_entry_s*, proxy)),
+		RPC_ARG(RPC_ARG_VAL(struct vfs_file_remote_s*, fremote),
+			RPC_ARG_PTR(struct poll_entry_s, entry),
+			RPC_ARG_VAL(bool_t, isRegister),
+			RPC_ARG_VAL(bool_t, isReader)))
+{
+	*proxy = NULL;
+
+	if((isRegister) && ((*proxy = poll_proxy_create(entry)) == NULL))
+	{
+		/* Not to sleep without being notified */
+		*revents = POLLERR;
+		return;
+	}
+
+	*revents = pipe_poll(fremote->fr_pv, *proxy, isReader);
+}
+
+static uint_t vfs_pipe_poll(struct vfs_file_s *file, struct poll_entry_s *entry, bool_t isReader)
+{
+	struct poll_entry_s *proxy;
+	struct poll_entry_s dummy;
+	bool_t isRegister;
+	uint_t revents;
+
+	if(file->f_inode.cid == current_cid)
+		return pipe_poll(file->f_remote->fr_pv, entry, isReader);
+
+	isRegister = (entry != NULL);
+
+	RCPC(file->f_inode.cid, RPC_PRIO_FS, __vfs_pipe_poll,
+	     RPC_RECV(RPC_RECV_OBJ(revents), RPC_RECV_OBJ(proxy)),
+	     RPC_SEND(RPC_SEND_OBJ(file->f_remote),
+		      RPC_SEND_MEM((isRegister) ? entry : &dummy, sizeof(dummy)),
+		      RPC_SEND_OBJ(isRegister),
+		      RPC_SEND_OBJ(isReader)));
+
+	if(proxy != NULL)
+		poll_proxy_set(entry, proxy, file->f_inode.cid);
+
+	return revents;
+}
+
+VFS_POLL_FILE(vfs_pipe_rd_poll)
+{
+	return vfs_pipe_poll(file, entry, true);
+}
+
+VFS_POLL_FILE(vfs_pipe_wr_poll)
+{
+	return vfs_pipe_poll(file, entry, false);
+}
+
+static struct vfs_file_op_s vfs_pipe_rd_op =
+{
+	.open    = NULL,
+	.read    = vfs_pipe_read,
+	.write   = vfs_pipe_write,
+	.lseek   = vfs_pipe_lseek,
+	.readdir = NULL,
+	.close   = vfs_pipe_rd_close,
+	.release = vfs_pipe_release,
+	.mmap    = vfs_pipe_mmap,
+	.munmap  = NULL,
+	.poll    = vfs_pipe_rd_poll
+};
+
+static struct vfs_file_op_s vfs_pipe_wr_op =
+{
+	.open    = NULL,
+	.read    = vfs_pipe_read,
+	.write   = vfs_pipe_write,
+	.lseek   = vfs_pipe_lseek,
+	.readdir = NULL,
+	.close   = vfs_pipe_wr_close,
+	.release = vfs_pipe_release,
+	.mmap    = vfs_pipe_mmap,
+	.munmap  = NULL,
+	.poll    = vfs_pipe_wr_poll
+};
+
+static error_t vfs_pipe_file_init(struct vfs_file_s *file,
+				  struct vfs_pipe_s *pipe,
+				  struct vfs_file_op_s *op,
+				  uint_t flags)
+{
+	struct vfs_file_remote_s *fremote;
+	kmem_req_t req;
+
+	req.type  = KMEM_VFS_FILE_REMOTE;
+	req.size  = sizeof(struct vfs_file_remote_s);
+	req.flags = AF_USR;
+
+	if((fremote = kmem_alloc(&req)) == NULL)
+		return ENOMEM;
+
+	atomic_init(&fremote->fr_count, 1);
+	fremote->fr_offset  = 0;
+	fremote->fr_version = 0;
+	fremote->fr_inode   = NULL;
+	fremote->fr_op      = op;
+	fremote->fr_pv      = pipe;
+
+	memset(file, 0, sizeof(*file));
+	file->f_flags      = flags;
+	file->f_attr       = VFS_FIFO | VFS_PIPE;
+	file->f_remote     = fremote;
+	file->f_inode.ptr  = NULL;
+	file->f_inode.cid  = current_cid;
+	file->f_op         = op;
+
+	return 0;
+}
+
+error_t vfs_pipe_stat(struct vfs_file_s *file, struct vfs_stat_s *stat)
+{
+	struct vfs_pipe_s *pipe;
+	cid_t cid;
+
+	cid  = file->f_inode.cid;
+	pipe = (void*)remote_lw(&file->f_remote->fr_pv, cid);
+
+	memset(stat, 0, sizeof(*stat));
+	stat->st_mode    = VFS_IFIFO | VFS_IRUSR | VFS_IWUSR;
+	stat->st_nlink   = 1;
+	stat->st_size    = remote_lw(&pipe->size, cid);
+	stat->st_blksize = PMM_PAGE_SIZE;
+
+	return 0;
+}
+
+error_t vfs_pipe(struct vfs_file_s *pipefd[2])
+{
+	struct vfs_pipe_s *pipe;
+	kmem_req_t req;
+	error_t err;
+
+	req.type  = KMEM_GENERIC;
+	req.size  = sizeof(*pipe);
+	req.flags = AF_KERNEL | AF_ZERO;
+
+	if((pipe = kmem_alloc(&req)) == NULL)
+		return ENOMEM;
+
+	spinlock_init(&pipe->lock, "VFS Pipe");
+	rwlock_init(&pipe->rd_lock);
+	rwlock_init(&pipe->wr_lock);
+	wait_queue_init(&pipe->rd_wq, "VFS Pipe Readers");
+	wait_queue_init(&pipe->wr_wq, "VFS Pipe Writers");
+	poll_queue_init(&pipe->poll_q);
+	pipe->readers = 1;
+	pipe->writers = 1;
+
+	if((err = vfs_pipe_file_init(pipefd[0], pipe, &vfs_pipe_rd_op, VFS_O_RDONLY)))
+		goto VFS_PIPE_ERR;
+
+	if((err = vfs_pipe_file_init(pipefd[1], pipe, &vfs_pipe_wr_op, VFS_O_WRONLY)))
+	{
+		vfs_file_remote_put(pipefd[0]->f_remote);
+		goto VFS_PIPE_ERR;
+	}
+
+	vfs_dmsg(1, "%s: pipe %x created on cluster %d\n", __FUNCTION__, pipe, current_cid);
+	return 0;
+
+VFS_PIPE_ERR:
+	pipe_destroy(pipe);
+	return err;
+}
@@ -644,7 +644,10 @@ void glCallList(unsigned int list)
 
 void glFlush(void)
 {
-  /* nothing to do */
+  GLContext *c=gl_get_context();
+
+  /* rasterize the triangles still waiting in the bins */
+  ZB_binFlush(c->zb);
 }
 
 void glHint(int target,int mode)
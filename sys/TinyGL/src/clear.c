@@ -24,7 +24,11 @@ void glopClear(GLContext *c,GLParam *p)
 
   /* TODO : correct value of Z */
 
-  ZB_clear(c->zb,mask & GL_DEPTH_BUFFER_BIT,z,
-	   mask & GL_COLOR_BUFFER_BIT,r,g,b);
+  if (c->zb->bin != NULL)
+    ZB_binClear(c->zb,mask & GL_DEPTH_BUFFER_BIT,z,
+		mask & GL_COLOR_BUFFER_BIT,r,g,b);
+  else
+    ZB_clear(c->zb,mask & GL_DEPTH_BUFFER_BIT,z,
+	     mask & GL_COLOR_BUFFER_BIT,r,g,b);
 }
 
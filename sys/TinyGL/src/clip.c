@@ -68,6 +68,8 @@ void gl_draw_point(GLContext *c,GLVertex *p0)
     if (c->render_mode == GL_SELECT) {
       gl_add_select(c,p0->zp.z,p0->zp.z);
     } else {
+      /* lines and points are not binned: draw the pending triangles first */
+      ZB_binFlush(c->zb);
       ZB_plot(c->zb,&p0->zp);
     }
   }
@@ -119,6 +121,8 @@ void gl_draw_line(GLContext *c,GLVertex *p1,GLVertex *p2)
   cc1=p1->clip_code;
   cc2=p2->clip_code;
 
+  ZB_binFlush(c->zb);
+
   if ( (cc1 | cc2) == 0) {
     if (c->render_mode == GL_SELECT) {
       gl_add_select1(c,p1->zp.z,p2->zp.z,p2->zp.z);
@@ -383,6 +387,8 @@ int count_triangles,count_triangles_textured,count_pixels;
 void gl_draw_triangle_fill(GLContext *c,
                            GLVertex *p0,GLVertex *p1,GLVertex *p2)
 {
+  ZB_fillTriangleFunc fill;
+
 #ifdef PROFILE
   {
     int norm;
@@ -405,12 +411,17 @@ void gl_draw_triangle_fill(GLContext *c,
     count_triangles_textured++;
 #endif
     ZB_setTexture(c->zb,c->current_texture->images[0].pixmap);
-    ZB_fillTriangleMappingPerspective(c->zb,&p0->zp,&p1->zp,&p2->zp);
+    fill=ZB_fillTriangleMappingPerspective;
   } else if (c->current_shade_model == GL_SMOOTH) {
-    ZB_fillTriangleSmooth(c->zb,&p0->zp,&p1->zp,&p2->zp);
+    fill=ZB_fillTriangleSmooth;
   } else {
-    ZB_fillTriangleFlat(c->zb,&p0->zp,&p1->zp,&p2->zp);
+    fill=ZB_fillTriangleFlat;
   }
+
+  if (c->zb->bin != NULL)
+    ZB_binTriangle(c->zb,fill,&p0->zp,&p1->zp,&p2->zp);
+  else
+    fill(c->zb,&p0->zp,&p1->zp,&p2->zp);
 }
 
 /* Render a clipped triangle in line mode */  
@@ -418,6 +429,8 @@ void gl_draw_triangle_fill(GLContext *c,
 void gl_draw_triangle_line(GLContext *c,
                            GLVertex *p0,GLVertex *p1,GLVertex *p2)
 {
+    ZB_binFlush(c->zb);
+
     if (c->depth_test) {
         if (p0->edge_flag) ZB_line_z(c->zb,&p0->zp,&p1->zp);
         if (p1->edge_flag) ZB_line_z(c->zb,&p1->zp,&p2->zp);
@@ -435,6 +448,8 @@ void gl_draw_triangle_line(GLContext *c,
 void gl_draw_triangle_point(GLContext *c,
                             GLVertex *p0,GLVertex *p1,GLVertex *p2)
 {
+  ZB_binFlush(c->zb);
+
   if (p0->edge_flag) ZB_plot(c->zb,&p0->zp);
   if (p1->edge_flag) ZB_plot(c->zb,&p1->zp);
   if (p2->edge_flag) ZB_plot(c->zb,&p2->zp);
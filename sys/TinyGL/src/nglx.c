@@ -121,6 +121,7 @@ void nglXSwapBuffers( NGLXDrawable drawable )
     gl_context=gl_get_context();
     ctx=(TinyNGLXContext *)gl_context->opaque;
     
+    ZB_binFlush(ctx->gl_context->zb);
     GrArea(drawable, ctx->gc, 0, 0, ctx->xsize, 
            ctx->ysize, ctx->gl_context->zb->pbuf, ctx->pixtype);
 }
@@ -4,9 +4,57 @@
 #include <GL/gl.h>
 #include <stdlib.h>
 #include <assert.h>
+#include <time.h>
+#include <pthread.h>
 
 static int buffercnt = 0;
 
+/* page flipping: a thread copies each finished buffer to the front */
+typedef struct {
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  pthread_t thread;
+  ZBuffer *zb;       /* buffer being presented, NULL when idle */
+  void *front;
+  int linesize;
+  int quit;
+} ostgl_flip;
+
+static void *
+ostgl_flip_thread(void *arg)
+{
+  ostgl_flip *flip = arg;
+  ZBuffer *zb;
+
+  pthread_mutex_lock(&flip->lock);
+  for (;;) {
+    while (!flip->quit && flip->zb == NULL)
+      pthread_cond_wait(&flip->cond, &flip->lock);
+    if (flip->zb == NULL)
+      break;
+    zb = flip->zb;
+    pthread_mutex_unlock(&flip->lock);
+
+    ZB_copyFrameBuffer(zb, flip->front, flip->linesize);
+
+    pthread_mutex_lock(&flip->lock);
+    flip->zb = NULL;
+    pthread_cond_broadcast(&flip->cond);
+  }
+  pthread_mutex_unlock(&flip->lock);
+  return NULL;
+}
+
+/* wait for the buffer being presented, if any */
+static void
+ostgl_flip_wait(ostgl_flip *flip)
+{
+  pthread_mutex_lock(&flip->lock);
+  while (flip->zb != NULL)
+    pthread_cond_wait(&flip->cond, &flip->lock);
+  pthread_mutex_unlock(&flip->lock);
+}
+
 ostgl_context *
 ostgl_create_context(const int xsize,
                      const int ysize,
@@ -45,7 +93,12 @@ ostgl_create_context(const int xsize,
   context->ysize = ysize;
   context->numbuffers = numbuffers;
   context->depth = 16;
-  context->bytes_per_line = xsize;
+  context->bytes_per_line = xsize * 2;
+  context->front = NULL;
+  context->current = 0;
+  context->flip = NULL;
+  context->swap_count = 0;
+  context->swap_ticks = 0;
   return context;
 }
 
@@ -53,6 +106,8 @@ void
 ostgl_delete_context(ostgl_context *context)
 {
   int i;
+
+  ostgl_set_front(context, NULL);
   for (i = 0; i < context->numbuffers; i++) {
     ZB_close(context->zbs[i]);
   }
@@ -80,18 +135,116 @@ ostgl_resize(ostgl_context *context,
              void **framebuffers)
 {
   int i;
+
+  if (context->flip != NULL)
+    ostgl_flip_wait(context->flip);
   for (i = 0; i < context->numbuffers; i++) {
     ZB_resize(context->zbs[i], framebuffers[i], xsize, ysize);
+    context->framebuffers[i] = framebuffers[i];
+  }
+  context->xsize = xsize;
+  context->ysize = ysize;
+  context->bytes_per_line = xsize * 2;
+  if (context->flip != NULL)
+    ((ostgl_flip *)context->flip)->linesize = context->bytes_per_line;
+}
+
+
+int
+ostgl_set_threads(ostgl_context *context, const int nb_threads)
+{
+  int i;
+  int err = 0;
+
+  for (i = 0; i < context->numbuffers; i++) {
+    if (ZB_binOpen(context->zbs[i], nb_threads))
+      err = -1;
   }
+  return err;
 }
 
+int
+ostgl_set_front(ostgl_context *context, void *front)
+{
+  ostgl_flip *flip = context->flip;
+
+  if (flip != NULL) {
+    pthread_mutex_lock(&flip->lock);
+    flip->quit = 1;
+    pthread_cond_broadcast(&flip->cond);
+    pthread_mutex_unlock(&flip->lock);
+    pthread_join(flip->thread, NULL);
+    pthread_cond_destroy(&flip->cond);
+    pthread_mutex_destroy(&flip->lock);
+    gl_free(flip);
+    context->flip = NULL;
+  }
+
+  context->front = front;
+
+  /* with a single buffer, the copy cannot overlap the next frame */
+  if (front == NULL || context->numbuffers < 2)
+    return 0;
+
+  flip = gl_malloc(sizeof(ostgl_flip));
+  if (flip == NULL)
+    return -1;
+
+  pthread_mutex_init(&flip->lock, NULL);
+  pthread_cond_init(&flip->cond, NULL);
+  flip->zb = NULL;
+  flip->front = front;
+  flip->linesize = context->bytes_per_line;
+  flip->quit = 0;
+
+  if (pthread_create(&flip->thread, NULL, ostgl_flip_thread, flip)) {
+    pthread_cond_destroy(&flip->cond);
+    pthread_mutex_destroy(&flip->lock);
+    gl_free(flip);
+    return -1;
+  }
+
+  context->flip = flip;
+  return 0;
+}
 
 void
 ostgl_swap_buffers(ostgl_context *context)
 {
+  ostgl_flip *flip = context->flip;
+  ZBuffer *zb;
+  clock_t start;
   int i;
-  
-  for(i = 0; i < context->numbuffers; i++) {
-    ZB_copyFrameBuffer(context->zbs[i], context->framebuffers[i], context->bytes_per_line);
+
+  start = clock();
+
+  if (context->front == NULL) {
+    for(i = 0; i < context->numbuffers; i++) {
+      zb = context->zbs[i];
+      if (context->framebuffers[i] == NULL || context->framebuffers[i] == zb->pbuf)
+        ZB_binFlush(zb);  /* rendered in place, nothing to copy */
+      else
+        ZB_copyFrameBuffer(zb, context->framebuffers[i], context->bytes_per_line);
+    }
+  } else if (flip == NULL) {
+    ZB_copyFrameBuffer(context->zbs[context->current], context->front,
+                       context->bytes_per_line);
+  } else {
+    zb = context->zbs[context->current];
+    ZB_binFlush(zb);
+
+    /* the previous buffer must have reached the front first */
+    pthread_mutex_lock(&flip->lock);
+    while (flip->zb != NULL)
+      pthread_cond_wait(&flip->cond, &flip->lock);
+    flip->zb = zb;
+    pthread_cond_broadcast(&flip->cond);
+    pthread_mutex_unlock(&flip->lock);
+
+    context->current = (context->current + 1) % context->numbuffers;
+    ostgl_make_current(context, context->current);
   }
+
+  context->swap_count++;
+  context->swap_ticks += clock() - start;
 }
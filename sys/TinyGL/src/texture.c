@@ -32,6 +32,9 @@ static void free_texture(GLContext *c,int h)
   }
   if (t->next!=NULL) t->next->prev=t->prev;
 
+  /* binned triangles may still sample the pixmaps */
+  ZB_binFlush(c->zb);
+
   for(i=0;i<MAX_TEXTURE_LEVELS;i++) {
     im=&t->images[i];
     if (im->pixmap != NULL) gl_free(im->pixmap);
@@ -157,7 +160,10 @@ void glopTexImage2D(GLContext *c,GLParam *p)
   im=&c->current_texture->images[level];
   im->xsize=width;
   im->ysize=height;
-  if (im->pixmap!=NULL) gl_free(im->pixmap);
+  if (im->pixmap!=NULL) {
+    ZB_binFlush(c->zb);
+    gl_free(im->pixmap);
+  }
 #if TGL_FEATURE_RENDER_BITS == 24 
   im->pixmap=gl_malloc(width*height*3);
   if(im->pixmap) {
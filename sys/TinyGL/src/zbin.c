@@ -0,0 +1,309 @@
+/*
+ * Tile-parallel rasterization.
+ *
+ * The geometry stays on the calling thread: the triangles it produces
+ * are recorded and binned to horizontal bands of the screen, one band
+ * per rasterizer thread.  At flush time every thread replays the
+ * commands of its own band through the usual scanline code, clipped to
+ * the band scan lines, so no two threads ever write the same pixel.
+ *
+ * A band always goes to the same thread, pinned to its own cpu, and the
+ * clears of a band are done by its owner: the pages of the Z buffer and
+ * of the colour buffer lying in a band are thus first touched, and
+ * allocated, in the cluster of the thread rasterizing it.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "zbuffer.h"
+
+#define ZB_BIN_TRIANGLE 0
+#define ZB_BIN_CLEAR    1
+
+typedef struct {
+    int type;
+    ZB_fillTriangleFunc fill;
+    PIXEL *texture;
+    ZBufferPoint p[3];		/* for a clear: z, r, g, b in p[0] */
+    int clear_z, clear_color;
+} ZBinCmd;
+
+typedef struct {
+    ZBuffer view;		/* the target ZBuffer clipped to the band */
+    int nb_cmds;
+    unsigned short cmds[ZB_BIN_MAX_CMDS];
+    struct ZBin *bin;
+    pthread_t thread;
+} ZBinBand;
+
+struct ZBin {
+    int nb_bands;
+    int nb_cmds;
+    int quit;
+    int round;			/* bumped each time the bins are flushed */
+    int pending;		/* workers still rasterizing this round */
+    pthread_mutex_t lock;
+    pthread_cond_t start;
+    pthread_cond_t done;
+    ZBinBand *bands;
+    ZBinCmd cmds[ZB_BIN_MAX_CMDS];
+};
+
+static inline int ZB_binHeight(ZBuffer *zb, struct ZBin *bin)
+{
+    return (zb->ysize + bin->nb_bands - 1) / bin->nb_bands;
+}
+
+/* replay the commands binned to a band */
+static void ZB_binRender(ZBinBand *band)
+{
+    ZBinCmd *cmd;
+    ZBufferPoint p[3];
+    int i;
+
+    for (i = 0; i < band->nb_cmds; i++) {
+	cmd = &band->bin->cmds[band->cmds[i]];
+
+	if (cmd->type == ZB_BIN_CLEAR) {
+	    ZB_clear(&band->view, cmd->clear_z, cmd->p[0].z,
+		     cmd->clear_color, cmd->p[0].r, cmd->p[0].g, cmd->p[0].b);
+	    continue;
+	}
+
+	/* the fill functions scribble on their points */
+	memcpy(p, cmd->p, sizeof(p));
+	band->view.current_texture = cmd->texture;
+	cmd->fill(&band->view, &p[0], &p[1], &p[2]);
+    }
+
+    band->nb_cmds = 0;
+}
+
+static void *ZB_binWorker(void *arg)
+{
+    ZBinBand *band = arg;
+    struct ZBin *bin = band->bin;
+    int round = 0;
+
+    pthread_mutex_lock(&bin->lock);
+
+    for (;;) {
+	while (!bin->quit && bin->round == round)
+	    pthread_cond_wait(&bin->start, &bin->lock);
+
+	if (bin->quit)
+	    break;
+
+	round = bin->round;
+	pthread_mutex_unlock(&bin->lock);
+
+	ZB_binRender(band);
+
+	pthread_mutex_lock(&bin->lock);
+	if (--bin->pending == 0)
+	    pthread_cond_signal(&bin->done);
+    }
+
+    pthread_mutex_unlock(&bin->lock);
+    return NULL;
+}
+
+int ZB_binOpen(ZBuffer *zb, int nb_threads)
+{
+    struct ZBin *bin;
+    pthread_attr_t attr;
+    int cpu_nr, i;
+
+    ZB_binClose(zb);
+
+    if (nb_threads > ZB_BIN_MAX_THREADS)
+	nb_threads = ZB_BIN_MAX_THREADS;
+    if (nb_threads > zb->ysize)
+	nb_threads = zb->ysize;
+    if (nb_threads <= 1)
+	return 0;
+
+    bin = gl_malloc(sizeof(struct ZBin));
+    if (bin == NULL)
+	return -1;
+
+    bin->bands = gl_zalloc(nb_threads * sizeof(ZBinBand));
+    if (bin->bands == NULL) {
+	gl_free(bin);
+	return -1;
+    }
+
+    bin->nb_bands = nb_threads;
+    bin->nb_cmds = 0;
+    bin->quit = 0;
+    bin->round = 0;
+    bin->pending = 0;
+    pthread_mutex_init(&bin->lock, NULL);
+    pthread_cond_init(&bin->start, NULL);
+    pthread_cond_init(&bin->done, NULL);
+
+    cpu_nr = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpu_nr <= 0)
+	cpu_nr = 1;
+
+    /* band 0 is rasterized by the calling thread itself */
+    bin->bands[0].bin = bin;
+
+    for (i = 1; i < nb_threads; i++) {
+	bin->bands[i].bin = bin;
+
+	pthread_attr_init(&attr);
+	pthread_attr_setcpuid_np(&attr, i % cpu_nr, NULL);
+
+	if (pthread_create(&bin->bands[i].thread, &attr,
+			   ZB_binWorker, &bin->bands[i]))
+	    break;
+    }
+
+    /* nothing is binned yet: just use fewer bands */
+    bin->nb_bands = i;
+    zb->bin = bin;
+
+    if (i == 1) {
+	ZB_binClose(zb);
+	return -1;
+    }
+
+    return 0;
+}
+
+void ZB_binClose(ZBuffer *zb)
+{
+    struct ZBin *bin = zb->bin;
+    int i;
+
+    if (bin == NULL)
+	return;
+
+    ZB_binFlush(zb);
+
+    pthread_mutex_lock(&bin->lock);
+    bin->quit = 1;
+    pthread_cond_broadcast(&bin->start);
+    pthread_mutex_unlock(&bin->lock);
+
+    for (i = 1; i < bin->nb_bands; i++)
+	pthread_join(bin->bands[i].thread, NULL);
+
+    pthread_cond_destroy(&bin->start);
+    pthread_cond_destroy(&bin->done);
+    pthread_mutex_destroy(&bin->lock);
+
+    zb->bin = NULL;
+    gl_free(bin->bands);
+    gl_free(bin);
+}
+
+void ZB_binFlush(ZBuffer *zb)
+{
+    struct ZBin *bin = zb->bin;
+    ZBinBand *band;
+    int h, i;
+
+    if (bin == NULL || bin->nb_cmds == 0)
+	return;
+
+    h = ZB_binHeight(zb, bin);
+
+    for (i = 0; i < bin->nb_bands; i++) {
+	band = &bin->bands[i];
+	band->view = *zb;
+	band->view.bin = NULL;
+	band->view.ymin = i * h;
+	band->view.ymax = (i + 1) * h;
+	if (band->view.ymax > zb->ysize)
+	    band->view.ymax = zb->ysize;
+    }
+
+    pthread_mutex_lock(&bin->lock);
+    bin->pending = bin->nb_bands - 1;
+    bin->round++;
+    pthread_cond_broadcast(&bin->start);
+    pthread_mutex_unlock(&bin->lock);
+
+    ZB_binRender(&bin->bands[0]);
+
+    pthread_mutex_lock(&bin->lock);
+    while (bin->pending != 0)
+	pthread_cond_wait(&bin->done, &bin->lock);
+    pthread_mutex_unlock(&bin->lock);
+
+    bin->nb_cmds = 0;
+}
+
+/* record a command, flushing the bins when they are full */
+static ZBinCmd *ZB_binAlloc(ZBuffer *zb)
+{
+    struct ZBin *bin = zb->bin;
+
+    if (bin->nb_cmds == ZB_BIN_MAX_CMDS)
+	ZB_binFlush(zb);
+
+    return &bin->cmds[bin->nb_cmds++];
+}
+
+void ZB_binTriangle(ZBuffer *zb, ZB_fillTriangleFunc fill,
+		    ZBufferPoint *p0, ZBufferPoint *p1, ZBufferPoint *p2)
+{
+    struct ZBin *bin = zb->bin;
+    ZBinCmd *cmd;
+    ZBinBand *band;
+    int ylo, yhi, h, i;
+
+    ylo = yhi = p0->y;
+    if (p1->y < ylo) ylo = p1->y;
+    if (p2->y < ylo) ylo = p2->y;
+    if (p1->y > yhi) yhi = p1->y;
+    if (p2->y > yhi) yhi = p2->y;
+
+    if (ylo < 0)
+	ylo = 0;
+    if (yhi >= zb->ysize)
+	yhi = zb->ysize - 1;
+    if (yhi < ylo)
+	return;
+
+    cmd = ZB_binAlloc(zb);
+    cmd->type = ZB_BIN_TRIANGLE;
+    cmd->fill = fill;
+    cmd->texture = zb->current_texture;
+    cmd->p[0] = *p0;
+    cmd->p[1] = *p1;
+    cmd->p[2] = *p2;
+
+    h = ZB_binHeight(zb, bin);
+
+    for (i = ylo / h; i <= yhi / h; i++) {
+	band = &bin->bands[i];
+	band->cmds[band->nb_cmds++] = bin->nb_cmds - 1;
+    }
+}
+
+void ZB_binClear(ZBuffer *zb, int clear_z, int z,
+		 int clear_color, int r, int g, int b)
+{
+    struct ZBin *bin = zb->bin;
+    ZBinCmd *cmd;
+    ZBinBand *band;
+    int i;
+
+    cmd = ZB_binAlloc(zb);
+    cmd->type = ZB_BIN_CLEAR;
+    cmd->clear_z = clear_z;
+    cmd->clear_color = clear_color;
+    cmd->p[0].z = z;
+    cmd->p[0].r = r;
+    cmd->p[0].g = g;
+    cmd->p[0].b = b;
+
+    for (i = 0; i < bin->nb_bands; i++) {
+	band = &bin->bands[i];
+	band->cmds[band->nb_cmds++] = bin->nb_cmds - 1;
+    }
+}
@@ -65,6 +65,9 @@ ZBuffer *ZB_open(int xsize, int ysize, int mode,
     }
 
     zb->current_texture = NULL;
+    zb->ymin = 0;
+    zb->ymax = zb->ysize;
+    zb->bin = NULL;
 
     return zb;
   error:
@@ -74,6 +77,8 @@ ZBuffer *ZB_open(int xsize, int ysize, int mode,
 
 void ZB_close(ZBuffer * zb)
 {
+    ZB_binClose(zb);
+
 #ifdef TGL_FEATURE_8_BITS
     if (zb->mode == ZB_MODE_INDEX)
 	ZB_closeDither(zb);
@@ -90,11 +95,16 @@ void ZB_resize(ZBuffer * zb, void *frame_buffer, int xsize, int ysize)
 {
     int size;
 
+    /* pending commands were binned for the old size */
+    ZB_binFlush(zb);
+
     /* xsize must be a multiple of 4 */
     xsize = xsize & ~3;
 
     zb->xsize = xsize;
     zb->ysize = ysize;
+    zb->ymin = 0;
+    zb->ymax = ysize;
     zb->linesize = (xsize * PSZB + 3) & ~3;
 
     size = zb->xsize * zb->ysize * sizeof(unsigned short);
@@ -274,6 +284,8 @@ static void ZB_copyFrameBufferRGB24(ZBuffer * zb,
 void ZB_copyFrameBuffer(ZBuffer * zb, void *buf,
 			int linesize)
 {
+    ZB_binFlush(zb);
+
     switch (zb->mode) {
 #ifdef TGL_FEATURE_8_BITS
     case ZB_MODE_INDEX:
@@ -336,6 +348,8 @@ static void ZB_copyFrameBuffer5R6G5B(ZBuffer * zb,
 void ZB_copyFrameBuffer(ZBuffer * zb, void *buf,
 			int linesize)
 {
+    ZB_binFlush(zb);
+
     switch (zb->mode) {
 #ifdef TGL_FEATURE_16_BITS
     case ZB_MODE_5R6G5B:
@@ -388,6 +402,8 @@ static void ZB_copyFrameBuffer5R6G5B(ZBuffer * zb,
 void ZB_copyFrameBuffer(ZBuffer * zb, void *buf,
 			int linesize)
 {
+    ZB_binFlush(zb);
+
     switch (zb->mode) {
 #ifdef TGL_FEATURE_16_BITS
     case ZB_MODE_5R6G5B:
@@ -496,11 +512,12 @@ void ZB_clear(ZBuffer * zb, int clear_z, int z,
     PIXEL *pp;
 
     if (clear_z) {
-	memset_s(zb->zbuf, z, zb->xsize * zb->ysize);
+	memset_s(zb->zbuf + zb->ymin * zb->xsize, z,
+		 zb->xsize * (zb->ymax - zb->ymin));
     }
     if (clear_color) {
-	pp = zb->pbuf;
-	for (y = 0; y < zb->ysize; y++) {
+	pp = (PIXEL *) ((char *) zb->pbuf + zb->ymin * zb->linesize);
+	for (y = zb->ymin; y < zb->ymax; y++) {
 #if TGL_FEATURE_RENDER_BITS == 15 || TGL_FEATURE_RENDER_BITS == 16
             color = RGB_TO_PIXEL(r, g, b);
 	    memset_s(pp, color, zb->xsize);
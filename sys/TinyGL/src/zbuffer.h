@@ -84,6 +84,9 @@ typedef struct {
     unsigned char *dctable;
     int *ctable;
     PIXEL *current_texture;
+
+    int ymin,ymax; /* triangles only touch the scan lines [ymin, ymax) */
+    struct ZBin *bin; /* tile-parallel rasterizer, NULL when serial */
 } ZBuffer;
 
 typedef struct {
@@ -145,6 +148,21 @@ void ZB_fillTriangleMappingPerspective(ZBuffer *zb,
 typedef void (*ZB_fillTriangleFunc)(ZBuffer  *,
 	    ZBufferPoint *,ZBufferPoint *,ZBufferPoint *);
 
+/* zbin.c */
+
+/* largest number of rasterizer threads (and screen bands) */
+#define ZB_BIN_MAX_THREADS 32
+/* commands recorded before the bins are flushed */
+#define ZB_BIN_MAX_CMDS    1024
+
+int ZB_binOpen(ZBuffer *zb,int nb_threads);
+void ZB_binClose(ZBuffer *zb);
+void ZB_binTriangle(ZBuffer *zb,ZB_fillTriangleFunc fill,
+		    ZBufferPoint *p0,ZBufferPoint *p1,ZBufferPoint *p2);
+void ZB_binClear(ZBuffer *zb,int clear_z,int z,
+		 int clear_color,int r,int g,int b);
+void ZB_binFlush(ZBuffer *zb);
+
 /* memory.c */
 void gl_free(void *p);
 void *gl_malloc(int size);
@@ -9,7 +9,7 @@
   PIXEL *pp1;
   int part,update_left,update_right;
 
-  int nb_lines,dx1,dy1,tmp,dx2,dy2;
+  int nb_lines,dx1,dy1,tmp,dx2,dy2,y;
 
   int error,derror;
   int x1,dxdy_min,dxdy_max;
@@ -68,6 +68,10 @@
     p2 = t;
   }
 
+  /* nothing to draw between the scan lines ymin and ymax of the buffer */
+  if (p2->y < zb->ymin || p0->y >= zb->ymax)
+    return;
+
   /* we compute dXdx and dXdy for all interpolated values */
   
   fdx1 = p1->x - p0->x;
@@ -152,6 +156,7 @@
 
   pp1 = (PIXEL *) ((char *) zb->pbuf + zb->linesize * p0->y);
   pz1 = zb->zbuf + p0->y * zb->xsize;
+  y = p0->y;
 
   DRAW_INIT();
 
@@ -258,9 +263,11 @@
 
     while (nb_lines>0) {
       nb_lines--;
+      if (y >= zb->ymax)
+        return;
 #ifndef DRAW_LINE
       /* generic draw line */
-      {
+      if (y >= zb->ymin) {
           register PIXEL *pp;
           register int n;
 #ifdef INTERP_Z
@@ -317,7 +324,8 @@
           }
       }
 #else
-      DRAW_LINE();
+      if (y >= zb->ymin)
+        DRAW_LINE();
 #endif
       
       /* left edge */
@@ -367,6 +375,7 @@
       /* screen coordinates */
       pp1=(PIXEL *)((char *)pp1 + zb->linesize);
       pz1+=zb->xsize;
+      y++;
     }
   }
 }
@@ -0,0 +1,27 @@
+#ifndef _POLL_H
+#define _POLL_H
+
+/* Must match the kernel's poll.h */
+#define POLLIN		0x001	/* there is data to read */
+#define POLLPRI		0x002	/* there is urgent data to read */
+#define POLLOUT		0x004	/* writing now will not block */
+#define POLLERR		0x008	/* error condition */
+#define POLLHUP		0x010	/* hung up */
+#define POLLNVAL	0x020	/* invalid file descriptor */
+
+#define POLLRDNORM	POLLIN
+#define POLLWRNORM	POLLOUT
+
+typedef unsigned int nfds_t;
+
+struct pollfd {
+  int fd;		/* file descriptor, ignored if negative */
+  short events;		/* requested events */
+  short revents;	/* returned events */
+};
+
+/* Wait up to timeout ms (forever if negative) for one of the files to
+ * be ready, return the number of ready files */
+int poll(struct pollfd *fds, nfds_t nfds, int timeout);
+
+#endif
@@ -73,6 +73,14 @@ enum
    SYS_FTIME,
    SYS_CHMOD,
    SYS_FSYNC,
+   SYS_FUTEX,
+   SYS_PREAD,
+   SYS_PWRITE,
+   SYS_READV,
+   SYS_WRITEV,
+   SYS_URING,
+   SYS_SENDFILE,
+   SYS_POLL,
    __SYS_CALL_SERVICES_NUM,
 };
 
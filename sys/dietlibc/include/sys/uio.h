@@ -0,0 +1,17 @@
+#ifndef _SYS_UIO_H
+#define _SYS_UIO_H
+
+#include <sys/types.h>
+
+/* Maximum number of vectors accepted by readv/writev */
+#define IOV_MAX		16
+
+struct iovec {
+  void *iov_base;	/* start of the buffer */
+  size_t iov_len;	/* size of the buffer */
+};
+
+ssize_t readv(int fd, const struct iovec *iov, int iovcnt);
+ssize_t writev(int fd, const struct iovec *iov, int iovcnt);
+
+#endif
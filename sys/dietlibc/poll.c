@@ -0,0 +1,34 @@
+/*
+   This file is part of MutekP.
+  
+   MutekP is free software; you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+  
+   MutekP is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+  
+   You should have received a copy of the GNU General Public License
+   along with MutekP; if not, write to the Free Software Foundation,
+   Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+  
+   UPMC / LIP6 / SOC (c) 2008
+   Copyright Ghassan Almaless <ghassan.almaless@gmail.com>
+*/
+
+#include <errno.h>
+#include <sys/syscall.h>
+#include <cpu-syscall.h>
+#include <poll.h>
+
+int poll (struct pollfd *fds, nfds_t nfds, int timeout)
+{
+  register int count;
+
+  count = (int) cpu_syscall(fds, (void*)nfds, (void*)timeout, NULL, SYS_POLL);
+
+  return count;
+}
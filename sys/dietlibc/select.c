@@ -0,0 +1,96 @@
+/*
+   This file is part of MutekP.
+  
+   MutekP is free software; you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+  
+   MutekP is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+  
+   You should have received a copy of the GNU General Public License
+   along with MutekP; if not, write to the Free Software Foundation,
+   Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+  
+   UPMC / LIP6 / SOC (c) 2008
+   Copyright Ghassan Almaless <ghassan.almaless@gmail.com>
+*/
+
+#include <errno.h>
+#include <poll.h>
+#include <sys/select.h>
+
+/* select is built on poll, a task has few enough descriptors for the
+ * pollfd table to live on the stack */
+int select (int nfds, fd_set *readfds, fd_set *writefds, fd_set *exceptfds, struct timeval *timeout)
+{
+  struct pollfd fds[FD_SETSIZE];
+  unsigned long rset, wset, eset;
+  int count, ms, fd, i, n;
+
+  if((nfds < 0) || (nfds > FD_SETSIZE))
+  {
+    errno = EINVAL;
+    return -1;
+  }
+
+  rset = (readfds)   ? readfds->fds_bits   : 0;
+  wset = (writefds)  ? writefds->fds_bits  : 0;
+  eset = (exceptfds) ? exceptfds->fds_bits : 0;
+
+  for(n = 0, fd = 0; fd < nfds; fd++)
+  {
+    if(!((rset | wset | eset) & (1UL << fd)))
+      continue;
+
+    fds[n].fd      = fd;
+    fds[n].events  = (rset & (1UL << fd)) ? POLLIN : 0;
+    fds[n].events |= (wset & (1UL << fd)) ? POLLOUT : 0;
+    fds[n].events |= (eset & (1UL << fd)) ? POLLPRI : 0;
+    fds[n].revents = 0;
+    n++;
+  }
+
+  ms = (timeout) ? (int)(timeout->tv_sec * 1000 + timeout->tv_usec / 1000) : -1;
+
+  if(poll(fds, n, ms) < 0)
+    return -1;
+
+  if(readfds)   FD_ZERO(readfds);
+  if(writefds)  FD_ZERO(writefds);
+  if(exceptfds) FD_ZERO(exceptfds);
+
+  for(count = 0, i = 0; i < n; i++)
+  {
+    fd = fds[i].fd;
+
+    if(fds[i].revents & POLLNVAL)
+    {
+      errno = EBADF;
+      return -1;
+    }
+
+    if((rset & (1UL << fd)) && (fds[i].revents & (POLLIN | POLLHUP | POLLERR)))
+    {
+      FD_SET(fd, readfds);
+      count++;
+    }
+
+    if((wset & (1UL << fd)) && (fds[i].revents & (POLLOUT | POLLERR)))
+    {
+      FD_SET(fd, writefds);
+      count++;
+    }
+
+    if((eset & (1UL << fd)) && (fds[i].revents & POLLPRI))
+    {
+      FD_SET(fd, exceptfds);
+      count++;
+    }
+  }
+
+  return count;
+}
@@ -0,0 +1,245 @@
+/*
+   This file is part of MutekP.
+  
+   MutekP is free software; you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+  
+   MutekP is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+  
+   You should have received a copy of the GNU General Public License
+   along with MutekP; if not, write to the Free Software Foundation,
+   Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+  
+   UPMC / LIP6 / SOC (c) 2008
+   Copyright Ghassan Almaless <ghassan.almaless@gmail.com>
+*/
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <cpu-syscall.h>
+#include <sys/uring.h>
+
+/* Must match the kernel's uring.h */
+#define URING_ENTER         0
+#define URING_WORKER        1
+
+#define URING_WORKER_ON     0x01
+#define URING_WORKER_IDLE   0x02
+#define URING_CQ_FULL       0x04
+#define URING_KBUSY         0x08
+#define URING_KWAIT         0x10
+
+#define URING_WORKER_STOP   0x01
+#define URING_CQ_WAITER     0x100
+
+#define FUTEX_WAIT          0
+#define FUTEX_WAKE          1
+
+/* Words written by the kernel, possibly from another cpu */
+static inline unsigned int uring_load(volatile unsigned int *ptr)
+{
+  cpu_invalid_dcache_line((void*)ptr);
+  return *ptr;
+}
+
+static inline void uring_futex_wake(volatile unsigned int *ptr, unsigned int count)
+{
+  cpu_syscall((void*)ptr, (void*)FUTEX_WAKE, NULL, (void*)count, SYS_FUTEX);
+}
+
+static inline void uring_futex_wait(volatile unsigned int *ptr, unsigned int val)
+{
+  cpu_syscall((void*)ptr, (void*)FUTEX_WAIT, (void*)val, NULL, SYS_FUTEX);
+}
+
+/* uflags is shared by the task threads */
+static inline void uring_uflags_set(struct uring *ring, unsigned int flag)
+{
+  unsigned int uflags;
+
+  do
+  {
+    uflags = ring->uflags;
+  }while(!cpu_atomic_cas((void*)&ring->uflags, uflags, uflags | flag));
+}
+
+/* 
+ * Sleep until the kernel thread holding URING_KBUSY releases the ring,
+ * it then wakes up the kflags futex as URING_KWAIT is set.
+ */
+static inline void uring_kbusy_wait(struct uring *ring, unsigned int kflags)
+{
+  if(kflags & URING_KWAIT)
+  {
+    uring_futex_wait(&ring->kflags, kflags);
+    return;
+  }
+
+  if(cpu_atomic_cas((void*)&ring->kflags, kflags, kflags | URING_KWAIT))
+    uring_futex_wait(&ring->kflags, kflags | URING_KWAIT);
+}
+
+int uring_init(struct uring *ring, unsigned int entries)
+{
+  if((entries == 0) || (entries > URING_ENTRIES_MAX) || (entries & (entries - 1)))
+  {
+    errno = EINVAL;
+    return -1;
+  }
+
+  memset(ring, 0, sizeof(*ring));
+  ring->entries = entries;
+  ring->sqes    = malloc(entries * sizeof(struct uring_sqe));
+  ring->cqes    = malloc(entries * sizeof(struct uring_cqe));
+
+  if((ring->sqes == NULL) || (ring->cqes == NULL))
+  {
+    free(ring->sqes);
+    free(ring->cqes);
+    errno = ENOMEM;
+    return -1;
+  }
+
+  return 0;
+}
+
+void uring_destroy(struct uring *ring)
+{
+  uring_stop(ring);
+  free(ring->sqes);
+  free(ring->cqes);
+  ring->sqes = NULL;
+  ring->cqes = NULL;
+}
+
+struct uring_sqe *uring_get_sqe(struct uring *ring)
+{
+  struct uring_sqe *sqe;
+
+  if((ring->sq_local - uring_load(&ring->sq_head)) >= ring->entries)
+    return NULL;
+
+  sqe = &ring->sqes[ring->sq_local & (ring->entries - 1)];
+  ring->sq_local ++;
+  return sqe;
+}
+
+int uring_submit(struct uring *ring)
+{
+  unsigned int count;
+  unsigned int kflags;
+  int done;
+
+  count = ring->sq_local - ring->sq_tail;
+
+  if(count == 0)
+    return 0;
+
+  cpu_wbflush();
+  ring->sq_tail = ring->sq_local;
+  cpu_wbflush();
+
+  kflags = uring_load(&ring->kflags);
+
+  /* A running worker consumes the entries, only trap to wake it up */
+  if(kflags & URING_WORKER_ON)
+  {
+    if(kflags & URING_WORKER_IDLE)
+      uring_futex_wake(&ring->sq_tail, 1);
+
+    return count;
+  }
+
+  done = (int)cpu_syscall(ring, (void*)URING_ENTER, (void*)count, NULL, SYS_URING);
+
+  return done;
+}
+
+int uring_peek_cqe(struct uring *ring, struct uring_cqe **cqe)
+{
+  struct uring_cqe *entry;
+
+  if(ring->cq_head == uring_load(&ring->cq_tail))
+    return EAGAIN;
+
+  entry = &ring->cqes[ring->cq_head & (ring->entries - 1)];
+  cpu_invalid_dcache_line(entry);
+  *cqe = entry;
+  return 0;
+}
+
+int uring_wait_cqe(struct uring *ring, struct uring_cqe **cqe)
+{
+  unsigned int kflags;
+  unsigned int tail;
+
+  while(uring_peek_cqe(ring, cqe) == EAGAIN)
+  {
+    kflags = uring_load(&ring->kflags);
+
+    /* Submissions left to the kernel without a worker: consume them now,
+     * or wait for the thread already consuming them inline */
+    if(!(kflags & URING_WORKER_ON) &&
+       (uring_load(&ring->sq_head) != ring->sq_tail))
+    {
+      if(kflags & URING_KBUSY)
+      {
+	uring_kbusy_wait(ring, kflags);
+	continue;
+      }
+
+      if(cpu_syscall(ring, (void*)URING_ENTER, (void*)ring->entries, NULL, SYS_URING) == (void*)-1)
+	return errno;
+
+      continue;
+    }
+
+    if(!(kflags & URING_WORKER_ON))
+      return EAGAIN;
+
+    cpu_atomic_add((void*)&ring->uflags, URING_CQ_WAITER);
+    cpu_wbflush();
+    tail = uring_load(&ring->cq_tail);
+
+    if(tail == ring->cq_head)
+      uring_futex_wait(&ring->cq_tail, tail);
+
+    cpu_atomic_add((void*)&ring->uflags, -URING_CQ_WAITER);
+  }
+
+  return 0;
+}
+
+void uring_cqe_seen(struct uring *ring)
+{
+  cpu_wbflush();
+  ring->cq_head ++;
+  cpu_wbflush();
+
+  if(uring_load(&ring->kflags) & URING_CQ_FULL)
+    uring_futex_wake(&ring->cq_head, 1);
+}
+
+int uring_worker(struct uring *ring)
+{
+  return (int)cpu_syscall(ring, (void*)URING_WORKER, NULL, NULL, SYS_URING);
+}
+
+void uring_stop(struct uring *ring)
+{
+  uring_uflags_set(ring, URING_WORKER_STOP);
+  cpu_wbflush();
+
+  if(uring_load(&ring->kflags) & URING_WORKER_ON)
+  {
+    uring_futex_wake(&ring->sq_tail, 1);
+    uring_futex_wake(&ring->cq_head, 1);
+  }
+}
@@ -196,6 +196,22 @@ unsigned char *SHA512(const unsigned char *d, size_t n,unsigned char *md);
 void SHA512_Transform(SHA512_CTX *c, const unsigned char *data);
 #endif
 
+/* Parallel hashing: SHA_batch() hashes count independent buffers, each to
+ * its own digest in md, and SHA_tree() hashes a single buffer as a tree of
+ * leaf byte leaves (SHA_TREE_LEAF if 0).  nthreads of 0 uses every online
+ * cpu.  The digests are SHA_md_size(alg) bytes long. */
+#define SHA_ALG_SHA1	1
+#define SHA_ALG_SHA224	2
+#define SHA_ALG_SHA256	3
+#define SHA_ALG_SHA384	4
+#define SHA_ALG_SHA512	5
+#define SHA_TREE_LEAF	(64*1024)
+size_t SHA_md_size(int alg);
+int SHA_batch(int alg, const unsigned char *const *d, const size_t *n,
+	size_t count, unsigned char *md, int nthreads);
+unsigned char *SHA_tree(int alg, const unsigned char *d, size_t n,
+	size_t leaf, unsigned char *md, int nthreads);
+
 #ifdef  __cplusplus
 }
 #endif
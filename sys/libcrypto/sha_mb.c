@@ -0,0 +1,257 @@
+/* crypto/sha/sha_mb.c */
+/* ====================================================================
+ * Parallel hashing on top of the sequential SHA digests.
+ *
+ * SHA_batch() hashes many independent buffers, each to its own digest,
+ * and SHA_tree() hashes a single large buffer as a two level tree: the
+ * input is cut in fixed size leaves, each leaf is hashed on its own as
+ * H(0x00 || leaf), and the root is H(0x01 || leaf size || leaf digests),
+ * the leaf size as 64-bit big-endian.  The leaf size is part of the root
+ * so that two leaf sizes never give the same digest.
+ *
+ * Both hand out their jobs, a buffer or a leaf, one at a time to a set
+ * of threads pinned on distinct cpus, the calling thread included: the
+ * jobs need not be of the same size.
+ * ====================================================================
+ */
+#if !defined(OPENSSL_NO_SHA)
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include <openssl/crypto.h>
+#include <openssl/sha.h>
+
+#define SHA_MB_MAX_THREADS	64
+
+typedef union
+	{
+	SHA_CTX sha1;
+	SHA256_CTX sha256;
+	SHA512_CTX sha512;
+	} SHA_MB_CTX;
+
+typedef struct
+	{
+	int alg;
+	size_t md_len;
+	size_t count;			/* number of jobs */
+	size_t next;			/* next job to hand out */
+	const unsigned char *const *d;	/* SHA_batch() buffers */
+	const size_t *n;
+	const unsigned char *data;	/* SHA_tree() input */
+	size_t len;
+	size_t leaf;
+	unsigned char *md;		/* md_len bytes per job */
+	pthread_mutex_t lock;
+	} SHA_MB_JOBS;
+
+size_t SHA_md_size(int alg)
+	{
+	switch (alg)
+		{
+	case SHA_ALG_SHA1:	return SHA_DIGEST_LENGTH;
+	case SHA_ALG_SHA224:	return SHA224_DIGEST_LENGTH;
+	case SHA_ALG_SHA256:	return SHA256_DIGEST_LENGTH;
+	case SHA_ALG_SHA384:	return SHA384_DIGEST_LENGTH;
+	case SHA_ALG_SHA512:	return SHA512_DIGEST_LENGTH;
+		}
+	return 0;
+	}
+
+static void sha_mb_init(int alg, SHA_MB_CTX *c)
+	{
+	switch (alg)
+		{
+	case SHA_ALG_SHA1:	SHA1_Init(&c->sha1);		break;
+	case SHA_ALG_SHA224:	SHA224_Init(&c->sha256);	break;
+	case SHA_ALG_SHA256:	SHA256_Init(&c->sha256);	break;
+	case SHA_ALG_SHA384:	SHA384_Init(&c->sha512);	break;
+	case SHA_ALG_SHA512:	SHA512_Init(&c->sha512);	break;
+		}
+	}
+
+static void sha_mb_update(int alg, SHA_MB_CTX *c, const void *data, size_t len)
+	{
+	switch (alg)
+		{
+	case SHA_ALG_SHA1:
+		SHA1_Update(&c->sha1,data,len);
+		break;
+	case SHA_ALG_SHA224:
+	case SHA_ALG_SHA256:
+		SHA256_Update(&c->sha256,data,len);
+		break;
+	case SHA_ALG_SHA384:
+	case SHA_ALG_SHA512:
+		SHA512_Update(&c->sha512,data,len);
+		break;
+		}
+	}
+
+static void sha_mb_final(int alg, unsigned char *md, SHA_MB_CTX *c)
+	{
+	switch (alg)
+		{
+	case SHA_ALG_SHA1:
+		SHA1_Final(md,&c->sha1);
+		break;
+	case SHA_ALG_SHA224:
+	case SHA_ALG_SHA256:
+		SHA256_Final(md,&c->sha256);
+		break;
+	case SHA_ALG_SHA384:
+	case SHA_ALG_SHA512:
+		SHA512_Final(md,&c->sha512);
+		break;
+		}
+	OPENSSL_cleanse(c,sizeof(*c));
+	}
+
+/* hash a buffer of a batch, or a leaf of a tree */
+static void sha_mb_job(SHA_MB_JOBS *j, size_t i)
+	{
+	static const unsigned char leaf_tag = 0x00;
+	SHA_MB_CTX c;
+	size_t off, len;
+
+	sha_mb_init(j->alg,&c);
+
+	if (j->d != NULL)
+		sha_mb_update(j->alg,&c,j->d[i],j->n[i]);
+	else
+		{
+		off = i * j->leaf;
+		len = j->len - off;
+		if (len > j->leaf) len = j->leaf;
+
+		sha_mb_update(j->alg,&c,&leaf_tag,1);
+		sha_mb_update(j->alg,&c,j->data + off,len);
+		}
+
+	sha_mb_final(j->alg,j->md + i * j->md_len,&c);
+	}
+
+static void *sha_mb_worker(void *arg)
+	{
+	SHA_MB_JOBS *j = arg;
+	size_t i;
+
+	for (;;)
+		{
+		pthread_mutex_lock(&j->lock);
+		i = j->next;
+		if (i < j->count) j->next++;
+		pthread_mutex_unlock(&j->lock);
+
+		if (i >= j->count)
+			break;
+
+		sha_mb_job(j,i);
+		}
+
+	return NULL;
+	}
+
+static void sha_mb_run(SHA_MB_JOBS *j, int nthreads)
+	{
+	pthread_t threads[SHA_MB_MAX_THREADS];
+	pthread_attr_t attr;
+	int cpu_nr, i, n;
+
+	cpu_nr = sysconf(_SC_NPROCESSORS_ONLN);
+	if (cpu_nr <= 0) cpu_nr = 1;
+
+	if (nthreads <= 0) nthreads = cpu_nr;
+	if (nthreads > SHA_MB_MAX_THREADS) nthreads = SHA_MB_MAX_THREADS;
+	if ((size_t)nthreads > j->count) nthreads = (int)j->count;
+
+	j->next = 0;
+	pthread_mutex_init(&j->lock,NULL);
+
+	/* a thread that cannot be created leaves its share to the others */
+	for (n = 0, i = 1; i < nthreads; i++)
+		{
+		pthread_attr_init(&attr);
+		pthread_attr_setcpuid_np(&attr,i % cpu_nr,NULL);
+
+		if (pthread_create(&threads[n],&attr,sha_mb_worker,j) == 0)
+			n++;
+		}
+
+	sha_mb_worker(j);
+
+	for (i = 0; i < n; i++)
+		pthread_join(threads[i],NULL);
+
+	pthread_mutex_destroy(&j->lock);
+	}
+
+int SHA_batch(int alg, const unsigned char *const *d, const size_t *n,
+	      size_t count, unsigned char *md, int nthreads)
+	{
+	SHA_MB_JOBS j;
+
+	if ((j.md_len = SHA_md_size(alg)) == 0)
+		return 0;
+	if (count == 0)
+		return 1;
+
+	j.alg = alg;
+	j.count = count;
+	j.d = d;
+	j.n = n;
+	j.data = NULL;
+	j.len = 0;
+	j.leaf = 0;
+	j.md = md;
+
+	sha_mb_run(&j,nthreads);
+	return 1;
+	}
+
+unsigned char *SHA_tree(int alg, const unsigned char *d, size_t n,
+			size_t leaf, unsigned char *md, int nthreads)
+	{
+	static const unsigned char root_tag = 0x01;
+	static unsigned char m[SHA512_DIGEST_LENGTH];
+	unsigned char size[8];
+	SHA_MB_JOBS j;
+	SHA_MB_CTX c;
+	int i;
+
+	if ((j.md_len = SHA_md_size(alg)) == 0)
+		return NULL;
+
+	if (md == NULL) md=m;
+	if (leaf == 0) leaf = SHA_TREE_LEAF;
+
+	j.alg = alg;
+	j.count = (n != 0) ? (n - 1) / leaf + 1 : 1;
+	j.d = NULL;
+	j.n = NULL;
+	j.data = d;
+	j.len = n;
+	j.leaf = leaf;
+
+	if ((j.md = malloc(j.count * j.md_len)) == NULL)
+		return NULL;
+
+	sha_mb_run(&j,nthreads);
+
+	for (i = 0; i < 8; i++)
+		size[i] = (unsigned char)((SHA_LONG64)leaf >> ((7 - i) * 8));
+
+	sha_mb_init(alg,&c);
+	sha_mb_update(alg,&c,&root_tag,1);
+	sha_mb_update(alg,&c,size,sizeof(size));
+	sha_mb_update(alg,&c,j.md,j.count * j.md_len);
+	sha_mb_final(alg,md,&c);
+
+	free(j.md);
+	return(md);
+	}
+
+#endif
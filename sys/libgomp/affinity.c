@@ -22,17 +22,325 @@
    see the files COPYING3 and COPYING.RUNTIME respectively.  If not, see
    <http://www.gnu.org/licenses/>.  */
 
-/* This is a generic stub implementation of a CPU affinity setting.  */
+/* This file handles thread placement: the OMP_PLACES list, the
+   OMP_PROC_BIND policy, and the cpu each team member is created on.  */
 
 #include <gomp/libgomp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <cpu-syscall.h>
+
+enum gomp_proc_bind gomp_proc_bind_var = GOMP_PROC_BIND_UNSET;
+bool gomp_display_affinity_var;
+struct gomp_place *gomp_places_list;
+size_t gomp_places_list_len;
+unsigned short *gomp_places_cpus;
+
+static size_t gomp_places_list_size;
+static size_t gomp_places_cpus_len, gomp_places_cpus_size;
+
+/* The kernel numbers cpus cluster by cluster:
+   cpu_gid = cid * cpus_per_cluster + cpu_lid.  */
+static unsigned long gomp_onln_cpus, gomp_cpus_per_cluster;
+
+static void
+gomp_init_topology (void)
+{
+  long cpus, clusters;
+
+  if (gomp_onln_cpus != 0)
+    return;
+
+  cpus = sysconf (_SC_NPROCESSORS_ONLN);
+  clusters = sysconf (_SC_NCLUSTERS_ONLN);
+  if (cpus < 1)
+    cpus = 1;
+  if (clusters < 1 || clusters > cpus)
+    clusters = 1;
+  gomp_cpus_per_cluster = cpus / clusters;
+  gomp_onln_cpus = cpus;
+}
+
+/* Report the cpus per cluster and the number of online clusters.  */
+
+void
+gomp_affinity_topology (unsigned *cpus_per_cluster, unsigned *clusters)
+{
+  gomp_init_topology ();
+  *cpus_per_cluster = gomp_cpus_per_cluster;
+  *clusters = gomp_onln_cpus / gomp_cpus_per_cluster;
+}
+
+/* Start a new, empty place at the end of the place list.  */
+
+int
+gomp_affinity_new_place (void)
+{
+  if (gomp_places_list_len == gomp_places_list_size)
+    {
+      size_t size = gomp_places_list_size ? 2 * gomp_places_list_size : 16;
+      struct gomp_place *list;
+
+      list = realloc (gomp_places_list, size * sizeof (struct gomp_place));
+      if (list == NULL)
+	{
+	  gomp_error ("not enough memory to store OMP_PLACES list");
+	  return false;
+	}
+      gomp_places_list = list;
+      gomp_places_list_size = size;
+    }
+
+  gomp_places_list[gomp_places_list_len].first = gomp_places_cpus_len;
+  gomp_places_list[gomp_places_list_len].len = 0;
+  gomp_places_list_len++;
+  return true;
+}
+
+/* Add LEN cpus, from FIRST by STRIDE, to the last place.  Fails if one
+   of them is not online.  */
+
+int
+gomp_affinity_add_cpus (unsigned long first, unsigned long len, long stride)
+{
+  struct gomp_place *place = &gomp_places_list[gomp_places_list_len - 1];
+
+  gomp_init_topology ();
+  for (; len > 0; len--, first += stride)
+    {
+      if (first >= gomp_onln_cpus)
+	return false;
+      if (gomp_places_cpus_len == gomp_places_cpus_size)
+	{
+	  size_t size = gomp_places_cpus_size ? 2 * gomp_places_cpus_size : 64;
+	  unsigned short *cpus;
+
+	  cpus = realloc (gomp_places_cpus, size * sizeof (unsigned short));
+	  if (cpus == NULL)
+	    {
+	      gomp_error ("not enough memory to store OMP_PLACES list");
+	      return false;
+	    }
+	  gomp_places_cpus = cpus;
+	  gomp_places_cpus_size = size;
+	}
+      gomp_places_cpus[gomp_places_cpus_len++] = first;
+      place->len++;
+    }
+  return true;
+}
+
+/* Build the places of an abstract OMP_PLACES name: one place per cpu
+   (LEVEL 1) or per cluster (LEVEL 2), at most COUNT of them.  */
+
+int
+gomp_affinity_init_level (int level, unsigned long count)
+{
+  unsigned long width, cpu;
+
+  gomp_init_topology ();
+  width = level == 2 ? gomp_cpus_per_cluster : 1;
+  gomp_places_list_len = 0;
+  gomp_places_cpus_len = 0;
+
+  for (cpu = 0; cpu + width <= gomp_onln_cpus; cpu += width)
+    {
+      if (gomp_places_list_len == count)
+	break;
+      if (!gomp_affinity_new_place ()
+	  || !gomp_affinity_add_cpus (cpu, width, 1))
+	return false;
+    }
+  return true;
+}
+
+static void
+gomp_display_places (void)
+{
+  static const char *const names[] = {
+    "unset", "false", "true", "master", "close", "spread"
+  };
+  size_t p, c;
+
+  fprintf (stderr, "libgomp: OMP_PROC_BIND='%s' OMP_PLACES='",
+	   names[gomp_proc_bind_var]);
+  for (p = 0; p < gomp_places_list_len; p++)
+    {
+      fputs (p ? ",{" : "{", stderr);
+      for (c = 0; c < gomp_places_list[p].len; c++)
+	fprintf (stderr, c ? ",%u" : "%u",
+		 gomp_places_cpus[gomp_places_list[p].first + c]);
+      fputc ('}', stderr);
+    }
+  fputs ("'\n", stderr);
+}
+
+/* Called once the OMP_PLACES, OMP_PROC_BIND and GOMP_CPU_AFFINITY
+   variables have been parsed, to settle on the place list.  */
 
 void
 gomp_init_affinity (void)
 {
+  size_t i;
+
+  gomp_init_topology ();
+
+  /* GOMP_CPU_AFFINITY gives one place per listed cpu, bound close.  */
+  if (gomp_places_list_len == 0 && gomp_cpu_affinity != NULL)
+    {
+      for (i = 0; i < gomp_cpu_affinity_len; i++)
+	if (!gomp_affinity_new_place ()
+	    || !gomp_affinity_add_cpus (gomp_cpu_affinity[i], 1, 1))
+	  {
+	    gomp_error ("Invalid cpu %u in GOMP_CPU_AFFINITY",
+			gomp_cpu_affinity[i]);
+	    gomp_places_list_len = 0;
+	    break;
+	  }
+      if (gomp_places_list_len != 0
+	  && gomp_proc_bind_var == GOMP_PROC_BIND_UNSET)
+	gomp_proc_bind_var = GOMP_PROC_BIND_CLOSE;
+    }
+
+  if (gomp_places_list_len == 0 && gomp_proc_bind_var > GOMP_PROC_BIND_FALSE)
+    gomp_affinity_init_level (1, ULONG_MAX);
+  else if (gomp_places_list_len != 0
+	   && gomp_proc_bind_var == GOMP_PROC_BIND_UNSET)
+    gomp_proc_bind_var = GOMP_PROC_BIND_TRUE;
+
+  if (gomp_display_affinity_var)
+    gomp_display_places ();
+}
+
+static inline bool
+gomp_place_in_cluster (struct gomp_place *place, unsigned long cid)
+{
+  return place->len != 0
+	 && gomp_places_cpus[place->first] / gomp_cpus_per_cluster == cid;
+}
+
+/* Position of CPU in PLACE, or -1.  */
+
+static int
+gomp_place_find (struct gomp_place *place, int cpu)
+{
+  unsigned c;
+
+  for (c = 0; c < place->len; c++)
+    if (gomp_places_cpus[place->first + c] == cpu)
+      return c;
+  return -1;
 }
 
+/* Return the cpu member I of an NTHREADS team should be created on, given
+   the cpu MASTER_CPU its master runs on, or -1 to let the kernel choose
+   one from the DQDT.  A NESTED team is kept on its master's cluster.  */
+
+int
+gomp_affinity_cpu (unsigned nthreads, unsigned i, int master_cpu, int nested)
+{
+  enum gomp_proc_bind bind = gomp_proc_bind_var;
+  unsigned long cid, nplaces, p0, k, j;
+  struct gomp_place *place = NULL;
+  bool local = false;
+  size_t p;
+  int off;
+
+  if (bind == GOMP_PROC_BIND_FALSE)
+    return -1;
+
+  gomp_init_topology ();
+  if (master_cpu < 0 || (unsigned long) master_cpu >= gomp_onln_cpus)
+    master_cpu = 0;
+  cid = master_cpu / gomp_cpus_per_cluster;
+
+  if (gomp_places_list_len == 0)
+    {
+      /* Historical numbering: member I on cpu I, the master's own cpu
+	 swapped with cpu 0; nested teams fill their master's cluster.  */
+      if (nested)
+	return cid * gomp_cpus_per_cluster
+	       + (master_cpu + i) % gomp_cpus_per_cluster;
+      return i == (unsigned) master_cpu ? 0 : (int) i;
+    }
+
+  /* The team spreads over all places, or only over those of the
+     master's cluster for a nested team.  */
+  if (nested)
+    for (p = 0; p < gomp_places_list_len && !local; p++)
+      local = gomp_place_in_cluster (&gomp_places_list[p], cid);
+
+  nplaces = 0;
+  p0 = 0;
+  for (p = 0; p < gomp_places_list_len; p++)
+    {
+      if (local && !gomp_place_in_cluster (&gomp_places_list[p], cid))
+	continue;
+      if (gomp_place_find (&gomp_places_list[p], master_cpu) >= 0)
+	p0 = nplaces;
+      nplaces++;
+    }
+
+  if (bind == GOMP_PROC_BIND_MASTER)
+    {
+      k = 0;
+      j = i;
+    }
+  else if (nthreads <= nplaces)
+    {
+      if (bind == GOMP_PROC_BIND_CLOSE
+	  || (bind == GOMP_PROC_BIND_TRUE && nested))
+	k = i;
+      else
+	k = i * nplaces / nthreads;
+      j = 0;
+    }
+  else
+    {
+      k = i * nplaces / nthreads;
+      j = i - (k * nthreads + nplaces - 1) / nplaces;
+    }
+
+  k = (p0 + k) % nplaces;
+  for (p = 0; p < gomp_places_list_len; p++)
+    {
+      if (local && !gomp_place_in_cluster (&gomp_places_list[p], cid))
+	continue;
+      if (k-- == 0)
+	{
+	  place = &gomp_places_list[p];
+	  break;
+	}
+    }
+
+  if (place->len == 0)
+    return -1;
+
+  /* Members sharing the master's place start after the master's cpu.  */
+  off = gomp_place_find (place, master_cpu);
+  if (off < 0)
+    off = 0;
+  return gomp_places_cpus[place->first + (off + j) % place->len];
+}
+
+/* Report where the calling thread runs, for OMP_DISPLAY_AFFINITY.  The
+   attributes cached in the TLS are refreshed first: they hold the cpu
+   asked for at creation, which is -1 or stale once the thread has been
+   placed.  */
+
 void
-gomp_init_thread_affinity (pthread_attr_t *attr)
+gomp_display_affinity (struct gomp_thread *thr)
 {
-  (void) attr;
+  __pthread_tls_t *tls;
+  int cpu = -1;
+
+  tls = cpu_get_tls ();
+  cpu_syscall (&tls->attr, NULL, NULL, NULL, SYS_GETATTR);
+  pthread_attr_getcpuid_np (&cpu);
+  fprintf (stderr, "libgomp: level %u thread %u on cpu %d cluster %u\n",
+	   thr->ts.level, thr->ts.team_id, cpu, (unsigned) getcid ());
 }
@@ -378,6 +378,182 @@ parse_wait_policy (void)
   return -1;
 }
 
+/* Parse the OMP_PROC_BIND environment variable and store the result in
+   gomp_proc_bind_var.  */
+
+static void
+parse_proc_bind (void)
+{
+  const char *env;
+
+  env = getenv ("OMP_PROC_BIND");
+  if (env == NULL)
+    return;
+
+  while (isspace ((unsigned char) *env))
+    ++env;
+  if (strncasecmp (env, "true", 4) == 0)
+    {
+      gomp_proc_bind_var = GOMP_PROC_BIND_TRUE;
+      env += 4;
+    }
+  else if (strncasecmp (env, "false", 5) == 0)
+    {
+      gomp_proc_bind_var = GOMP_PROC_BIND_FALSE;
+      env += 5;
+    }
+  else if (strncasecmp (env, "master", 6) == 0)
+    {
+      gomp_proc_bind_var = GOMP_PROC_BIND_MASTER;
+      env += 6;
+    }
+  else if (strncasecmp (env, "close", 5) == 0)
+    {
+      gomp_proc_bind_var = GOMP_PROC_BIND_CLOSE;
+      env += 5;
+    }
+  else if (strncasecmp (env, "spread", 6) == 0)
+    {
+      gomp_proc_bind_var = GOMP_PROC_BIND_SPREAD;
+      env += 6;
+    }
+  else
+    env = "X";
+  while (isspace ((unsigned char) *env))
+    ++env;
+  if (*env != '\0')
+    {
+      gomp_proc_bind_var = GOMP_PROC_BIND_UNSET;
+      gomp_error ("Invalid value for environment variable OMP_PROC_BIND");
+    }
+}
+
+/* Parse the OMP_PLACES environment variable.  The abstract names
+   "threads" and "cores" give one place per cpu, "sockets" and "clusters"
+   one place per cluster, optionally limited to the first N by "(N)".
+   Otherwise it is a list of places like {0:4},{4,5,6,7},{8:4:2}, each
+   item being CPU[:LEN[:STRIDE]].  Return true if a valid list was
+   present.  */
+
+static bool
+parse_places (void)
+{
+  char *env, *end;
+  unsigned long count = ULONG_MAX, first, len;
+  long stride;
+  int level = 0;
+
+  env = getenv ("OMP_PLACES");
+  if (env == NULL)
+    return false;
+
+  while (isspace ((unsigned char) *env))
+    ++env;
+  if (strncasecmp (env, "threads", 7) == 0)
+    {
+      level = 1;
+      env += 7;
+    }
+  else if (strncasecmp (env, "cores", 5) == 0)
+    {
+      level = 1;
+      env += 5;
+    }
+  else if (strncasecmp (env, "sockets", 7) == 0)
+    {
+      level = 2;
+      env += 7;
+    }
+  else if (strncasecmp (env, "clusters", 8) == 0)
+    {
+      level = 2;
+      env += 8;
+    }
+
+  if (level)
+    {
+      while (isspace ((unsigned char) *env))
+	++env;
+      if (*env == '(')
+	{
+	  count = strtoul (++env, &end, 10);
+	  if (env == end || count == 0)
+	    goto invalid;
+	  env = end;
+	  while (isspace ((unsigned char) *env))
+	    ++env;
+	  if (*env++ != ')')
+	    goto invalid;
+	  while (isspace ((unsigned char) *env))
+	    ++env;
+	}
+      if (*env != '\0')
+	goto invalid;
+      return gomp_affinity_init_level (level, count);
+    }
+
+  do
+    {
+      while (isspace ((unsigned char) *env))
+	++env;
+      if (*env++ != '{')
+	goto invalid;
+      if (!gomp_affinity_new_place ())
+	goto fail;
+
+      do
+	{
+	  while (isspace ((unsigned char) *env))
+	    ++env;
+	  first = strtoul (env, &end, 10);
+	  if (env == end)
+	    goto invalid;
+	  env = end;
+	  len = 1;
+	  stride = 1;
+	  if (*env == ':')
+	    {
+	      len = strtoul (++env, &end, 10);
+	      if (env == end || len == 0)
+		goto invalid;
+	      env = end;
+	      if (*env == ':')
+		{
+		  stride = strtol (++env, &end, 10);
+		  if (env == end)
+		    goto invalid;
+		  env = end;
+		}
+	    }
+	  if (!gomp_affinity_add_cpus (first, len, stride))
+	    goto invalid;
+	  while (isspace ((unsigned char) *env))
+	    ++env;
+	  if (*env != ',')
+	    break;
+	  ++env;
+	}
+      while (1);
+
+      if (*env++ != '}')
+	goto invalid;
+      while (isspace ((unsigned char) *env))
+	++env;
+      if (*env == '\0')
+	break;
+      if (*env++ != ',')
+	goto invalid;
+    }
+  while (1);
+  return true;
+
+ invalid:
+  gomp_error ("Invalid value for environment variable OMP_PLACES");
+ fail:
+  gomp_places_list_len = 0;
+  return false;
+}
+
 /* Parse the GOMP_CPU_AFFINITY environment varible.  Return true if one was
    present and it was successfully parsed.  */
 
@@ -491,8 +667,11 @@ void initialize_env (void)
   gomp_available_cpus = gomp_global_icv.nthreads_var;
   if (!parse_unsigned_long ("OMP_NUM_THREADS", &gomp_global_icv.nthreads_var))
     gomp_global_icv.nthreads_var = gomp_available_cpus;
-  if (parse_affinity ())
-    gomp_init_affinity ();
+  parse_proc_bind ();
+  parse_places ();
+  parse_affinity ();
+  parse_boolean ("OMP_DISPLAY_AFFINITY", &gomp_display_affinity_var);
+  gomp_init_affinity ();
   wait_policy = parse_wait_policy ();
   if (!parse_spincount ("GOMP_SPINCOUNT", &gomp_spin_count_var))
     {
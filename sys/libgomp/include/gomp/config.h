@@ -59,6 +59,10 @@
 /* Define to 1 if the target supports __sync_*_compare_and_swap */
 #undef HAVE_SYNC_BUILTINS
 
+/* Define to 1 if the CAS and fetch-and-add of <cpu-syscall.h> may be used
+   when HAVE_SYNC_BUILTINS is not available. */
+#define HAVE_CPU_ATOMICS 1
+
 /* Define to 1 if you have the <sys/loadavg.h> header file. */
 #undef HAVE_SYS_LOADAVG_H
 
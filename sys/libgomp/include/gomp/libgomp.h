@@ -43,6 +43,12 @@
 
 #define HAVE_DEBUG 0
 
+/* Loop and sections iterations are handed out lock-free when the
+   target provides atomics, either as builtins or in <cpu-syscall.h>.  */
+#if defined HAVE_SYNC_BUILTINS || defined HAVE_CPU_ATOMICS
+# define HAVE_ITER_ATOMICS 1
+#endif
+
 #ifdef HAVE_ATTRIBUTE_VISIBILITY
 # pragma GCC visibility push(hidden)
 #endif
@@ -64,6 +70,24 @@ enum gomp_schedule_type
   GFS_AUTO
 };
 
+/* Dynamic loops run by more threads than one cluster holds hand out
+   blocks of GOMP_ITER_CLUSTER_CHUNKS chunks to a per-cluster slot, from
+   which the threads of that cluster take single chunks.  The team sizes
+   the slots from the topology when it starts.  */
+
+#define GOMP_ITER_CLUSTER_CHUNKS 16
+
+struct gomp_iter_cluster
+{
+  /* ((block + 1) << 5) | next chunk of the block, 0 before the first
+     block, or one of the GOMP_ITER_SLOT_* markers.  */
+  volatile long slot;
+  char pad[64 - sizeof (long)];
+};
+
+#define GOMP_ITER_SLOT_BUSY  (-1L)
+#define GOMP_ITER_SLOT_DONE  (-2L)
+
 struct gomp_work_share
 {
   /* This member records the SCHEDULE clause to be used for this construct.
@@ -146,6 +170,15 @@ struct gomp_work_share
     void *copyprivate;
   };
 
+  /* Number of chunks and next block to hand out to a cluster, for
+     dynamic loops distributed per cluster (mode 2).  */
+  unsigned long nchunks;
+  long cluster_next;
+
+  /* Per-cluster slots, indexed by cid modulo nslots.  */
+  struct gomp_iter_cluster *cluster;
+  unsigned nslots;
+
   union {
     /* Link to gomp_work_share struct for next work sharing construct
        encountered after this one.  */
@@ -219,6 +252,27 @@ struct gomp_task_icv
   bool nest_var;
 };
 
+/* OMP_PROC_BIND policies.  GOMP_PROC_BIND_UNSET keeps the historical
+   one member per cpu numbering.  */
+
+enum gomp_proc_bind
+{
+  GOMP_PROC_BIND_UNSET,
+  GOMP_PROC_BIND_FALSE,
+  GOMP_PROC_BIND_TRUE,
+  GOMP_PROC_BIND_MASTER,
+  GOMP_PROC_BIND_CLOSE,
+  GOMP_PROC_BIND_SPREAD
+};
+
+/* An OMP_PLACES place: LEN cpu ids of gomp_places_cpus from FIRST.  */
+
+struct gomp_place
+{
+  unsigned short first;
+  unsigned short len;
+};
+
 extern struct gomp_task_icv gomp_global_icv;
 extern unsigned long gomp_thread_limit_var;
 extern unsigned long gomp_remaining_threads_count;
@@ -242,20 +296,40 @@ enum gomp_task_kind
 struct gomp_task
 {
   struct gomp_task *parent;
-  struct gomp_task *children;
-  struct gomp_task *next_child;
-  struct gomp_task *prev_child;
-  struct gomp_task *next_queue;
-  struct gomp_task *prev_queue;
+  /* One reference held by the task itself until it completes, plus one
+     for every child task that has not completed yet.  A deferred task
+     is freed when this drops to zero, which keeps PARENT valid for as
+     long as any child may still look at it.  */
+  volatile long refs;
   struct gomp_task_icv icv;
   void (*fn) (void *);
   void *fn_data;
   enum gomp_task_kind kind;
-  bool in_taskwait;
+  /* Set while the task sleeps in taskwait; cleared with a CAS by
+     whichever of the waiter and the last child gets there first.  */
+  volatile long in_taskwait;
   bool in_tied_task;
   gomp_sem_t taskwait_sem;
 };
 
+/* Number of slots of a per-thread task deque; a power of two.  A thread
+   whose deque is full runs the new task immediately.  */
+
+#define GOMP_TASK_DEQUE_SIZE 256
+
+/* Work-stealing deque of deferred tasks owned by one team member.  The
+   owner pushes and pops at BOTTOM, other members steal at TOP.  */
+
+struct gomp_task_deque
+{
+  volatile long top;
+  volatile long bottom;
+  /* Cluster the owner last pushed from, so thieves can prefer
+     victims sharing their memory bank.  */
+  unsigned cid;
+  struct gomp_task *volatile tasks[GOMP_TASK_DEQUE_SIZE];
+};
+
 /* This structure describes a "team" of threads.  These are the threads
    that are spawned by a PARALLEL constructs, as well as the work sharing
    constructs that the team encounters.  */
@@ -269,6 +343,11 @@ struct gomp_team
      as a block last time.  */
   unsigned work_share_chunk;
 
+  /* Cpus per cluster and online clusters, sizing the slots of dynamic
+     loops distributed per cluster.  */
+  unsigned cluster_cpus;
+  unsigned cluster_slots;
+
   /* This is the saved team state that applied to a master thread before
      the current thread was created.  */
   struct gomp_team_state prev_ts;
@@ -311,10 +390,14 @@ struct gomp_team
      structs in the common case.  */
   struct gomp_work_share work_shares[8];
 
+  /* Protects the task related bits of the barrier generation.  */
   gomp_mutex_t task_lock;
-  struct gomp_task *task_queue;
-  int task_count;
-  int task_running_count;
+
+  /* One deque per team member, indexed by team_id.  */
+  struct gomp_task_deque *task_deques;
+
+  /* Number of deferred tasks queued or running, updated atomically.  */
+  volatile long task_count;
 
   /* This array contains structures for implicit tasks.  */
   struct gomp_task implicit_task[];
@@ -341,6 +424,9 @@ struct gomp_thread
 
   /* user pthread thread pool */
   struct gomp_thread_pool *thread_pool;
+
+  /* State of the random victim selection when stealing tasks.  */
+  unsigned task_seed;
 };
 
 
@@ -396,13 +482,22 @@ extern pthread_attr_t gomp_thread_attr;
 
 extern unsigned short *gomp_cpu_affinity;
 extern size_t gomp_cpu_affinity_len;
+extern enum gomp_proc_bind gomp_proc_bind_var;
+extern struct gomp_place *gomp_places_list;
+extern size_t gomp_places_list_len;
+extern unsigned short *gomp_places_cpus;
 
 /* Function prototypes.  */
 
 /* affinity.c */
 
 extern void gomp_init_affinity (void);
-extern void gomp_init_thread_affinity (pthread_attr_t *);
+extern int gomp_affinity_new_place (void);
+extern int gomp_affinity_add_cpus (unsigned long, unsigned long, long);
+extern int gomp_affinity_init_level (int, unsigned long);
+extern int gomp_affinity_cpu (unsigned, unsigned, int, int);
+extern void gomp_affinity_topology (unsigned *, unsigned *);
+extern void gomp_display_affinity (struct gomp_thread *);
 
 /* alloc.c */
 
@@ -427,9 +522,9 @@ extern int gomp_iter_static_next (long *, long *);
 extern int gomp_iter_dynamic_next_locked (long *, long *);
 extern int gomp_iter_guided_next_locked (long *, long *);
 
-#ifdef HAVE_SYNC_BUILTINS
-extern bool gomp_iter_dynamic_next (long *, long *);
-extern bool gomp_iter_guided_next (long *, long *);
+#ifdef HAVE_ITER_ATOMICS
+extern int gomp_iter_dynamic_next (long *, long *);
+extern int gomp_iter_guided_next (long *, long *);
 #endif
 
 /* iter_ull.c */
@@ -508,6 +603,10 @@ gomp_work_share_init_done (void)
 /* Now that we're back to default visibility, include the globals.  */
 #include <gomp/libgomp_g.h>
 
+/* Declared past <stdbool.h>, pulled by libgomp_g.h, so that it is the
+   same bool as the one parse_boolean stores through.  */
+extern bool gomp_display_affinity_var;
+
 /* Include omp.h by parts.  */
 #include <omp-lock.h>
 #define _LIBGOMP_OMP_LOCK_DEFINED 1
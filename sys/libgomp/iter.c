@@ -27,6 +27,10 @@
 
 #include <gomp/libgomp.h>
 #include <stdlib.h>
+#include <unistd.h>
+#ifndef HAVE_SYNC_BUILTINS
+#include <cpu-syscall.h>
+#endif
 
 /* This function implements the STATIC scheduling method.  The caller should
    iterate *pstart <= x < *pend.  Return zero if there are more iterations
@@ -171,11 +175,128 @@ int gomp_iter_dynamic_next_locked (long *pstart, long *pend)
 }
 
 
+#ifdef HAVE_ITER_ATOMICS
+static inline long
+gomp_iter_fetch_add (long *ptr, long val)
+{
+#ifdef HAVE_SYNC_BUILTINS
+  return __sync_fetch_and_add (ptr, val);
+#else
+  return cpu_atomic_add (ptr, val);
+#endif
+}
+
+/* Store NEWVAL in *PTR if it holds OLDVAL; return the value found.  The
+   ll/sc based cpu_atomic_cas may also fail spuriously when the word did
+   not change, so only report failure once another value has been seen.  */
+
+static inline long
+gomp_iter_cas (long *ptr, long oldval, long newval)
+{
+#ifdef HAVE_SYNC_BUILTINS
+  return __sync_val_compare_and_swap (ptr, oldval, newval);
+#else
+  long cur;
+
+  while (!cpu_atomic_cas (ptr, oldval, newval))
+    if ((cur = *(volatile long *) ptr) != oldval)
+      return cur;
+  return oldval;
+#endif
+}
+
+/* Take the next chunk out of a cluster slot.  When the slot has no
+   usable block left and REFILL is set, claim the slot, grab the next
+   block from ws->cluster_next and install it; threads of other clusters
+   only ever take what is left in the slot.  Returns the chunk number,
+   -1 when the slot has nothing more to give or -2 while another thread
+   refills it.  */
+
+static long
+gomp_iter_cluster_take (struct gomp_work_share *ws,
+			struct gomp_iter_cluster *cl, bool refill)
+{
+  unsigned long block, chunk;
+  long slot;
+
+  while (1)
+    {
+      slot = cl->slot;
+      if (slot == GOMP_ITER_SLOT_BUSY)
+	return -2;
+      if (slot > 0)
+	{
+	  block = (slot >> 5) - 1;
+	  chunk = block * GOMP_ITER_CLUSTER_CHUNKS + (slot & 31);
+	  if ((slot & 31) < GOMP_ITER_CLUSTER_CHUNKS && chunk < ws->nchunks)
+	    {
+	      if (gomp_iter_cas ((long *) &cl->slot, slot, slot + 1) == slot)
+		return chunk;
+	      continue;
+	    }
+	}
+      if (!refill || slot == GOMP_ITER_SLOT_DONE)
+	return -1;
+      if (gomp_iter_cas ((long *) &cl->slot, slot,
+			 GOMP_ITER_SLOT_BUSY) != slot)
+	continue;
+
+      block = gomp_iter_fetch_add (&ws->cluster_next, 1);
+      chunk = block * GOMP_ITER_CLUSTER_CHUNKS;
+      if (chunk >= ws->nchunks)
+	{
+	  cl->slot = GOMP_ITER_SLOT_DONE;
+	  return -1;
+	}
 #ifdef HAVE_SYNC_BUILTINS
+      __sync_synchronize ();
+#else
+      cpu_wbflush ();
+#endif
+      cl->slot = ((block + 1) << 5) | 1;
+      return chunk;
+    }
+}
+
+/* The mode 2 flavour of gomp_iter_dynamic_next: chunks come from our
+   cluster's slot first, then from whatever other clusters have left.
+   While our slot is being refilled, we take from the others and only
+   yield the cpu when they have nothing either.  */
+
+static bool
+gomp_iter_cluster_next (struct gomp_work_share *ws, long *pstart, long *pend)
+{
+  unsigned slot, i;
+  long chunk, own;
+
+  slot = getcid () % ws->nslots;
+  while (1)
+    {
+      own = chunk = gomp_iter_cluster_take (ws, &ws->cluster[slot], true);
+      for (i = 1; chunk < 0 && i < ws->nslots; i++)
+	chunk = gomp_iter_cluster_take (ws, &ws->cluster[(slot + i)
+							 % ws->nslots],
+					false);
+      if (chunk >= 0 || own != -2)
+	break;
+      pthread_yield ();
+    }
+  if (chunk < 0)
+    return false;
+
+  *pstart = ws->next + chunk * ws->chunk_size;
+  if ((unsigned long) chunk == ws->nchunks - 1)
+    *pend = ws->end;
+  else
+    *pend = *pstart + ws->chunk_size;
+  return true;
+}
+
 /* Similar, but doesn't require the lock held, and uses compare-and-swap
-   instead.  Note that the only memory value that changes is ws->next.  */
+   instead.  Note that the only memory value that changes is ws->next,
+   or the cluster slots in mode 2.  */
 
-bool
+int
 gomp_iter_dynamic_next (long *pstart, long *pend)
 {
   struct gomp_thread *thr = gomp_thread ();
@@ -186,9 +307,12 @@ gomp_iter_dynamic_next (long *pstart, long *pend)
   incr = ws->incr;
   chunk = ws->chunk_size;
 
+  if (__builtin_expect (ws->mode == 2, 0))
+    return gomp_iter_cluster_next (ws, pstart, pend);
+
   if (__builtin_expect (ws->mode, 1))
     {
-      long tmp = __sync_fetch_and_add (&ws->next, chunk);
+      long tmp = gomp_iter_fetch_add (&ws->next, chunk);
       if (incr > 0)
 	{
 	  if (tmp >= end)
@@ -234,7 +358,7 @@ gomp_iter_dynamic_next (long *pstart, long *pend)
 	}
       nend = start + chunk;
 
-      tmp = __sync_val_compare_and_swap (&ws->next, start, nend);
+      tmp = gomp_iter_cas (&ws->next, start, nend);
       if (__builtin_expect (tmp == start, 1))
 	break;
 
@@ -245,7 +369,7 @@ gomp_iter_dynamic_next (long *pstart, long *pend)
   *pend = nend;
   return true;
 }
-#endif /* HAVE_SYNC_BUILTINS */
+#endif /* HAVE_ITER_ATOMICS */
 
 
 /* This function implements the GUIDED scheduling method.  Arguments are
@@ -282,11 +406,11 @@ gomp_iter_guided_next_locked (long *pstart, long *pend)
   return true;
 }
 
-#ifdef HAVE_SYNC_BUILTINS
+#ifdef HAVE_ITER_ATOMICS
 /* Similar, but doesn't require the lock held, and uses compare-and-swap
    instead.  Note that the only memory value that changes is ws->next.  */
 
-bool
+int
 gomp_iter_guided_next (long *pstart, long *pend)
 {
   struct gomp_thread *thr = gomp_thread ();
@@ -319,7 +443,7 @@ gomp_iter_guided_next (long *pstart, long *pend)
       else
 	nend = end;
 
-      tmp = __sync_val_compare_and_swap (&ws->next, start, nend);
+      tmp = gomp_iter_cas (&ws->next, start, nend);
       if (__builtin_expect (tmp == start, 1))
 	break;
 
@@ -330,4 +454,4 @@ gomp_iter_guided_next (long *pstart, long *pend)
   *pend = nend;
   return true;
 }
-#endif /* HAVE_SYNC_BUILTINS */
+#endif /* HAVE_ITER_ATOMICS */
@@ -46,7 +46,7 @@ gomp_loop_init (struct gomp_work_share *ws, long start, long end, long incr,
     {
       ws->chunk_size *= incr;
 
-#ifdef HAVE_SYNC_BUILTINS
+#ifdef HAVE_ITER_ATOMICS
       {
 	/* For dynamic scheduling prepare things to make each iteration
 	   faster.  */
@@ -57,7 +57,7 @@ gomp_loop_init (struct gomp_work_share *ws, long start, long end, long incr,
 	if (__builtin_expect (incr > 0, 1))
 	  {
 	    /* Cheap overflow protection.  */
-	    if (__builtin_expect ((nthreads | ws->chunk_size)
+	    if (__builtin_expect ((unsigned long) (nthreads | ws->chunk_size)
 				  >= 1UL << (sizeof (long)
 					     * __CHAR_BIT__ / 2 - 1), 0))
 	      ws->mode = 0;
@@ -66,12 +66,39 @@ gomp_loop_init (struct gomp_work_share *ws, long start, long end, long incr,
 				    - (nthreads + 1) * ws->chunk_size);
 	  }
 	/* Cheap overflow protection.  */
-	else if (__builtin_expect ((nthreads | -ws->chunk_size)
+	else if (__builtin_expect ((unsigned long) (nthreads | -ws->chunk_size)
 				   >= 1UL << (sizeof (long)
 					      * __CHAR_BIT__ / 2 - 1), 0))
 	  ws->mode = 0;
 	else
 	  ws->mode = ws->end > (nthreads + 1) * -ws->chunk_size - LONG_MAX;
+
+	/* When the team spans several clusters, let each cluster carve
+	   its chunks out of blocks of its own instead of hammering
+	   ws->next from every cpu.  */
+	if (ws->mode && team && team->cluster_slots > 1
+	    && nthreads > team->cluster_cpus)
+	  {
+	    unsigned long n, i;
+	    long s;
+
+	    s = incr + (incr > 0 ? -1 : 1);
+	    n = (ws->end - ws->next + s) / incr;
+	    s = ws->chunk_size / incr;
+	    ws->nchunks = (n + s - 1) / s;
+	    if (ws->nchunks > (unsigned long) nthreads * GOMP_ITER_CLUSTER_CHUNKS
+		&& ws->nchunks / GOMP_ITER_CLUSTER_CHUNKS
+		   < 1UL << (sizeof (long) * __CHAR_BIT__ - 7))
+	      {
+		ws->mode = 2;
+		ws->cluster_next = 0;
+		ws->nslots = team->cluster_slots;
+		ws->cluster = gomp_malloc (ws->nslots
+					   * sizeof (struct gomp_iter_cluster));
+		for (i = 0; i < ws->nslots; i++)
+		  ws->cluster[i].slot = 0;
+	      }
+	  }
       }
 #endif
     }
@@ -124,7 +151,7 @@ gomp_loop_dynamic_start (long start, long end, long incr, long chunk_size,
       gomp_work_share_init_done ();
     }
 
-#ifdef HAVE_SYNC_BUILTINS
+#ifdef HAVE_ITER_ATOMICS
   ret = gomp_iter_dynamic_next (istart, iend);
 #else
   gomp_mutex_lock (&thr->ts.work_share->lock);
@@ -149,7 +176,7 @@ gomp_loop_guided_start (long start, long end, long incr, long chunk_size,
       gomp_work_share_init_done ();
     }
 
-#ifdef HAVE_SYNC_BUILTINS
+#ifdef HAVE_ITER_ATOMICS
   ret = gomp_iter_guided_next (istart, iend);
 #else
   gomp_mutex_lock (&thr->ts.work_share->lock);
@@ -306,7 +333,7 @@ gomp_loop_dynamic_next (long *istart, long *iend)
 {
   bool ret;
 
-#ifdef HAVE_SYNC_BUILTINS
+#ifdef HAVE_ITER_ATOMICS
   ret = gomp_iter_dynamic_next (istart, iend);
 #else
   struct gomp_thread *thr = gomp_thread ();
@@ -323,7 +350,7 @@ gomp_loop_guided_next (long *istart, long *iend)
 {
   bool ret;
 
-#ifdef HAVE_SYNC_BUILTINS
+#ifdef HAVE_ITER_ATOMICS
   ret = gomp_iter_guided_next (istart, iend);
 #else
   struct gomp_thread *thr = gomp_thread ();
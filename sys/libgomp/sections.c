@@ -37,6 +37,18 @@ gomp_sections_init (struct gomp_work_share *ws, unsigned count)
   ws->end = count + 1;
   ws->incr = 1;
   ws->next = 1;
+#ifdef HAVE_ITER_ATOMICS
+  {
+    struct gomp_thread *thr = gomp_thread ();
+    struct gomp_team *team = thr->ts.team;
+    long nthreads = team ? team->nthreads : 1;
+
+    ws->mode = ((unsigned long) (nthreads | ws->end)
+		< 1UL << (sizeof (long) * __CHAR_BIT__ / 2 - 1));
+  }
+#else
+  ws->mode = 0;
+#endif
 }
 
 /* This routine is called when first encountering a sections construct
@@ -61,7 +73,7 @@ GOMP_sections_start (unsigned count)
       gomp_work_share_init_done ();
     }
 
-#ifdef HAVE_SYNC_BUILTINS
+#ifdef HAVE_ITER_ATOMICS
   if (gomp_iter_dynamic_next (&s, &e))
     ret = s;
   else
@@ -92,7 +104,7 @@ GOMP_sections_next (void)
 {
   long s, e, ret;
 
-#ifdef HAVE_SYNC_BUILTINS
+#ifdef HAVE_ITER_ATOMICS
   if (gomp_iter_dynamic_next (&s, &e))
     ret = s;
   else
@@ -28,6 +28,8 @@
 #include <gomp/libgomp.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+#include <cpu-syscall.h>
 
 
 /* Create a new task data structure.  */
@@ -37,11 +39,11 @@ gomp_init_task (struct gomp_task *task, struct gomp_task *parent_task,
 		struct gomp_task_icv *prev_icv)
 {
   task->parent = parent_task;
+  task->refs = 1;
   task->icv = *prev_icv;
   task->kind = GOMP_TASK_IMPLICIT;
-  task->in_taskwait = false;
+  task->in_taskwait = 0;
   task->in_tied_task = false;
-  task->children = NULL;
   gomp_sem_init (&task->taskwait_sem, 0);
 }
 
@@ -57,18 +59,236 @@ gomp_end_task (void)
   thr->task = task->parent;
 }
 
-static inline void
-gomp_clear_parent (struct gomp_task *children)
+/* Store NEWVAL in *PTR if it holds OLDVAL; return the value found.  As
+   in gomp_iter_cas, the ll/sc based cpu_atomic_cas may fail spuriously
+   when the word did not change, so only report failure once another
+   value has been seen.  */
+
+static inline long
+gomp_task_cas (volatile long *ptr, long oldval, long newval)
+{
+#ifdef HAVE_SYNC_BUILTINS
+  return __sync_val_compare_and_swap (ptr, oldval, newval);
+#else
+  long cur;
+
+  while (!cpu_atomic_cas ((void *) ptr, oldval, newval))
+    if ((cur = *ptr) != oldval)
+      return cur;
+  return oldval;
+#endif
+}
+
+/* Deferred tasks live in one deque per team member.  The owner pushes
+   and pops at the bottom, so it keeps running the tasks it created last
+   while their data is still in its cache; idle members steal the oldest
+   task from the top.  Owner and thieves only race for the last task,
+   and that race is settled by a CAS on TOP (Chase-Lev).  */
+
+static inline bool
+gomp_task_deque_push (struct gomp_task_deque *dq, struct gomp_task *task)
+{
+  long b = dq->bottom;
+
+  if (b - dq->top >= GOMP_TASK_DEQUE_SIZE)
+    return false;
+  dq->tasks[b & (GOMP_TASK_DEQUE_SIZE - 1)] = task;
+  cpu_wbflush ();
+  dq->bottom = b + 1;
+  return true;
+}
+
+static inline struct gomp_task *
+gomp_task_deque_pop (struct gomp_task_deque *dq)
+{
+  struct gomp_task *task;
+  long b = dq->bottom - 1;
+  long t;
+
+  dq->bottom = b;
+  cpu_wbflush ();
+  t = dq->top;
+  if (t > b)
+    {
+      dq->bottom = t;
+      return NULL;
+    }
+  task = dq->tasks[b & (GOMP_TASK_DEQUE_SIZE - 1)];
+  if (t == b)
+    {
+      if (gomp_task_cas (&dq->top, t, t + 1) != t)
+	task = NULL;
+      dq->bottom = t + 1;
+    }
+  return task;
+}
+
+static inline struct gomp_task *
+gomp_task_deque_steal (struct gomp_task_deque *dq)
 {
-  struct gomp_task *task = children;
+  struct gomp_task *task;
+  long t = dq->top;
+
+  cpu_wbflush ();
+  if (t >= dq->bottom)
+    return NULL;
+  task = dq->tasks[t & (GOMP_TASK_DEQUE_SIZE - 1)];
+  if (gomp_task_cas (&dq->top, t, t + 1) != t)
+    return NULL;
+  return task;
+}
+
+/* Steal a task from another team member.  Victims are visited from a
+   random starting point, those running on our own cluster first.  */
+
+static struct gomp_task *
+gomp_task_steal (struct gomp_thread *thr, struct gomp_team *team)
+{
+  unsigned nthreads = team->nthreads;
+  unsigned cid, start, victim, i;
+  struct gomp_task *task;
+  int pass;
+
+  if (nthreads == 1)
+    return NULL;
+
+  cid = getcid ();
+  thr->task_seed = thr->task_seed * 1103515245 + 12345;
+  start = (thr->task_seed >> 16) % nthreads;
 
-  if (task)
-    do
+  for (pass = 0; pass < 2; pass++)
+    for (i = 0; i < nthreads; i++)
       {
-	task->parent = NULL;
-	task = task->next_child;
+	struct gomp_task_deque *dq;
+
+	victim = (start + i) % nthreads;
+	dq = &team->task_deques[victim];
+	if (victim == thr->ts.team_id
+	    || (dq->cid == cid) != (pass == 0)
+	    || dq->top >= dq->bottom)
+	  continue;
+	task = gomp_task_deque_steal (dq);
+	if (task != NULL)
+	  return task;
       }
-    while (task != children);
+  return NULL;
+}
+
+/* Find the next task to run: our own newest task, else a stolen one.  */
+
+static inline struct gomp_task *
+gomp_task_next (struct gomp_thread *thr, struct gomp_team *team)
+{
+  struct gomp_task *task;
+
+  task = gomp_task_deque_pop (&team->task_deques[thr->ts.team_id]);
+  if (task == NULL)
+    task = gomp_task_steal (thr, team);
+  return task;
+}
+
+/* Drop one reference to TASK.  The last reference frees a deferred
+   task; the one that leaves only the task's own reference wakes it up
+   if it is sleeping in taskwait.  */
+
+static inline void
+gomp_task_release (struct gomp_task *task)
+{
+  long refs = cpu_atomic_add ((void *) &task->refs, -1) - 1;
+
+  if (refs == 0)
+    {
+      if (task->kind == GOMP_TASK_TIED)
+	{
+	  gomp_finish_task (task);
+	  free (task);
+	}
+    }
+  else if (refs == 1 && task->in_taskwait
+	   && gomp_task_cas (&task->in_taskwait, 1, 0) == 1)
+    gomp_sem_post (&task->taskwait_sem);
+}
+
+/* Run the deferred task CHILD_TASK on the current thread and retire it.
+   When it was the last task of the team and the last thread of the
+   barrier is waiting for tasks, complete the barrier.  */
+
+static void
+gomp_task_run (struct gomp_thread *thr, struct gomp_team *team,
+	       struct gomp_task *child_task)
+{
+  struct gomp_task *task = thr->task;
+  struct gomp_task *parent = child_task->parent;
+
+  child_task->kind = GOMP_TASK_TIED;
+  thr->task = child_task;
+  child_task->fn (child_task->fn_data);
+  thr->task = task;
+
+  gomp_task_release (parent);
+  gomp_task_release (child_task);
+
+  if (cpu_atomic_add ((void *) &team->task_count, -1) == 1)
+    {
+      gomp_mutex_lock (&team->task_lock);
+      if (gomp_team_barrier_waiting_for_tasks (&team->barrier))
+	{
+	  gomp_team_barrier_done (&team->barrier, team->barrier.generation);
+	  gomp_mutex_unlock (&team->task_lock);
+	  gomp_team_barrier_wake (&team->barrier, 0);
+	  return;
+	}
+      gomp_mutex_unlock (&team->task_lock);
+    }
+}
+
+static inline bool
+gomp_task_descendant_p (struct gomp_task *child_task, struct gomp_task *task)
+{
+  struct gomp_task *parent;
+
+  for (parent = child_task->parent; parent != NULL; parent = parent->parent)
+    if (parent == task)
+      return true;
+  return false;
+}
+
+/* Wait until all children of TASK have completed.  Descendants still
+   sitting in our own deque are run inline; once the remaining children
+   are all running on other threads, sleep until the last one is done.  */
+
+static void
+gomp_task_wait (struct gomp_thread *thr, struct gomp_team *team,
+		struct gomp_task *task)
+{
+  struct gomp_task_deque *dq = &team->task_deques[thr->ts.team_id];
+  struct gomp_task *child_task;
+
+  while (task->refs != 1)
+    {
+      child_task = gomp_task_deque_pop (dq);
+      if (child_task != NULL)
+	{
+	  if (gomp_task_descendant_p (child_task, task))
+	    {
+	      gomp_task_run (thr, team, child_task);
+	      continue;
+	    }
+	  /* Not ours to run here; leave it to a thief or the barrier.
+	     Should the deque be full, running it beats losing it.  */
+	  if (!gomp_task_deque_push (dq, child_task))
+	    {
+	      gomp_task_run (thr, team, child_task);
+	      continue;
+	    }
+	}
+
+      task->in_taskwait = 1;
+      cpu_wbflush ();
+      if (task->refs != 1 || gomp_task_cas (&task->in_taskwait, 1, 0) != 1)
+	gomp_sem_wait (&task->taskwait_sem);
+      return;
+    }
 }
 
 /* Called when encountering an explicit task directive.  If IF_CLAUSE is
@@ -95,7 +315,7 @@ GOMP_task (void (*fn) (void *), void *data, void (*cpyfn) (void *, void *),
 #endif
 
   if (!if_clause || team == NULL
-      || (unsigned int)team->task_count > 64 * (unsigned int)team->nthreads)
+      || (unsigned long)team->task_count > 64 * (unsigned long)team->nthreads)
     {
       struct gomp_task task;
 
@@ -114,20 +334,19 @@ GOMP_task (void (*fn) (void *), void *data, void (*cpyfn) (void *, void *),
 	}
       else
 	fn (data);
-      if (task.children)
-	{
-	  gomp_mutex_lock (&team->task_lock);
-	  gomp_clear_parent (task.children);
-	  gomp_mutex_unlock (&team->task_lock);
-	}
+      /* TASK lives on our stack; its children must not outlive it.  */
+      if (task.refs != 1)
+	gomp_task_wait (thr, team, &task);
       gomp_end_task ();
     }
   else
     {
       struct gomp_task *task;
       struct gomp_task *parent = thr->task;
+      struct gomp_task_deque *dq = &team->task_deques[thr->ts.team_id];
+      unsigned cid;
       char *arg;
-      bool do_wake;
+      long queued;
 
       task = gomp_malloc (sizeof (*task) + arg_size + arg_align - 1);
       arg = (char *) (((uintptr_t) (task + 1) + arg_align - 1)
@@ -145,39 +364,30 @@ GOMP_task (void (*fn) (void *), void *data, void (*cpyfn) (void *, void *),
       task->fn = fn;
       task->fn_data = arg;
       task->in_tied_task = true;
-      gomp_mutex_lock (&team->task_lock);
-      if (parent->children)
-	{
-	  task->next_child = parent->children;
-	  task->prev_child = parent->children->prev_child;
-	  task->next_child->prev_child = task;
-	  task->prev_child->next_child = task;
-	}
-      else
-	{
-	  task->next_child = task;
-	  task->prev_child = task;
-	}
-      parent->children = task;
-      if (team->task_queue)
+
+      cpu_atomic_add ((void *) &parent->refs, 1);
+      cpu_atomic_add ((void *) &team->task_count, 1);
+
+      cid = getcid ();
+      if (dq->cid != cid)
+	dq->cid = cid;
+      if (!gomp_task_deque_push (dq, task))
 	{
-	  task->next_queue = team->task_queue;
-	  task->prev_queue = team->task_queue->prev_queue;
-	  task->next_queue->prev_queue = task;
-	  task->prev_queue->next_queue = task;
+	  gomp_task_run (thr, team, task);
+	  return;
 	}
-      else
+
+      if (!(team->barrier.generation & 1))
 	{
-	  task->next_queue = task;
-	  task->prev_queue = task;
-	  team->task_queue = task;
+	  gomp_mutex_lock (&team->task_lock);
+	  gomp_team_barrier_set_task_pending (&team->barrier);
+	  gomp_mutex_unlock (&team->task_lock);
 	}
-      ++team->task_count;
-      gomp_team_barrier_set_task_pending (&team->barrier);
-      do_wake = team->task_running_count + !parent->in_tied_task
-	< (int)team->nthreads;
-      gomp_mutex_unlock (&team->task_lock);
-      if (do_wake)
+
+      /* Members already waiting in the barrier can help; wake one for
+	 each of the first few queued tasks.  */
+      queued = dq->bottom - dq->top;
+      if (team->barrier.arrived != 0 && queued <= (long) team->nthreads)
 	gomp_team_barrier_wake (&team->barrier, 1);
     }
 }
@@ -187,13 +397,11 @@ gomp_barrier_handle_tasks (gomp_barrier_state_t state)
 {
   struct gomp_thread *thr = gomp_thread ();
   struct gomp_team *team = thr->ts.team;
-  struct gomp_task *task = thr->task;
-  struct gomp_task *child_task = NULL;
-  struct gomp_task *to_free = NULL;
+  struct gomp_task *child_task;
 
-  gomp_mutex_lock (&team->task_lock);
   if (gomp_barrier_last_thread (state))
     {
+      gomp_mutex_lock (&team->task_lock);
       if (team->task_count == 0)
 	{
 	  gomp_team_barrier_done (&team->barrier, state);
@@ -202,77 +410,11 @@ gomp_barrier_handle_tasks (gomp_barrier_state_t state)
 	  return;
 	}
       gomp_team_barrier_set_waiting_for_tasks (&team->barrier);
-    }
-
-  while (1)
-    {
-      if (team->task_queue != NULL)
-	{
-	  struct gomp_task *parent;
-
-	  child_task = team->task_queue;
-	  parent = child_task->parent;
-	  if (parent && parent->children == child_task)
-	    parent->children = child_task->next_child;
-	  child_task->prev_queue->next_queue = child_task->next_queue;
-	  child_task->next_queue->prev_queue = child_task->prev_queue;
-	  if (child_task->next_queue != child_task)
-	    team->task_queue = child_task->next_queue;
-	  else
-	    team->task_queue = NULL;
-	  child_task->kind = GOMP_TASK_TIED;
-	  team->task_running_count++;
-	  if (team->task_count == team->task_running_count)
-	    gomp_team_barrier_clear_task_pending (&team->barrier);
-	}
       gomp_mutex_unlock (&team->task_lock);
-      if (to_free)
-	{
-	  gomp_finish_task (to_free);
-	  free (to_free);
-	  to_free = NULL;
-	}
-      if (child_task)
-	{
-	  thr->task = child_task;
-	  child_task->fn (child_task->fn_data);
-	  thr->task = task;
-	}
-      else
-	return;
-      gomp_mutex_lock (&team->task_lock);
-      if (child_task)
-	{
-	  struct gomp_task *parent = child_task->parent;
-	  if (parent)
-	    {
-	      child_task->prev_child->next_child = child_task->next_child;
-	      child_task->next_child->prev_child = child_task->prev_child;
-	      if (parent->children == child_task)
-		{
-		  if (child_task->next_child != child_task)
-		    parent->children = child_task->next_child;
-		  else
-		    {
-		      parent->children = NULL;
-		      if (parent->in_taskwait)
-			gomp_sem_post (&parent->taskwait_sem);
-		    }
-		}
-	    }
-	  gomp_clear_parent (child_task->children);
-	  to_free = child_task;
-	  child_task = NULL;
-	  team->task_running_count--;
-	  if (--team->task_count == 0
-	      && gomp_team_barrier_waiting_for_tasks (&team->barrier))
-	    {
-	      gomp_team_barrier_done (&team->barrier, state);
-	      gomp_mutex_unlock (&team->task_lock);
-	      gomp_team_barrier_wake (&team->barrier, 0);
-	    }
-	}
     }
+
+  while ((child_task = gomp_task_next (thr, team)) != NULL)
+    gomp_task_run (thr, team, child_task);
 }
 
 /* Called when encountering a taskwait directive.  */
@@ -283,82 +425,8 @@ GOMP_taskwait (void)
   struct gomp_thread *thr = gomp_thread ();
   struct gomp_team *team = thr->ts.team;
   struct gomp_task *task = thr->task;
-  struct gomp_task *child_task = NULL;
-  struct gomp_task *to_free = NULL;
 
-  if (task == NULL || task->children == NULL)
+  if (task == NULL || task->refs == 1)
     return;
-  gomp_mutex_lock (&team->task_lock);
-  while (1)
-    {
-      if (task->children == NULL)
-	{
-	  gomp_mutex_unlock (&team->task_lock);
-	  if (to_free)
-	    {
-	      gomp_finish_task (to_free);
-	      free (to_free);
-	    }
-	  return;
-	}
-      if (task->children->kind == GOMP_TASK_WAITING)
-	{
-	  child_task = task->children;
-	  task->children = child_task->next_child;
-	  child_task->prev_queue->next_queue = child_task->next_queue;
-	  child_task->next_queue->prev_queue = child_task->prev_queue;
-	  if (team->task_queue == child_task)
-	    {
-	      if (child_task->next_queue != child_task)
-		team->task_queue = child_task->next_queue;
-	      else
-		team->task_queue = NULL;
-	    }
-	  child_task->kind = GOMP_TASK_TIED;
-	  team->task_running_count++;
-	  if (team->task_count == team->task_running_count)
-	    gomp_team_barrier_clear_task_pending (&team->barrier);
-	}
-      else
-	/* All tasks we are waiting for are already running
-	   in other threads.  Wait for them.  */
-	task->in_taskwait = true;
-      gomp_mutex_unlock (&team->task_lock);
-      if (to_free)
-	{
-	  gomp_finish_task (to_free);
-	  free (to_free);
-	  to_free = NULL;
-	}
-      if (child_task)
-	{
-	  thr->task = child_task;
-	  child_task->fn (child_task->fn_data);
-	  thr->task = task;
-	}
-      else
-	{
-	  gomp_sem_wait (&task->taskwait_sem);
-	  task->in_taskwait = false;
-	  return;
-	}
-      gomp_mutex_lock (&team->task_lock);
-      if (child_task)
-	{
-	  child_task->prev_child->next_child = child_task->next_child;
-	  child_task->next_child->prev_child = child_task->prev_child;
-	  if (task->children == child_task)
-	    {
-	      if (child_task->next_child != child_task)
-		task->children = child_task->next_child;
-	      else
-		task->children = NULL;
-	    }
-	  gomp_clear_parent (child_task->children);
-	  to_free = child_task;
-	  child_task = NULL;
-	  team->task_count--;
-	  team->task_running_count--;
-	}
-    }
+  gomp_task_wait (thr, team, task);
 }
@@ -88,6 +88,9 @@ gomp_thread_start (void *xdata)
 
   thr->ts.team->ordered_release[thr->ts.team_id] = &thr->release;
 
+  if (gomp_display_affinity_var)
+    gomp_display_affinity (thr);
+
   /* Make thread pool local. */
   pool = thr->thread_pool;
 
@@ -141,7 +144,8 @@ gomp_new_team (unsigned nthreads)
   int i;
 
   size = sizeof (*team) + nthreads * (sizeof (team->ordered_release[0])
-				      + sizeof (team->implicit_task[0]));
+				      + sizeof (team->implicit_task[0])
+				      + sizeof (team->task_deques[0]));
   team = gomp_malloc (size);
 
   team->work_share_chunk = 8;
@@ -159,6 +163,7 @@ gomp_new_team (unsigned nthreads)
   team->work_shares[i].next_free = NULL;
 
   team->nthreads = nthreads;
+  gomp_affinity_topology (&team->cluster_cpus, &team->cluster_slots);
   gomp_barrier_init (&team->barrier, nthreads);
 
   gomp_sem_init (&team->master_release, 0);
@@ -166,9 +171,14 @@ gomp_new_team (unsigned nthreads)
   team->ordered_release[0] = &team->master_release;
 
   gomp_mutex_init (&team->task_lock);
-  team->task_queue = NULL;
+  team->task_deques = (void *) &team->ordered_release[nthreads];
+  for (i = 0; i < (int) nthreads; i++)
+    {
+      team->task_deques[i].top = 0;
+      team->task_deques[i].bottom = 0;
+      team->task_deques[i].cid = 0;
+    }
   team->task_count = 0;
-  team->task_running_count = 0;
 
   return team;
 }
@@ -309,6 +319,9 @@ gomp_team_start (void (*fn) (void *), void *data, unsigned nthreads,
   if (nthreads == 1)
     return;
 
+  if (gomp_display_affinity_var)
+    gomp_display_affinity (thr);
+
   i = 1;
 
   /* We only allow the reuse of idle threads for non-nested PARALLEL
@@ -438,13 +451,8 @@ gomp_team_start (void (*fn) (void *), void *data, unsigned nthreads,
       start_data->thread_pool = pool;
       start_data->nested = nested;
 
-      if (gomp_cpu_affinity != NULL)
-	gomp_init_thread_affinity (attr);
-
-      if (i==(unsigned)n_master) 
-        pthread_attr_setcpuid_np(attr, 0, NULL);
-      else 
-        pthread_attr_setcpuid_np(attr, i, NULL);
+      pthread_attr_setcpuid_np (attr, gomp_affinity_cpu (nthreads, i, n_master,
+							 nested), NULL);
 
       err = pthread_create (&pt, attr, gomp_thread_start, start_data);
       if (err != 0)
@@ -115,6 +115,7 @@ gomp_init_work_share (struct gomp_work_share *ws, int ordered,
     ws->ordered_team_ids = NULL;
   gomp_ptrlock_init (&ws->next_ws, NULL);
   ws->threads_completed = 0;
+  ws->cluster = NULL;
 }
 
 /* Do any needed destruction of gomp_work_share fields before it
@@ -127,6 +128,7 @@ gomp_fini_work_share (struct gomp_work_share *ws)
   if (ws->ordered_team_ids != ws->inline_ordered_team_ids)
     free (ws->ordered_team_ids);
   gomp_ptrlock_destroy (&ws->next_ws);
+  free (ws->cluster);
 }
 
 /* Free a work share struct, if not orphaned, put it into current
@@ -30,16 +30,22 @@
 #include <stdbool.h>
 
 /* Standard data types for the function arguments and results */
+
+/* Emit context of a map thread, opaque to the application. */
+struct mr_emit_ctx;
+typedef struct mr_emit_ctx mr_emit_ctx_t;
  
 /* Argument to map function. This is specified by the splitter function.
  * length - number of elements of data. The default splitter function gives 
             length in terms of the # of elements of unit_size bytes.
  * data - data to process of a user defined type
+ * ctx - set by the runtime before calling map, for emit_intermediate_ctx()
  */
 typedef struct
 {
    intptr_t length;
    void *data;
+   mr_emit_ctx_t *ctx;
 } map_args_t;
 
 /* Single element of result
@@ -52,14 +58,28 @@ typedef struct
    void *val;
 } keyval_t;
 
+/* Sorted run of a partitioned result
+ * length - number of key value pairs
+ * data - array of key value pairs
+ */
+typedef struct
+{
+   int length;
+   keyval_t *data;
+} final_part_t;
+
 /* List of results
  * length - number of key value pairs
  * data - array of key value pairs
+ * num_parts, parts - with partitioned_output, data is NULL and the pairs
+ *     are in num_parts sorted runs with disjoint keys instead
  */
 typedef struct
 {
    int length;
    keyval_t *data;
+   int num_parts;
+   final_part_t *parts;
 } final_data_t;
 
 /* Scheduler function pointer type definitions */
@@ -114,6 +134,23 @@ typedef int (*partition_t)(int, void *, int);
  */
 typedef int (*key_cmp_t)(const void *, const void*);
 
+/* Container used to collect the intermediate key/value pairs of a map
+ * thread before they are handed to the reduce tasks.
+ *   MR_CONTAINER_SORTED keeps each reduce bucket sorted on every insert.
+ *   MR_CONTAINER_HASH inserts through an open-addressing hash table on the
+ *     key_size bytes of the key; buckets are sorted once, when the thread
+ *     is done mapping.
+ *   MR_CONTAINER_ARRAY is for dense integer keys: the key pointer itself
+ *     is an integer in [0, key_range) and indexes a fixed-size array.
+ *     Keys are assigned to reduce tasks by contiguous ranges and the
+ *     partition function is not called.
+ */
+typedef enum {
+    MR_CONTAINER_SORTED = 0,
+    MR_CONTAINER_HASH,
+    MR_CONTAINER_ARRAY
+} mr_container_t;
+
 /* The arguments to operate the runtime. */
 typedef struct
 {
@@ -163,6 +200,32 @@ typedef struct
     float key_match_factor;     /* Magic number that describes the ratio of 
     * the input data size to the output data size.
     * This is used as a hint. */
+
+    mr_container_t intermediate_container;
+                                /* Intermediate container, default is
+                                 * MR_CONTAINER_SORTED. */
+    int key_range;              /* # of distinct keys for
+                                 * MR_CONTAINER_ARRAY. */
+
+    char *input_file;           /* Streaming input: if set, the runtime
+                                 * maps this file, points task_data and
+                                 * data_size at the mapping and splits it
+                                 * one window at a time as map tasks run.
+                                 * The splitter must walk task_data as a
+                                 * flat buffer. The mapping is left for
+                                 * the caller to munmap. Windows are not
+                                 * released as their tasks finish, since
+                                 * emitted keys may point into them: the
+                                 * pages faulted in stay resident until
+                                 * the munmap. */
+    int input_window;           /* # of bytes split per window,
+                                 * default is 1MB. */
+
+    bool partitioned_output;    /* Skip the merge, the result is left in
+                                 * sorted runs, see final_data_t. */
+    int merge_fan_in;           /* Max # of runs merged at once, in
+                                 * rounds if there are more. Default is
+                                 * all of them in one pass. */
 } map_reduce_args_t;
 
 /* Runtime defined functions. */
@@ -189,6 +252,17 @@ int map_reduce (map_reduce_args_t * args);
  */
 void emit_intermediate(void *key, void *val, int key_size);
 
+/* Same as emit_intermediate(), without looking up the calling thread. CTX is
+ * the ctx field of the map_args_t the map function was called with.
+ */
+void emit_intermediate_ctx(mr_emit_ctx_t *ctx, void *key, void *val,
+                           int key_size);
+
+/* Emits NUM pairs at once, the key of PAIRS[i] being KEY_SIZES[i] bytes.
+ */
+void emit_intermediate_batch(mr_emit_ctx_t *ctx, keyval_t *pairs,
+                             const int *key_sizes, int num);
+
 /* This should be called from the reduce function. It stores a key and a value 
  * in the reduce queue. This will be in the final result array.
  */
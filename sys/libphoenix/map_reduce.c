@@ -55,7 +55,11 @@
 #include "struct.h"
 #include "tpool.h"
 
+/* Per task and per emit timing costs a clock() call on every emit.
+   Build with -DMR_TIMING to get it. */
+#ifndef MR_TIMING
 #undef TIMING
+#endif
 
 /* Begin tunables. */
 //#define INCREMENTAL_COMBINER
@@ -66,6 +70,10 @@
 //#define DEFAULT_CACHE_SIZE        (8 * 1024)
 #define DEFAULT_KEYVAL_ARR_LEN      10
 #define DEFAULT_VALS_ARR_LEN        10
+#define DEFAULT_KEYVALS_INDEX_LEN   32  /* Must be a power of two. */
+#define SORT_INSERTION_LEN          16
+#define DEFAULT_STREAM_WINDOW       (1024 * 1024)
+#define MERGE_SAMPLES_PER_THREAD    8
 #define L2_CACHE_LINE_SIZE          64
 /* End tunables. */
 
@@ -94,6 +102,13 @@ typedef struct
     };
 } keyval_arr_t;
 
+/* Slot of the open-addressing index of a keyvals_arr_t. */
+typedef struct
+{
+    unsigned int hash;
+    int pos;                /* Position in arr plus one, 0 if empty. */
+} keyvals_hash_t;
+
 /* Array of keyvals_t. */
 typedef struct 
 {
@@ -101,8 +116,19 @@ typedef struct
     int alloc_len;
     int pos;
     keyvals_t *arr;
+    int index_len;          /* MR_CONTAINER_HASH only. */
+    keyvals_hash_t *index;
 } keyvals_arr_t;
 
+/* Arena of a map thread, on a cache line of its own. */
+typedef struct
+{
+    union {
+        mem_arena_t arena;
+        char pad[L2_CACHE_LINE_SIZE];
+    };
+} thread_arena_t;
+
 /* Thread information.
    Denotes the id and the assigned CPU of a thread. */
 typedef struct 
@@ -147,6 +173,9 @@ typedef struct
 
     int intermediate_task_alloc_len;
 
+    mr_container_t container;       /* Intermediate container. */
+    int key_range;                  /* # of keys for MR_CONTAINER_ARRAY. */
+
     /* Callbacks. */
     map_t map;                      /* Map function. */
     reduce_t reduce;                /* Reduce function. */
@@ -162,26 +191,59 @@ typedef struct
 
     keyvals_arr_t **intermediate_vals;
                                     /* Array to send to reduce task. */
+    keyvals_t **dense_vals;         /* Per map thread arrays indexed by key,
+                                       for MR_CONTAINER_ARRAY. */
+    thread_arena_t *arenas;         /* Per map thread allocators for the
+                                       intermediate data. */
 
     keyval_arr_t *final_vals;       /* Array to send to merge task. */
-    keyval_arr_t *merge_vals;       /* Array to send to user. */
+    int *merge_bounds;              /* Range of each merge thread in each
+                                       run, see merge_runs(). */
+    keyval_t *merge_output;         /* Array the merge threads fill. */
 
     int splitter_pos;         /* Tracks position in array_splitter(). */
 
+    /* Streaming input, see stream_fill(). */
+    bool streaming;                 /* Input is args->input_file? */
+    bool stream_done;               /* Splitter is exhausted? */
+    int stream_fd;                  /* Descriptor of the mapped file. */
+    int stream_window;              /* Bytes split per window. */
+    int stream_tasks;               /* # of map tasks generated so far. */
+    char *stream_end;               /* End of the data already split. */
+    pthread_mutex_t stream_lock;    /* Serializes splitter calls. */
+
     /* Policy for mapping threads to cpus. */
     sched_policy    *schedPolicies[TASK_TYPE_TOTAL];
 
 
     taskQ_t         *taskQueue;     /* Queues of tasks. */
     tpool_t         *tpool;         /* Thread pool. */
+
+    struct mr_emit_ctx *emit_ctx;   /* Per map thread emit contexts. */
 } mr_env_t;
 
+/* Where a map thread emits to, handed to the map function in map_args_t
+   so that emit_intermediate_ctx() needs no lookup. */
+struct mr_emit_ctx
+{
+    union {
+        struct {
+            mr_env_t        *env;
+            keyvals_arr_t   *vals;      /* Buckets of the thread. */
+            keyvals_t       *dense;     /* Keys for MR_CONTAINER_ARRAY. */
+            mem_arena_t     *arena;
+        };
+        char pad[L2_CACHE_LINE_SIZE];
+    };
+};
+
 #ifdef TIMING
 static pthread_key_t emit_time_key;
 #endif
 static pthread_key_t env_key;       /* Environment for current thread. */
 static pthread_key_t tpool_key;
 static pthread_key_t thread_index_key;
+static pthread_key_t emit_ctx_key;  /* Emit context of a map thread. */
 
 /* Data passed on to each worker thread. */
 typedef struct
@@ -191,7 +253,6 @@ typedef struct
     TASK_TYPE_T     task_type;          /* Assigned task type. */
     int             merge_len;
     keyval_arr_t    *merge_input;
-    int             merge_round;
     mr_env_t        *env;
 } thread_arg_t;
 
@@ -207,11 +268,21 @@ static inline int getNumTaskThreads (mr_env_t* env, TASK_TYPE_T);
 static inline void insert_keyval (
     mr_env_t* env, keyval_arr_t *, void *, void *);
 static inline void insert_keyval_merged (
-    mr_env_t* env, keyvals_arr_t *, void *, void *);
+    mr_env_t* env, mem_arena_t *, keyvals_arr_t *, void *, void *);
+static inline void insert_keyval_hashed (
+    mr_env_t* env, mem_arena_t *, keyvals_arr_t *, void *, void *, int);
+static inline void insert_keyval_dense (
+    mr_env_t* env, mem_arena_t *, keyvals_t *, void *, void *);
+static inline void insert_val (
+    mr_env_t* env, mem_arena_t *, keyvals_t *, void *);
+static void finish_intermediate (mr_env_t* env, int thread_idx);
+static void sort_keyvals (mr_env_t* env, keyvals_t *, int);
 
 static int array_splitter (void *, int, map_args_t *);
 static void identity_reduce (void *, iterator_t *itr);
-static inline void merge_results (mr_env_t* env, keyval_arr_t*, int);
+static void merge_runs (mr_env_t* env, keyval_arr_t *, int, keyval_arr_t *);
+static void merge_range (mr_env_t* env, keyval_arr_t *,
+    const int *, const int *, int, keyval_t *);
 
 static void *map_worker (void *);
 static void *reduce_worker (void *);
@@ -220,6 +291,9 @@ static void *merge_worker (void *);
 static int gen_map_tasks (mr_env_t* env);
 static int gen_map_tasks_split(mr_env_t* env, queue_t* q);
 static int gen_reduce_tasks (mr_env_t* env);
+static int stream_open (mr_env_t* env, map_reduce_args_t *args);
+static int stream_fill (mr_env_t* env, int thread_index);
+static bool stream_refill (mr_env_t* env, int thread_index);
 
 static void map(mr_env_t* mr);
 static void reduce(mr_env_t* mr);
@@ -234,6 +308,7 @@ map_reduce_init ()
 {
     CHECK_ERROR (pthread_key_create (&tpool_key, NULL));
     CHECK_ERROR (pthread_key_create (&thread_index_key, NULL));
+    CHECK_ERROR (pthread_key_create (&emit_ctx_key, NULL));
     return 0;
 }
 
@@ -355,6 +430,24 @@ static void env_fini (mr_env_t* env)
     for (i = 0; i < TASK_TYPE_TOTAL; i++)
         sched_policy_put(env->schedPolicies[i]);
 
+    if (env->dense_vals != NULL)
+        mem_free (env->dense_vals);
+
+    /* Intermediate keys and values all go at once. */
+    for (i = 0; i < env->intermediate_task_alloc_len; i++)
+        mem_arena_release (&env->arenas[i].arena);
+    mem_free (env->arenas);
+    mem_free (env->emit_ctx);
+
+    /* The input stays mapped for the keys and values that point into it,
+       and so do the processed windows: no window is released before the
+       munmap of the caller. */
+    if (env->streaming)
+    {
+        close (env->stream_fd);
+        pthread_mutex_destroy (&env->stream_lock);
+    }
+
     mem_free (env);
 }
 
@@ -375,6 +468,13 @@ env_init (map_reduce_args_t *args)
 
     env->args = args;
 
+    /* Map the input file first, the parameters depend on its size. */
+    if (args->input_file != NULL && stream_open (env, args) != 0)
+    {
+        mem_free (env);
+        return NULL;
+    }
+
     /* 1. Determine paramenters. */
 
     /* Determine the number of processors to use. */
@@ -400,10 +500,6 @@ env_init (map_reduce_args_t *args)
     env->num_merge_threads = (args->num_merge_threads > 0) ? 
         args->num_merge_threads : env->num_reduce_threads;
 
-    if (env->oneOutputQueuePerReduceTask == false) {
-        env->num_merge_threads = env->num_reduce_threads / 2;
-    }
-
     /* Assign at least one merge thread. */
     env->num_merge_threads = MAX(env->num_merge_threads, 1);
 
@@ -459,6 +555,12 @@ env_init (map_reduce_args_t *args)
     env->locator = args->locator;
     env->key_cmp = args->key_cmp;
 
+    /* Select the intermediate container. */
+    env->container = args->intermediate_container;
+    env->key_range = args->key_range;
+    if (env->container == MR_CONTAINER_ARRAY)
+        CHECK_ERROR (env->key_range <= 0);
+
     /* 2. Initialize structures. */
 
     env->intermediate_vals = (keyvals_arr_t **)mem_malloc (
@@ -470,6 +572,21 @@ env_init (map_reduce_args_t *args)
             env->num_reduce_tasks, sizeof (keyvals_arr_t));
     }
 
+    env->arenas = (thread_arena_t *)mem_calloc (
+        env->intermediate_task_alloc_len, sizeof (thread_arena_t));
+    for (i = 0; i < env->intermediate_task_alloc_len; i++)
+        mem_arena_init (&env->arenas[i].arena);
+
+    env->emit_ctx = (struct mr_emit_ctx *)mem_calloc (
+        env->intermediate_task_alloc_len, sizeof (struct mr_emit_ctx));
+
+    /* The key arrays themselves are allocated by their map thread. */
+    if (env->container == MR_CONTAINER_ARRAY)
+    {
+        env->dense_vals = (keyvals_t **)mem_calloc (
+            env->intermediate_task_alloc_len, sizeof (keyvals_t *));
+    }
+
     if (env->oneOutputQueuePerReduceTask)
     {
         env->final_vals = 
@@ -677,7 +794,9 @@ typedef struct {
 static bool map_worker_do_next_task (
     mr_env_t *env, int thread_index, map_worker_task_args_t *args)
 {
+#ifdef TIMING
     struct timeval  begin, end;
+#endif
     int             alloc_len;
     int             curr_task;
     task_t          map_task;
@@ -690,9 +809,10 @@ static bool map_worker_do_next_task (
     alloc_len = env->intermediate_task_alloc_len;
 
     /* Get new map task. */
-    if (tq_dequeue (env->taskQueue, &map_task, lgrp, thread_index) == 0) {
-        /* no more map tasks */
-        return false;
+    while (tq_dequeue (env->taskQueue, &map_task, lgrp, thread_index) == 0) {
+        /* no more map tasks, unless there is input left to split */
+        if (!env->streaming || !stream_refill (env, thread_index))
+            return false;
     }
 
     curr_task = env->num_map_tasks++;
@@ -701,16 +821,18 @@ static bool map_worker_do_next_task (
     
     thread_func_arg.length = map_task.len;
     thread_func_arg.data = (void *)map_task.data;
+    thread_func_arg.ctx = &env->emit_ctx[thread_index];
 
  //   dprintf("Task %d: cpu_id -> %x - Started\n", curr_task, (int)env->tinfo[thread_index].tid);
 
     /* Perform map task. */
+#ifdef TIMING
     get_time (&begin);
     env->map (&thread_func_arg);
     get_time (&end);
-
-#ifdef TIMING
     args->run_time = time_diff (&end, &begin);
+#else
+    env->map (&thread_func_arg);
 #endif
 
 //    dprintf("Task %d: cpu_id -> %x - Done\n", curr_task, (int)env->tinfo[thread_index].tid);
@@ -738,6 +860,7 @@ map_worker (void *args)
     int                     thread_index = th_arg->thread_id;
     int                     num_assigned = 0;
     map_worker_task_args_t  mwta;
+    struct mr_emit_ctx      *ctx;
 #ifdef TIMING
     uintptr_t               work_time = 0;
     uintptr_t               combiner_time = 0;
@@ -754,6 +877,24 @@ map_worker (void *args)
 #endif
 
     mwta.lgrp = loc_get_lgrp();
+    mwta.run_time = 0;
+
+    if (env->container == MR_CONTAINER_ARRAY)
+    {
+        env->dense_vals[thread_index] = (keyvals_t *)mem_arena_calloc (
+            &env->arenas[thread_index].arena, env->key_range,
+            sizeof (keyvals_t));
+    }
+
+    /* Per thread output queues only, see emit_intermediate_inline(). */
+    assert (! env->oneOutputQueuePerMapTask);
+    ctx = &env->emit_ctx[thread_index];
+    ctx->env = env;
+    ctx->vals = env->intermediate_vals[thread_index];
+    ctx->dense = (env->dense_vals != NULL) ?
+        env->dense_vals[thread_index] : NULL;
+    ctx->arena = &env->arenas[thread_index].arena;
+    CHECK_ERROR (pthread_setspecific (emit_ctx_key, ctx));
 
     get_time (&work_begin);
     while (map_worker_do_next_task (env, thread_index, &mwta)) {
@@ -768,6 +909,10 @@ map_worker (void *args)
 
     get_time (&begin);
 
+    /* Put the buckets in the sorted form the reduce tasks expect. */
+    if (env->container != MR_CONTAINER_SORTED)
+        finish_intermediate (env, thread_index);
+
     /* Apply combiner to local map results. */
 #ifndef INCREMENTAL_COMBINER
     if (env->combiner != NULL)
@@ -813,7 +958,9 @@ typedef struct {
 static bool reduce_worker_do_next_task (
     mr_env_t *env, int thread_index, reduce_worker_task_args_t *args)
 {
+#ifdef TIMING
     struct timeval  begin, end;
+#endif
     intptr_t        curr_reduce_task = 0;
     keyvals_t       *min_key_val, *next_min;
     task_t          reduce_task;
@@ -875,32 +1022,20 @@ static bool reduce_worker_do_next_task (
         }
 
         if (min_key_val != NULL) {
-            keyvals_t       *curr_key_val;
-
             if (env->reduce != identity_reduce) {
+#ifdef TIMING
                 get_time (&begin);
                 env->reduce (min_key_val->key, &args->itr);
                 get_time (&end);
-#ifdef TIMING
                 args->run_time += time_diff (&end, &begin);
+#else
+                env->reduce (min_key_val->key, &args->itr);
 #endif
             } else {
                 env->reduce (min_key_val->key, &args->itr);
             }
 
-            /* Free up memory */
-            iter_rewind (&args->itr);
-            while (iter_next_list (&args->itr, &curr_key_val)) {
-                val_t   *vals, *next;
-
-                vals = curr_key_val->vals;
-                while (vals != NULL) {
-                    next = vals->next_val;
-                    mem_free (vals);
-                    vals = next;
-                }
-            }
-
+            /* The values live in the map arenas, freed in env_fini. */
             iter_reset(&args->itr);
         }
 
@@ -915,14 +1050,6 @@ static bool reduce_worker_do_next_task (
             curr_thread++);
     } while (curr_thread != num_map_threads);
 
-    /* Free up the memory. */
-    for (curr_thread = 0; curr_thread < num_map_threads; curr_thread++) {
-        keyvals_arr_t   *arr;
-
-        arr = &env->intermediate_vals[curr_thread][curr_reduce_task];
-        if (arr->alloc_len != 0)
-            mem_free(arr->arr);
-    }
 
     return true;
 }
@@ -1004,56 +1131,35 @@ merge_worker (void *args)
     thread_arg_t    *th_arg = (thread_arg_t *)args;
     int             thread_index = th_arg->thread_id;
     mr_env_t        *env = th_arg->env;
-    int             cpu;
+    int             *lo, *hi;
+    int             nruns, out_pos, i;
 #ifdef TIMING
     uintptr_t       work_time = 0;
 #endif
 
     env->tinfo[thread_index].tid = pthread_self();
 
-    /* Bind thread.
-       Spread out the merge workers as much as possible. */
-    if (env->oneOutputQueuePerReduceTask)
-        cpu = th_arg->cpu_id * (1 << (th_arg->merge_round - 1));
-    else
-        cpu = th_arg->cpu_id * (1 << th_arg->merge_round);
-
-    CHECK_ERROR (proc_bind_thread (cpu) != 0);
+    /* Bind thread. */
+    CHECK_ERROR (proc_bind_thread (th_arg->cpu_id) != 0);
 
     CHECK_ERROR (pthread_setspecific (env_key, env));
 
-    /* Assumes num_merge_threads is modified before each call. */
-    int length = th_arg->merge_len / env->num_merge_threads;
-    int modlen = th_arg->merge_len % env->num_merge_threads;
-
-    /* Let's make some progress here. */
-    if (length <= 1) {
-        length = 2;
-        modlen = th_arg->merge_len % 2;
-    }
-
-    int pos = thread_index * length + 
-                ((thread_index < modlen) ? thread_index : modlen);
+    /* Everything before this thread's range goes to the threads before. */
+    nruns = th_arg->merge_len;
+    lo = &env->merge_bounds[thread_index * nruns];
+    hi = &env->merge_bounds[(thread_index + 1) * nruns];
+    for (out_pos = 0, i = 0; i < nruns; i++)
+        out_pos += lo[i];
 
-    if (pos < th_arg->merge_len) {
-
-        keyval_arr_t *vals = &th_arg->merge_input[pos];
-
-//        dprintf("Thread %d: cpu_id -> %d - Started\n", 
-  //                  thread_index, th_arg->cpu_id);
-
-        get_time (&work_begin);
-        merge_results (th_arg->env, vals, length + (thread_index < modlen));
-        get_time (&work_end);
+    get_time (&work_begin);
+    merge_range (env, th_arg->merge_input, lo, hi, nruns,
+        &env->merge_output[out_pos]);
+    get_time (&work_end);
 
 #ifdef TIMING
-        work_time = time_diff (&work_end, &work_begin);
+    work_time = time_diff (&work_end, &work_begin);
 #endif
 
-//        dprintf("Thread %d: cpu_id -> %d - Done\n", 
-//                    thread_index, th_arg->cpu_id);
-    }
-
     /* Unbind thread. */
     CHECK_ERROR (proc_unbind_thread () != 0);
 
@@ -1238,6 +1344,13 @@ static int gen_map_tasks (mr_env_t* env)
     queue_t         temp_queue;
     int             num_map_threads;
 
+    /* Only the first window of a streamed input is split up front. */
+    if (env->streaming) {
+        tq_reset (env->taskQueue, env->num_map_threads);
+        num_map_tasks = stream_fill (env, -1);
+        return (num_map_tasks > 0) ? num_map_tasks : -1;
+    }
+
     queue_init (&temp_queue);
 
     num_map_tasks = gen_map_tasks_split (env, &temp_queue);
@@ -1256,6 +1369,116 @@ static int gen_map_tasks (mr_env_t* env)
     return num_map_tasks;
 }
 
+/**
+ * Maps args->input_file and points args->task_data and args->data_size
+ * at it, so the splitter works on the mapping.
+ * @return 0 on success, less than 0 on failure
+ */
+static int stream_open (mr_env_t* env, map_reduce_args_t *args)
+{
+    struct stat     st;
+    void            *base;
+    int             fd;
+
+    fd = open (args->input_file, O_RDONLY, 0);
+    if (fd < 0)
+        return -1;
+
+    if (fstat (fd, &st) != 0 || st.st_size == 0) {
+        close (fd);
+        return -1;
+    }
+
+    base = mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (base == MAP_FAILED) {
+        close (fd);
+        return -1;
+    }
+
+    args->task_data = base;
+    args->data_size = st.st_size;
+
+    env->streaming = true;
+    env->stream_fd = fd;
+    env->stream_end = (char *)base;
+    env->stream_window = (args->input_window > 0) ?
+        args->input_window : DEFAULT_STREAM_WINDOW;
+    CHECK_ERROR (pthread_mutex_init (&env->stream_lock, NULL));
+
+    return 0;
+}
+
+/**
+ * Splits the next window of the streamed input into map tasks, and queues
+ * each task on the cluster that holds its first page. Called with
+ * thread_index -1 before the map workers start, then under stream_lock
+ * by the workers that run out of tasks.
+ * @return number of tasks queued, 0 once the input is exhausted
+ */
+static int stream_fill (mr_env_t* env, int thread_index)
+{
+    char            *window_end;
+    map_args_t      args;
+    task_t          task;
+    void            *addr;
+    int             num_tasks = 0;
+    int             lgrp;
+
+    window_end = env->stream_end + env->stream_window;
+
+    while (!env->stream_done && env->stream_end < window_end)
+    {
+        if (env->splitter (env->args->task_data, env->chunk_size, &args) == 0) {
+            env->stream_done = true;
+            break;
+        }
+
+        addr = (env->locator != NULL) ? env->locator (&args) : args.data;
+
+        /* Fault the page in, its cluster is not known before. */
+        if (args.length > 0) {
+            (void)*(volatile char *)addr;
+            lgrp = loc_mem_to_lgrp (addr);
+        } else {
+            lgrp = -1;
+        }
+
+        mem_memset (&task, 0, sizeof (task_t));
+        task.id = env->stream_tasks++;
+        task.len = (uint32_t)args.length;
+        task.data = (uint32_t)args.data;
+        task.v[3] = lgrp;               /* For debugging. */
+
+        if (thread_index < 0)
+            CHECK_ERROR (tq_enqueue_seq (env->taskQueue, &task, lgrp) != 0);
+        else
+            CHECK_ERROR (tq_enqueue (
+                env->taskQueue, &task, lgrp, thread_index) != 0);
+
+        env->stream_end = (char *)args.data + args.length;
+        num_tasks++;
+    }
+
+    return num_tasks;
+}
+
+/**
+ * Called by a map worker that found no task.
+ * @return true if the worker should look for tasks again
+ */
+static bool stream_refill (mr_env_t* env, int thread_index)
+{
+    bool            was_done;
+
+    pthread_mutex_lock (&env->stream_lock);
+    was_done = env->stream_done;
+    if (!was_done)
+        stream_fill (env, thread_index);
+    pthread_mutex_unlock (&env->stream_lock);
+
+    return !was_done;
+}
+
 static int gen_reduce_tasks (mr_env_t* env)
 {
     int ret, tid;
@@ -1312,7 +1535,7 @@ static void run_combiner (mr_env_t* env, int thread_index)
     keyvals_t *reduce_pos;
     void *reduced_val;
     iterator_t itr;
-    val_t *val, *next;
+    val_t *val;
 
     CHECK_ERROR (iter_init (&itr, 1));
 
@@ -1328,15 +1551,8 @@ static void run_combiner (mr_env_t* env, int thread_index)
 
             reduced_val = env->combiner (&itr);
 
-            /* Shed off trailing chunks. */
+            /* Shed off trailing chunks, the arena reclaims them. */
             assert (reduce_pos->vals);
-            val = reduce_pos->vals->next_val;
-            while (val)
-            {
-                next = val->next_val;
-                mem_free (val);
-                val = next;
-            }
 
             /* Update the entry. */
             val = reduce_pos->vals;
@@ -1353,48 +1569,110 @@ static void run_combiner (mr_env_t* env, int thread_index)
 }
 #endif
 
+#ifdef TIMING
+/** emit_time_add()
+ *  charges emit_time to the emit time of the calling thread
+ */
+static inline void
+emit_time_add (uintptr_t emit_time)
+{
+    uintptr_t total_emit_time = (uintptr_t)pthread_getspecific (emit_time_key);
+    total_emit_time += emit_time;
+    CHECK_ERROR (pthread_setspecific (emit_time_key, (void *)total_emit_time));
+}
+#endif
+
+/** emit_intermediate_inline()
+ *  inserts the key, val pair into the intermediate array of ctx
+ */
+static inline void
+emit_intermediate_inline (
+    struct mr_emit_ctx *ctx, void *key, void *val, int key_size)
+{
+    mr_env_t        *env = ctx->env;
+    keyvals_arr_t   *arr;
+    int             reduce_pos;
+
+    if (env->container == MR_CONTAINER_ARRAY)
+    {
+        insert_keyval_dense (env, ctx->arena, ctx->dense, key, val);
+        return;
+    }
+
+    reduce_pos = env->partition (env->num_reduce_tasks, key, key_size);
+    reduce_pos %= env->num_reduce_tasks;
+
+    arr = &ctx->vals[reduce_pos];
+
+    if (env->container == MR_CONTAINER_HASH)
+        insert_keyval_hashed (env, ctx->arena, arr, key, val, key_size);
+    else
+        /* Insert sorted in global queue at pos curr_proc */
+        insert_keyval_merged (env, ctx->arena, arr, key, val);
+}
+
 /** emit_intermediate()
  *  inserts the key, val pair into the intermediate array
  */
 void 
 emit_intermediate (void *key, void *val, int key_size)
 {
+#ifdef TIMING
     struct timeval  begin, end;
-    //static __thread int curr_thread = -1;
-    int             curr_thread;
-    int             curr_task;
-    bool            oneOutputQueuePerMapTask;
-    keyvals_arr_t   *arr;
-    mr_env_t        *env;
 
     get_time (&begin);
+#endif
 
-    env = get_env();
+    emit_intermediate_inline (
+        pthread_getspecific (emit_ctx_key), key, val, key_size);
 
-    curr_thread = getCurrThreadIndex (TASK_TYPE_MAP);
-    
-    oneOutputQueuePerMapTask = env->oneOutputQueuePerMapTask;
+#ifdef TIMING
+    get_time (&end);
+    emit_time_add (time_diff (&end, &begin));
+#endif
+}
 
-    if (oneOutputQueuePerMapTask)
-        curr_task = env->tinfo[curr_thread].curr_task;
-    else
-        curr_task = curr_thread;
-   
-    int reduce_pos = env->partition (env->num_reduce_tasks, key, key_size);
-    reduce_pos %= env->num_reduce_tasks;
+/** emit_intermediate_ctx()
+ *  same as emit_intermediate(), with the context from map_args_t
+ */
+void 
+emit_intermediate_ctx (mr_emit_ctx_t *ctx, void *key, void *val, int key_size)
+{
+#ifdef TIMING
+    struct timeval  begin, end;
 
-    /* Insert sorted in global queue at pos curr_proc */
-    arr = &env->intermediate_vals[curr_task][reduce_pos];
+    get_time (&begin);
+#endif
 
-    insert_keyval_merged (env, arr, key, val);
+    emit_intermediate_inline (ctx, key, val, key_size);
 
+#ifdef TIMING
     get_time (&end);
+    emit_time_add (time_diff (&end, &begin));
+#endif
+}
 
+/** emit_intermediate_batch()
+ *  inserts num key, val pairs, the key of pairs[i] being key_sizes[i] bytes
+ */
+void 
+emit_intermediate_batch (
+    mr_emit_ctx_t *ctx, keyval_t *pairs, const int *key_sizes, int num)
+{
+    int             i;
 #ifdef TIMING
-    uintptr_t total_emit_time = (uintptr_t)pthread_getspecific (emit_time_key);
-    uintptr_t emit_time = time_diff (&end, &begin);
-    total_emit_time += emit_time;
-    CHECK_ERROR (pthread_setspecific (emit_time_key, (void *)total_emit_time));
+    struct timeval  begin, end;
+
+    get_time (&begin);
+#endif
+
+    for (i = 0; i < num; i++)
+        emit_intermediate_inline (
+            ctx, pairs[i].key, pairs[i].val, key_sizes[i]);
+
+#ifdef TIMING
+    get_time (&end);
+    emit_time_add (time_diff (&end, &begin));
 #endif
 }
 
@@ -1428,29 +1706,51 @@ emit_inline (mr_env_t* env, void *key, void *val)
 void
 emit (void *key, void *val)
 {
+#ifdef TIMING
     struct timeval begin, end;
 
     get_time (&begin);
+#endif
 
     emit_inline (get_env(), key, val);
 
-    get_time (&end);
-
 #ifdef TIMING
-    uintptr_t total_emit_time = (uintptr_t)pthread_getspecific (emit_time_key);
-    uintptr_t emit_time = time_diff (&end, &begin);
-    total_emit_time += emit_time;
-    CHECK_ERROR (pthread_setspecific (emit_time_key, (void *)total_emit_time));
+    get_time (&end);
+    emit_time_add (time_diff (&end, &begin));
 #endif
 }
 
+/** keyvals_arr_grow()
+ *  makes room for one more keyvals_t in arr
+ */
+static inline void
+keyvals_arr_grow (mem_arena_t *arena, keyvals_arr_t *arr)
+{
+    /* if array is full, double and copy over. */
+    if (arr->len == arr->alloc_len)
+    {
+        if (arr->alloc_len == 0)
+        {
+            arr->alloc_len = DEFAULT_KEYVAL_ARR_LEN;
+            arr->arr = (keyvals_t *)mem_arena_alloc (
+                arena, arr->alloc_len * sizeof (keyvals_t));
+        }
+        else
+        {
+            arr->alloc_len *= 2;
+            arr->arr = (keyvals_t *)mem_arena_realloc (arena, arr->arr,
+                arr->len * sizeof (keyvals_t),
+                arr->alloc_len * sizeof (keyvals_t));
+        }
+    }
+}
+
 static inline void 
-insert_keyval_merged (mr_env_t* env, keyvals_arr_t *arr, void *key, void *val)
+insert_keyval_merged (
+    mr_env_t* env, mem_arena_t *arena, keyvals_arr_t *arr, void *key, void *val)
 {
     int high = arr->len, low = -1, next;
     int cmp = 1;
-    keyvals_t *insert_pos;
-    val_t *new_vals;
 
     assert(arr->len <= arr->alloc_len);
     if (arr->len > 0)
@@ -1480,22 +1780,7 @@ insert_keyval_merged (mr_env_t* env, keyvals_arr_t *arr, void *key, void *val)
 
     if (arr->len == 0 || cmp)
     {
-        /* if array is full, double and copy over. */
-        if (arr->len == arr->alloc_len)
-        {
-            if (arr->alloc_len == 0)
-            {
-                arr->alloc_len = DEFAULT_KEYVAL_ARR_LEN;
-                arr->arr = (keyvals_t *)
-                    mem_malloc (arr->alloc_len * sizeof (keyvals_t));
-            }
-            else
-            {
-                arr->alloc_len *= 2;
-                arr->arr = (keyvals_t *)
-                    mem_realloc (arr->arr, arr->alloc_len * sizeof (keyvals_t));
-            }
-        }
+        keyvals_arr_grow (arena, arr);
 
         /* Insert into array. */
         memmove (&arr->arr[low+1], &arr->arr[low], 
@@ -1507,13 +1792,26 @@ insert_keyval_merged (mr_env_t* env, keyvals_arr_t *arr, void *key, void *val)
         arr->len++;
     }
 
-    insert_pos = &(arr->arr[low]);
+    insert_val (env, arena, &(arr->arr[low]), val);
+}
+
+/** insert_val()
+ *  appends val to the value chunks of insert_pos
+ */
+static inline void
+insert_val (mr_env_t* env, mem_arena_t *arena, keyvals_t *insert_pos, void *val)
+{
+    val_t *new_vals;
+
+#ifndef INCREMENTAL_COMBINER
+    (void)env;
+#endif
 
     if (insert_pos->vals == NULL)
     {
         /* Allocate a chunk for the first time. */
-        new_vals = mem_malloc 
-            (sizeof (val_t) + DEFAULT_VALS_ARR_LEN * sizeof (void *));
+        new_vals = mem_arena_alloc (arena,
+            sizeof (val_t) + DEFAULT_VALS_ARR_LEN * sizeof (void *));
         assert (new_vals);
 
         new_vals->size = DEFAULT_VALS_ARR_LEN;
@@ -1545,7 +1843,8 @@ insert_keyval_merged (mr_env_t* env, keyvals_arr_t *arr, void *key, void *val)
             int alloc_size;
 
             alloc_size = insert_pos->vals->size * 2;
-            new_vals = mem_malloc (sizeof (val_t) + alloc_size * sizeof (void *));
+            new_vals = mem_arena_alloc (arena,
+                sizeof (val_t) + alloc_size * sizeof (void *));
             assert (new_vals);
 
             new_vals->size = alloc_size;
@@ -1563,6 +1862,199 @@ insert_keyval_merged (mr_env_t* env, keyvals_arr_t *arr, void *key, void *val)
     insert_pos->len += 1;
 }
 
+/** keyvals_index_grow()
+ *  doubles the hash index of arr and rehashes its slots
+ */
+static void
+keyvals_index_grow (mem_arena_t *arena, keyvals_arr_t *arr)
+{
+    keyvals_hash_t *old = arr->index;
+    int old_len = arr->index_len;
+    int i, j, mask;
+
+    arr->index_len = old_len ? old_len * 2 : DEFAULT_KEYVALS_INDEX_LEN;
+    arr->index = (keyvals_hash_t *)
+        mem_arena_calloc (arena, arr->index_len, sizeof (keyvals_hash_t));
+    mask = arr->index_len - 1;
+
+    for (i = 0; i < old_len; i++)
+    {
+        if (old[i].pos == 0) continue;
+
+        for (j = old[i].hash & mask; arr->index[j].pos; j = (j + 1) & mask)
+            ;
+        arr->index[j] = old[i];
+    }
+}
+
+/** insert_keyval_hashed()
+ *  looks the key up through the hash index of arr, appending it
+ *  unsorted if it is new
+ */
+static inline void 
+insert_keyval_hashed (mr_env_t* env, mem_arena_t *arena,
+    keyvals_arr_t *arr, void *key, void *val, int key_size)
+{
+    unsigned int hash = 2166136261U;
+    unsigned char *str = (unsigned char *)key;
+    keyvals_hash_t *slot;
+    int i, mask;
+
+    /* FNV-1a; the partition hash already picked the bucket. */
+    for (i = 0; i < key_size; i++)
+        hash = (hash ^ str[i]) * 16777619U;
+
+    /* Keep the index at most half full. */
+    if (2 * (arr->len + 1) > arr->index_len)
+        keyvals_index_grow (arena, arr);
+
+    mask = arr->index_len - 1;
+    for (i = hash & mask; ; i = (i + 1) & mask)
+    {
+        slot = &arr->index[i];
+        if (slot->pos == 0)
+            break;
+
+        if (slot->hash == hash &&
+                env->key_cmp (arr->arr[slot->pos - 1].key, key) == 0)
+        {
+            insert_val (env, arena, &arr->arr[slot->pos - 1], val);
+            return;
+        }
+    }
+
+    keyvals_arr_grow (arena, arr);
+
+    arr->arr[arr->len].key = key;
+    arr->arr[arr->len].len = 0;
+    arr->arr[arr->len].vals = NULL;
+    arr->len++;
+
+    slot->hash = hash;
+    slot->pos = arr->len;
+
+    insert_val (env, arena, &arr->arr[arr->len - 1], val);
+}
+
+/** insert_keyval_dense()
+ *  stores val in the slot of dense indexed by the integer key
+ */
+static inline void 
+insert_keyval_dense (
+    mr_env_t* env, mem_arena_t *arena, keyvals_t *dense, void *key, void *val)
+{
+    intptr_t index = (intptr_t)key;
+
+    assert (index >= 0 && index < env->key_range);
+
+    dense[index].key = key;
+    insert_val (env, arena, &dense[index], val);
+}
+
+/** sort_keyvals()
+ *  sorts arr by key, quicksort down to short runs then insertion sort
+ */
+static void
+sort_keyvals (mr_env_t* env, keyvals_t *arr, int len)
+{
+    keyvals_t tmp;
+    void *pivot;
+    int i, j, mid;
+
+    while (len > SORT_INSERTION_LEN)
+    {
+        /* Median of three, the dense container hands in sorted runs. */
+        mid = len / 2;
+        if (env->key_cmp (arr[mid].key, arr[0].key) < 0)
+        {
+            tmp = arr[0]; arr[0] = arr[mid]; arr[mid] = tmp;
+        }
+        if (env->key_cmp (arr[len - 1].key, arr[mid].key) < 0)
+        {
+            tmp = arr[len - 1]; arr[len - 1] = arr[mid]; arr[mid] = tmp;
+            if (env->key_cmp (arr[mid].key, arr[0].key) < 0)
+            {
+                tmp = arr[0]; arr[0] = arr[mid]; arr[mid] = tmp;
+            }
+        }
+        pivot = arr[mid].key;
+
+        i = -1;
+        j = len;
+        for (;;)
+        {
+            do i++; while (env->key_cmp (arr[i].key, pivot) < 0);
+            do j--; while (env->key_cmp (arr[j].key, pivot) > 0);
+            if (i >= j) break;
+            tmp = arr[i]; arr[i] = arr[j]; arr[j] = tmp;
+        }
+
+        /* Recurse on the smaller half, loop on the larger one. */
+        if (j + 1 < len - j - 1)
+        {
+            sort_keyvals (env, arr, j + 1);
+            arr += j + 1;
+            len -= j + 1;
+        }
+        else
+        {
+            sort_keyvals (env, arr + j + 1, len - j - 1);
+            len = j + 1;
+        }
+    }
+
+    for (i = 1; i < len; i++)
+    {
+        tmp = arr[i];
+        for (j = i; j > 0 && env->key_cmp (arr[j - 1].key, tmp.key) > 0; j--)
+            arr[j] = arr[j - 1];
+        arr[j] = tmp;
+    }
+}
+
+/** finish_intermediate()
+ *  turns the hash or dense containers of a map thread into the sorted
+ *  per reduce task arrays the reduce workers merge
+ */
+static void
+finish_intermediate (mr_env_t* env, int thread_index)
+{
+    mem_arena_t *arena = &env->arenas[thread_index].arena;
+    keyvals_arr_t *arr;
+    keyvals_t *dense;
+    int i, reduce_pos;
+
+    assert (! env->oneOutputQueuePerMapTask);
+
+    if (env->container == MR_CONTAINER_ARRAY)
+    {
+        /* Contiguous key ranges per reduce task, appended in key order. */
+        dense = env->dense_vals[thread_index];
+        for (i = 0; i < env->key_range; i++)
+        {
+            if (dense[i].len == 0) continue;
+
+            reduce_pos = (int)(((int64_t)i * env->num_reduce_tasks) /
+                env->key_range);
+            arr = &env->intermediate_vals[thread_index][reduce_pos];
+
+            keyvals_arr_grow (arena, arr);
+            arr->arr[arr->len++] = dense[i];
+        }
+
+        env->dense_vals[thread_index] = NULL;
+    }
+
+    for (i = 0; i < env->num_reduce_tasks; i++)
+    {
+        arr = &env->intermediate_vals[thread_index][i];
+        arr->index = NULL;
+        arr->index_len = 0;
+
+        sort_keyvals (env, arr->arr, arr->len);
+    }
+}
+
 static inline void 
 insert_keyval (mr_env_t* env, keyval_arr_t *arr, void *key, void *val)
 {
@@ -1629,62 +2121,169 @@ insert_keyval (mr_env_t* env, keyval_arr_t *arr, void *key, void *val)
     arr->len++;
 }
 
-static inline void 
-merge_results (mr_env_t* env, keyval_arr_t *vals, int length) 
+/** merge_sift_down()
+ *  restores the heap of run indexes below slot i, keyed on the next key
+ *  of each run
+ */
+static inline void
+merge_sift_down (mr_env_t* env, keyval_arr_t *runs, const int *pos,
+    int *heap, int n, int i)
 {
-    int data_idx;
-    int total_num_keys = 0;
-    int i;
-    //static __thread int curr_thread = -1;
-    int curr_thread;
+    int     child, tmp;
 
-    curr_thread = getCurrThreadIndex (TASK_TYPE_MERGE);
+    while ((child = 2 * i + 1) < n)
+    {
+        if (child + 1 < n && env->key_cmp (
+                runs[heap[child + 1]].arr[pos[heap[child + 1]]].key,
+                runs[heap[child]].arr[pos[heap[child]]].key) < 0)
+            child++;
+
+        if (env->key_cmp (runs[heap[child]].arr[pos[heap[child]]].key,
+                runs[heap[i]].arr[pos[heap[i]]].key) >= 0)
+            break;
 
-    for (i = 0; i < length; i++) {
-        total_num_keys += vals[i].len;
+        tmp = heap[i]; heap[i] = heap[child]; heap[child] = tmp;
+        i = child;
     }
+}
+
+/** merge_range()
+ *  merges [lo[r], hi[r]) of every run r into out
+ */
+static void
+merge_range (mr_env_t* env, keyval_arr_t *runs, const int *lo, const int *hi,
+    int nruns, keyval_t *out)
+{
+    int     *heap, *pos;
+    int     n = 0, r, top;
+
+    heap = (int *)mem_malloc (nruns * sizeof (int));
+    pos = (int *)mem_malloc (nruns * sizeof (int));
 
-    env->merge_vals[curr_thread].len = total_num_keys;
-    env->merge_vals[curr_thread].alloc_len = total_num_keys;
-    env->merge_vals[curr_thread].pos = 0;
-    env->merge_vals[curr_thread].arr = (keyval_t *)
-      mem_malloc(sizeof(keyval_t) * total_num_keys);
+    for (r = 0; r < nruns; r++)
+    {
+        pos[r] = lo[r];
+        if (lo[r] < hi[r])
+            heap[n++] = r;
+    }
 
-    for (data_idx = 0; data_idx < total_num_keys; data_idx++) {
-        /* For each keyval_t. */
-        int         min_idx;
-        keyval_t    *min_keyval;
+    for (r = n / 2 - 1; r >= 0; r--)
+        merge_sift_down (env, runs, pos, heap, n, r);
 
-        for (i = 0; i < length && vals[i].pos >= vals[i].len; i++);
+    while (n > 0)
+    {
+        top = heap[0];
+        *out++ = runs[top].arr[pos[top]++];
 
-        if (i == length) break;
+        if (pos[top] == hi[top])
+            heap[0] = heap[--n];
+        merge_sift_down (env, runs, pos, heap, n, 0);
+    }
 
-        /* Determine the minimum key. */
-        min_idx = i;
-        min_keyval = &vals[i].arr[vals[i].pos];
+    mem_free (heap);
+    mem_free (pos);
+}
 
-        for (i++; i < length; i++) {
-            if (vals[i].pos < vals[i].len)
-            {
-                int cmp_ret;
-                cmp_ret = env->key_cmp(
-                    min_keyval->key, 
-                    vals[i].arr[vals[i].pos].key);
-
-                if (cmp_ret > 0) {
-                    min_idx = i;
-                    min_keyval = &vals[i].arr[vals[i].pos];
-                }
-            }
+/** merge_lower_bound()
+ *  returns the position of the first key of run not less than key
+ */
+static inline int
+merge_lower_bound (mr_env_t* env, keyval_arr_t *run, void *key)
+{
+    int     low = 0, high = run->len, next;
+
+    while (low < high)
+    {
+        next = (low + high) / 2;
+        if (env->key_cmp (run->arr[next].key, key) < 0)
+            low = next + 1;
+        else
+            high = next;
+    }
+
+    return low;
+}
+
+/** merge_runs()
+ *  merges the nruns sorted runs into out in one pass. Keys sampled from
+ *  every run split the key space into one range per merge thread, and
+ *  each thread merges its range of all the runs into its own slice of
+ *  out. The runs are freed.
+ */
+static void
+merge_runs (mr_env_t* env, keyval_arr_t *runs, int nruns, keyval_arr_t *out)
+{
+    thread_arg_t    th_arg;
+    keyvals_t       *samples;
+    void            *key;
+    int             num_merge_threads = env->num_merge_threads;
+    int             nthreads, nsamples, per_run, len, total;
+    int             r, j, w;
+
+    for (total = 0, r = 0; r < nruns; r++)
+        total += runs[r].len;
+
+    out->len = out->alloc_len = total;
+    out->pos = 0;
+    out->arr = (keyval_t *)mem_malloc (MAX (total, 1) * sizeof (keyval_t));
+
+    nthreads = MAX (MIN (num_merge_threads, total), 1);
+
+    /* Sample every run evenly, more samples make the ranges more even. */
+    per_run = (MERGE_SAMPLES_PER_THREAD * nthreads + nruns - 1) / nruns;
+    samples = (keyvals_t *)mem_malloc (
+        MAX (nruns * per_run, 1) * sizeof (keyvals_t));
+
+    for (nsamples = 0, r = 0; r < nruns; r++)
+    {
+        len = runs[r].len;
+        for (j = 0; j < per_run && j < len; j++)
+        {
+            samples[nsamples++].key = runs[r].arr[
+                ((2 * j + 1) * (int64_t)len) / (2 * MIN (per_run, len))].key;
         }
+    }
+
+    sort_keyvals (env, samples, nsamples);
+
+    /* Thread w merges [bounds[w][r], bounds[w + 1][r]) of run r. */
+    env->merge_bounds = (int *)mem_malloc (
+        (nthreads + 1) * nruns * sizeof (int));
 
-        mem_memcpy (&env->merge_vals[curr_thread].arr[data_idx], 
-                        min_keyval, sizeof(keyval_t));
-        vals[min_idx].pos += 1;
+    for (r = 0; r < nruns; r++)
+    {
+        env->merge_bounds[r] = 0;
+        env->merge_bounds[nthreads * nruns + r] = runs[r].len;
     }
 
-    for (i = 0; i < length; i++) {
-        mem_free(vals[i].arr);
+    for (w = 1; w < nthreads; w++)
+    {
+        key = samples[(w * nsamples) / nthreads].key;
+        for (r = 0; r < nruns; r++)
+            env->merge_bounds[w * nruns + r] =
+                merge_lower_bound (env, &runs[r], key);
+    }
+
+    mem_free (samples);
+
+    env->merge_output = out->arr;
+    env->num_merge_threads = nthreads;
+
+    mem_memset (&th_arg, 0, sizeof (thread_arg_t));
+    th_arg.task_type = TASK_TYPE_MERGE;
+    th_arg.merge_len = nruns;
+    th_arg.merge_input = runs;
+
+    start_workers (env, &th_arg);
+
+    env->num_merge_threads = num_merge_threads;
+    mem_free (env->merge_bounds);
+    env->merge_bounds = NULL;
+
+    for (r = 0; r < nruns; r++)
+    {
+        if (runs[r].alloc_len != 0)
+            mem_free (runs[r].arr);
     }
 }
 
@@ -1829,7 +2428,7 @@ static void map (mr_env_t* env)
     printf("Number of Task : %d\n", num_map_tasks);
 
     env->num_map_tasks = num_map_tasks;
-    if (num_map_tasks < env->num_map_threads)
+    if (num_map_tasks < env->num_map_threads && !env->streaming)
         env->num_map_threads = num_map_tasks;
 
     //printf (OUT_PREFIX "num_map_tasks = %d\n", env->num_map_tasks);
@@ -1868,54 +2467,74 @@ static void reduce (mr_env_t* env)
  */
 static void merge (mr_env_t* env)
 {
-    thread_arg_t   th_arg;
-
-    mem_memset (&th_arg, 0, sizeof (thread_arg_t));
-    th_arg.task_type = TASK_TYPE_MERGE;
+    keyval_arr_t    *runs, *next;
+    keyval_arr_t    out;
+    int             nruns, ngroups, fan_in;
+    int             i;
 
     if (env->oneOutputQueuePerReduceTask) {
-        th_arg.merge_len = env->num_reduce_tasks;
+        nruns = env->num_reduce_tasks;
     } else {
-        th_arg.merge_len = env->num_reduce_threads;
+        nruns = env->num_reduce_threads;
     }
-    th_arg.merge_input = env->final_vals;
-
-    if (th_arg.merge_len <= 1) {
-        /* Already merged, nothing to do here */
-        env->args->result->data = env->final_vals->arr;
-        env->args->result->length = env->final_vals->len;
+    runs = env->final_vals;
+
+    if (env->args->partitioned_output) {
+        /* Hand the sorted runs over as they are. Their keys are disjoint. */
+        final_data_t *result = env->args->result;
+
+        result->num_parts = nruns;
+        result->parts = (final_part_t *)mem_malloc (
+            nruns * sizeof (final_part_t));
+        result->data = NULL;
+        result->length = 0;
+
+        for (i = 0; i < nruns; i++) {
+            result->parts[i].data = runs[i].arr;
+            result->parts[i].length = runs[i].len;
+            result->length += runs[i].len;
+        }
 
-        mem_free(env->final_vals);
+        mem_free(runs);
 
         return;
     }
 
-    /* have work to merge! */
-    while (th_arg.merge_len > 1) {
-        th_arg.merge_round += 1;
+    env->args->result->num_parts = 0;
+    env->args->result->parts = NULL;
 
-        /* This is the worst case length, 
-           depending on the value of num_merge_threads. */
-        env->merge_vals = (keyval_arr_t*) 
-            mem_malloc (env->num_merge_threads * sizeof(keyval_arr_t));
+    if (nruns <= 1) {
+        /* Already merged, nothing to do here */
+        env->args->result->data = runs->arr;
+        env->args->result->length = runs->len;
 
-        /* Run merge tasks and get merge values. */
-        start_workers (env, &th_arg);
+        mem_free(runs);
 
-        mem_free (th_arg.merge_input);
-        th_arg.merge_len = env->num_merge_threads;
+        return;
+    }
+
+    /* have work to merge! Go in rounds only if the fan-in is limited. */
+    fan_in = (env->args->merge_fan_in >= 2) ? env->args->merge_fan_in : nruns;
 
-        env->num_merge_threads /= 2;
-        if (env->num_merge_threads == 0)
-            env->num_merge_threads = 1;
+    while (nruns > fan_in) {
+        ngroups = (nruns + fan_in - 1) / fan_in;
+        next = (keyval_arr_t *)mem_calloc (ngroups, sizeof (keyval_arr_t));
+
+        for (i = 0; i < ngroups; i++) {
+            merge_runs (env, &runs[i * fan_in], 
+                MIN (fan_in, nruns - i * fan_in), &next[i]);
+        }
 
-        th_arg.merge_input = env->merge_vals;
+        mem_free (runs);
+        runs = next;
+        nruns = ngroups;
     }
 
-    env->args->result->data = env->merge_vals[0].arr;
-    env->args->result->length = env->merge_vals[0].len;
+    merge_runs (env, runs, nruns, &out);
+    mem_free (runs);
 
-    mem_free(env->merge_vals);
+    env->args->result->data = out.arr;
+    env->args->result->length = out.len;
 }
 
 static inline mr_env_t* get_env (void)
@@ -27,8 +27,19 @@
 #include <assert.h>
 #include <string.h>
 #include <stdlib.h>
+#include <sys/mman.h>
 
 #include "memory.h"
+#include "stddefines.h"
+
+#define MEM_ARENA_BLOCK_SIZE    (256 * 1024)
+#define MEM_ARENA_ALIGN         8
+
+struct mem_arena_block
+{
+    struct mem_arena_block *next;
+    size_t size;                    /* Mapped bytes, header included. */
+};
 
 void *mem_malloc (size_t size)
 {
@@ -76,3 +87,93 @@ void mem_free (void *ptr)
 {
     free (ptr);
 }
+
+void mem_arena_init (mem_arena_t *arena)
+{
+    arena->next = NULL;
+    arena->end = NULL;
+    arena->last = NULL;
+    arena->blocks = NULL;
+}
+
+void *mem_arena_alloc (mem_arena_t *arena, size_t size)
+{
+    struct mem_arena_block *block;
+    size_t map_size;
+    char *temp;
+
+    size = (size + MEM_ARENA_ALIGN - 1) & ~(size_t)(MEM_ARENA_ALIGN - 1);
+
+    if (arena->next == NULL || (size_t)(arena->end - arena->next) < size)
+    {
+        /* Start a new block, large requests get a block of their own. */
+        map_size = sizeof (struct mem_arena_block) + size;
+        map_size = (map_size + MEM_ARENA_BLOCK_SIZE - 1) & 
+            ~(size_t)(MEM_ARENA_BLOCK_SIZE - 1);
+
+        block = mmap (NULL, map_size, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        CHECK_ERROR (block == MAP_FAILED);
+        if (block == MAP_FAILED)
+            return NULL;
+
+        block->next = arena->blocks;
+        block->size = map_size;
+        arena->blocks = block;
+
+        arena->next = (char *)(block + 1);
+        arena->end = (char *)block + map_size;
+    }
+
+    temp = arena->next;
+    arena->next += size;
+    arena->last = temp;
+
+    return temp;
+}
+
+void *mem_arena_calloc (mem_arena_t *arena, size_t num, size_t size)
+{
+    void *temp = mem_arena_alloc (arena, num * size);
+
+    return memset (temp, 0, num * size);
+}
+
+void *mem_arena_realloc (
+    mem_arena_t *arena, void *ptr, size_t old_size, size_t size)
+{
+    void *temp;
+    size_t grow;
+
+    if (ptr == NULL)
+        return mem_arena_alloc (arena, size);
+
+    /* The last allocation grows in place while the block has room. */
+    if (ptr == arena->last)
+    {
+        grow = (size + MEM_ARENA_ALIGN - 1) & ~(size_t)(MEM_ARENA_ALIGN - 1);
+        if ((size_t)(arena->end - arena->last) >= grow)
+        {
+            arena->next = arena->last + grow;
+            return ptr;
+        }
+    }
+
+    temp = mem_arena_alloc (arena, size);
+    memcpy (temp, ptr, old_size < size ? old_size : size);
+
+    return temp;
+}
+
+void mem_arena_release (mem_arena_t *arena)
+{
+    struct mem_arena_block *block, *next;
+
+    for (block = arena->blocks; block != NULL; block = next)
+    {
+        next = block->next;
+        munmap (block, block->size);
+    }
+
+    mem_arena_init (arena);
+}
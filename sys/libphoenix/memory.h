@@ -37,4 +37,24 @@ inline void *mem_memcpy (void *dest, const void *src, size_t size);
 inline void *mem_memset (void *s, int c, size_t n);
 inline void mem_free (void *ptr);
 
+/* Bump allocator for memory that is released all at once. Blocks are
+ * anonymous mappings, so their pages come from the cluster of the thread
+ * that first touches them. An arena is used by one thread at a time. */
+struct mem_arena_block;
+
+typedef struct
+{
+    char *next;                     /* Next free byte of the current block. */
+    char *end;                      /* End of the current block. */
+    char *last;                     /* Last allocation, may grow in place. */
+    struct mem_arena_block *blocks; /* All blocks, current one first. */
+} mem_arena_t;
+
+void mem_arena_init (mem_arena_t *arena);
+void *mem_arena_alloc (mem_arena_t *arena, size_t size);
+void *mem_arena_calloc (mem_arena_t *arena, size_t num, size_t size);
+void *mem_arena_realloc (
+    mem_arena_t *arena, void *ptr, size_t old_size, size_t size);
+void mem_arena_release (mem_arena_t *arena);
+
 #endif // MEMORY_H_
@@ -0,0 +1,44 @@
+/*
+ * futex.c - user-space side of the kernel futex service
+ * 
+ * Copyright (c) 2008,2009,2010,2011,2012 Ghassan Almaless
+ * Copyright (c) 2011,2012 UPMC Sorbonne Universites
+ *
+ * This file is part of ALMOS.
+ *
+ * ALMOS is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2.0 of the License.
+ *
+ * ALMOS is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with ALMOS; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/syscall.h>
+#include <cpu-syscall.h>
+#include <pthread.h>
+
+/* Must match kernel's futex_operation_t */
+typedef enum
+{
+	FUTEX_WAIT,
+	FUTEX_WAKE
+} futex_operation_t;
+
+int __pthread_futex_wait(volatile uint_t *addr, uint_t val)
+{
+	return (int)cpu_syscall((void*)addr, (void*)FUTEX_WAIT, (void*)val, NULL, SYS_FUTEX);
+}
+
+int __pthread_futex_wake(volatile uint_t *addr, uint_t count)
+{
+	return (int)cpu_syscall((void*)addr, (void*)FUTEX_WAKE, NULL, (void*)count, SYS_FUTEX);
+}
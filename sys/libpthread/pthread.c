@@ -62,10 +62,21 @@ static void* __pthread_start(void* (*entry_func)(void*), void *arg)
 	__pthread_tls_t tls;
 	pthread_t tid;
 	struct __shared_s *shared;
+	struct __shared_s local;
   
 	__pthread_tls_init(&tls);
 
-	shared          = arg;
+	/* Keep the wait state next to the TLS, on our own stack, so that it
+	 * is allocated on our cluster and follows us when we migrate */
+	shared = arg;
+
+	if(shared->mailbox == __PTHREAD_SHARED_HEAP)
+	{
+		local.arg = shared->arg;
+		free(shared);
+		shared = &local;
+	}
+
 	shared->tid     = tls.attr.key;
 	shared->mailbox = 0;
 
@@ -120,6 +131,7 @@ int pthread_create (pthread_t *thread, pthread_attr_t *attr, void *(*start_routi
 
 		attr->sigstack_size = 2048;
 		shared = (struct __shared_s*)(attr->sigstack_addr + attr->sigstack_size + 64);
+		shared->mailbox = 0;
 	}
 	else
 	{
@@ -128,6 +140,9 @@ int pthread_create (pthread_t *thread, pthread_attr_t *attr, void *(*start_routi
 		if(shared == NULL)
 			return ENOMEM;
 
+		/* Only carries arg, the new thread moves it to its stack */
+		shared->mailbox = __PTHREAD_SHARED_HEAP;
+
 		//fprintf(stderr, "%s: shared @%x\n", __FUNCTION__, (unsigned) shared);
 	}
   
@@ -27,13 +27,16 @@
 
 #include <pthread.h>
 
-typedef enum
-{
-	BARRIER_INIT_PRIVATE,
-	BARRIER_WAIT,
-	BARRIER_DESTROY,
-	BARRIER_INIT_SHARED
-} barrier_operation_t;
+/* 
+ * Phase states: waiters spin a while on a closed phase then mark it 
+ * as having sleepers and block on it through the kernel futex service,
+ * the last thread only enters the kernel when sleepers have been marked.
+ * The word is keyed by physical page so shared barriers work the same.
+ */
+#define BARRIER_CLOSED      0
+#define BARRIER_OPEN        1
+#define BARRIER_SLEEPING    2
+#define BARRIER_SPIN_LIMIT  1000
 
 
 void __pthread_barrier_init(void)
@@ -42,15 +45,6 @@ void __pthread_barrier_init(void)
 }
 
 
-static int __sys_barrier(void *sysid, uint_t operation, uint_t count)
-{
-	register int retval;
-  
-	retval = (int)cpu_syscall(sysid,(void*)operation,(void*)count,NULL,SYS_BARRIER);
-
-	return retval;
-}
-
 int pthread_barrierattr_destroy(pthread_barrierattr_t *attr)
 {
 	if(attr == NULL)
@@ -89,17 +83,18 @@ int pthread_barrierattr_setpshared(pthread_barrierattr_t *attr, int scope)
 
 int pthread_barrier_init (pthread_barrier_t *barrier, const pthread_barrierattr_t *attr, unsigned count)
 {
+	if((barrier == NULL) || (count == 0))
+		return EINVAL;
+
 	if((attr != NULL) && (attr->scope == PTHREAD_PROCESS_SHARED))
-	{
-		barrier->scope = PTHREAD_PROCESS_SHARED;
-		return __sys_barrier(&barrier->sysid, BARRIER_INIT_SHARED, count);
-	}
+		barrier->scope  = PTHREAD_PROCESS_SHARED;
+	else
+		barrier->scope  = PTHREAD_PROCESS_PRIVATE;
 
-	barrier->scope          = PTHREAD_PROCESS_PRIVATE;
 	barrier->cntr.value     = count;
 	barrier->count.value    = count;
-	barrier->state[0].value = 0;
-	barrier->state[1].value = 0;
+	barrier->state[0].value = BARRIER_CLOSED;
+	barrier->state[1].value = BARRIER_CLOSED;
 	barrier->phase          = 0;
  
 	return 0;
@@ -107,43 +102,55 @@ int pthread_barrier_init (pthread_barrier_t *barrier, const pthread_barrierattr_
 
 int pthread_barrier_wait (pthread_barrier_t *barrier)
 {
+	volatile uint_t *state;
 	sint_t ticket;
 	uint_t phase;
-	uint_t signature;
-
-	if(barrier->scope == PTHREAD_PROCESS_SHARED)
-		return __sys_barrier(&barrier->sysid, BARRIER_WAIT, 0);
+	uint_t cntr;
+	uint_t val;
 
 	phase  = barrier->phase;
+	state  = (volatile uint_t*)&barrier->state[phase].value;
 	ticket = cpu_atomic_add(&barrier->cntr.value, -1);
 
 	if(ticket == 1)
 	{
 		barrier->cntr.value                  = barrier->count.value;
 		barrier->phase                       = ~(barrier->phase) & 0x1;
-		barrier->state[barrier->phase].value = 0;
-		barrier->state[phase].value          = 1;
+		barrier->state[barrier->phase].value = BARRIER_CLOSED;
+
+		do
+		{
+			val = *state;
+		}while(!(cpu_atomic_cas((void*)state, val, BARRIER_OPEN)));
 
 		cpu_invalid_dcache_line(&barrier->phase);
-		cpu_invalid_dcache_line((void*)&barrier->state[phase].value);
+		cpu_invalid_dcache_line((void*)state);
+
+		if(val == BARRIER_SLEEPING)
+			(void)__pthread_futex_wake(state, (uint_t)-1);
 
 		return PTHREAD_BARRIER_SERIAL_THREAD;
 	}
 
 	cpu_invalid_dcache_line(&barrier->phase);
 
-	while(barrier->state[phase].value == 0)
+	for(cntr = 0; (cntr < BARRIER_SPIN_LIMIT) && (*state == BARRIER_CLOSED); cntr++)
 		;		/* wait */
 
-	cpu_invalid_dcache_line((void*)&barrier->state[phase].value);
+	while((val = *state) != BARRIER_OPEN)
+	{
+		if((val == BARRIER_CLOSED) && !(cpu_atomic_cas((void*)state, BARRIER_CLOSED, BARRIER_SLEEPING)))
+			continue;
+
+		(void)__pthread_futex_wait(state, BARRIER_SLEEPING);
+	}
+
+	cpu_invalid_dcache_line((void*)state);
 	return 0;
 }
 
 int pthread_barrier_destroy(pthread_barrier_t *barrier)
 {
-  	if(barrier->scope == PTHREAD_PROCESS_SHARED)
-		return __sys_barrier(barrier, BARRIER_DESTROY, 0);
-
 	if(barrier->cntr.value != barrier->count.value)
 		return EBUSY;
 
@@ -27,21 +27,28 @@
 #include <sys/syscall.h>
 #include <cpu-syscall.h>
 
-typedef enum
+/* 
+ * Process-shared condition variables use count as a sequence word: 
+ * waiters block on its current value, signal/broadcast bump it and 
+ * wake one/all of them through the kernel futex service.
+ */
+static int __cond_shared_wait(pthread_cond_t *cond, pthread_mutex_t *mutex)
 {
-	CV_INIT,
-	CV_WAIT,
-	CV_SIGNAL,
-	CV_BROADCAST,
-	CV_DESTROY
-} cv_operation_t;
-
-static int __sys_cond_var(void *sysid, int operation, sem_t *sem)
+	register uint_t seq;
+
+	seq = *(volatile uint_t*)&cond->count;
+
+	(void)pthread_mutex_unlock(mutex);
+	(void)__pthread_futex_wait((volatile uint_t*)&cond->count, seq);
+
+	return pthread_mutex_lock(mutex);
+}
+
+static int __cond_shared_wake(pthread_cond_t *cond, uint_t count)
 {
-	register int retval;
-  
-	retval = (int)cpu_syscall(sysid,(void*)operation,(void*)sem,NULL,SYS_COND_VAR);
-	return retval;
+	(void)cpu_atomic_add(&cond->count, 1);
+	(void)__pthread_futex_wake((volatile uint_t*)&cond->count, count);
+	return 0;
 }
 
 int pthread_condattr_init(pthread_condattr_t *attr)
@@ -89,7 +96,8 @@ int pthread_cond_init(pthread_cond_t *cond, pthread_condattr_t *cond_attr)
 	if((cond_attr != NULL) && (cond_attr->scope == PTHREAD_PROCESS_SHARED))
 	{
 		cond->scope = PTHREAD_PROCESS_SHARED;
-		return __sys_cond_var(&cond->sysid, CV_INIT, NULL);
+		cond->count = 0;
+		return 0;
 	}
 
 	cond->scope = PTHREAD_PROCESS_PRIVATE;
@@ -112,7 +120,7 @@ int pthread_cond_wait(pthread_cond_t *cond, pthread_mutex_t *mutex)
 		return EINVAL;
 
 	if(cond->scope == PTHREAD_PROCESS_SHARED)
-		return __sys_cond_var(&cond->sysid, CV_WAIT, &mutex->sem);
+		return __cond_shared_wait(cond, mutex);
 
 	if(cond->count == 0)
 		list_root_init(&cond->queue);
@@ -141,7 +149,7 @@ int pthread_cond_signal(pthread_cond_t *cond)
 	if(cond == NULL) return EINVAL;
 
 	if(cond->scope == PTHREAD_PROCESS_SHARED)
-		return __sys_cond_var(&cond->sysid, CV_SIGNAL, NULL);
+		return __cond_shared_wake(cond, 1);
 
 	if(cond->count == 0)
 		return 0;
@@ -166,7 +174,7 @@ int pthread_cond_broadcast(pthread_cond_t *cond)
 	if(cond == NULL) return EINVAL;
   
 	if(cond->scope == PTHREAD_PROCESS_SHARED)
-		return __sys_cond_var(&cond->sysid, CV_BROADCAST, NULL);
+		return __cond_shared_wake(cond, (uint_t)-1);
 
 	if(cond->count == 0)
 	{
@@ -213,7 +221,7 @@ int pthread_cond_destroy(pthread_cond_t *cond)
 		return EINVAL;
 
 	if(cond->scope == PTHREAD_PROCESS_SHARED)
-		return __sys_cond_var(&cond->sysid, CV_DESTROY, NULL);
+		return 0;
 
 	if(cond->count != 0)
 		err = EBUSY;
@@ -27,55 +27,117 @@
 #include <sys/syscall.h>
 #include <cpu-syscall.h>
 
-typedef enum
-{
-	RWLOCK_INIT,
-	RWLOCK_WRLOCK,
-	RWLOCK_RDLOCK,
-	RWLOCK_TRYWRLOCK,
-	RWLOCK_TRYRDLOCK,
-	RWLOCK_UNLOCK,
-	RWLOCK_DESTROY
-} rwlock_operation_t;
-
-static int __sys_rwlock(pthread_rwlock_t *rwlock, uint_t operation)
+/*
+ * A rwlock is a single user word: bits 0-15 count the readers holding 
+ * the lock, bit 16 is set while a writer holds it and the upper bits 
+ * count the threads blocked in the kernel. Uncontended operations are
+ * a single CAS, unlock only enters the kernel when waiters are known.
+ */
+#define RWLOCK_READERS_MASK  0x0000FFFF
+#define RWLOCK_WRITER        0x00010000
+#define RWLOCK_WAITER_ONE    0x00020000
+#define RWLOCK_WAITERS_SHIFT 17
+
+#define rwlock_waiters(_v)   ((_v) >> RWLOCK_WAITERS_SHIFT)
+#define rwlock_isFree(_v)    (((_v) & (RWLOCK_WRITER | RWLOCK_READERS_MASK)) == 0)
+
+static int __rwlock_lock(pthread_rwlock_t *rwlock, uint_t busy_mask, uint_t incr, bool_t isTry)
 {
-	register int retval;
-	retval = (int)cpu_syscall((void*)rwlock,(void*)operation,NULL,NULL,SYS_RWLOCK);
-	return retval;
+	register uint_t val;
+
+	if(rwlock == NULL)
+		return EINVAL;
+
+	while(1)
+	{
+		val = *(volatile pthread_rwlock_t*)rwlock;
+
+		if((val & busy_mask) == 0)
+		{
+			if(((val & RWLOCK_READERS_MASK) == RWLOCK_READERS_MASK) && (incr == 1))
+				return EAGAIN;
+
+			if(cpu_atomic_cas(rwlock, val, val + incr))
+				return 0;
+
+			continue;
+		}
+
+		if(isTry)
+			return EBUSY;
+
+		if(!(cpu_atomic_cas(rwlock, val, val + RWLOCK_WAITER_ONE)))
+			continue;
+
+		(void)__pthread_futex_wait((volatile uint_t*)rwlock, val + RWLOCK_WAITER_ONE);
+		(void)cpu_atomic_add(rwlock, -RWLOCK_WAITER_ONE);
+	}
 }
 
 int pthread_rwlock_init(pthread_rwlock_t *rwlock, const pthread_rwlockattr_t *attr)
 {
-	return __sys_rwlock(rwlock, RWLOCK_INIT);
+	if(rwlock == NULL)
+		return EINVAL;
+
+	*rwlock = 0;
+	return 0;
 }
 
 int pthread_rwlock_trywrlock(pthread_rwlock_t *rwlock)
 {
-	return __sys_rwlock(rwlock, RWLOCK_TRYWRLOCK);
+	return __rwlock_lock(rwlock, RWLOCK_WRITER | RWLOCK_READERS_MASK, RWLOCK_WRITER, true);
 }
 
 int pthread_rwlock_wrlock(pthread_rwlock_t *rwlock)
 {
-	return __sys_rwlock(rwlock, RWLOCK_WRLOCK);
+	return __rwlock_lock(rwlock, RWLOCK_WRITER | RWLOCK_READERS_MASK, RWLOCK_WRITER, false);
 }
 
 int pthread_rwlock_rdlock(pthread_rwlock_t *rwlock)
 {
-	return __sys_rwlock(rwlock, RWLOCK_RDLOCK);
+	return __rwlock_lock(rwlock, RWLOCK_WRITER, 1, false);
 }
 
 int pthread_rwlock_tryrdlock(pthread_rwlock_t *rwlock)
 {
-	return __sys_rwlock(rwlock, RWLOCK_TRYRDLOCK);
+	return __rwlock_lock(rwlock, RWLOCK_WRITER, 1, true);
 }
 
 int pthread_rwlock_unlock(pthread_rwlock_t *rwlock)
 {
-	return __sys_rwlock(rwlock, RWLOCK_UNLOCK);
+	register uint_t val;
+	register uint_t new;
+
+	if(rwlock == NULL)
+		return EINVAL;
+
+	do
+	{
+		val = *(volatile pthread_rwlock_t*)rwlock;
+
+		if(val & RWLOCK_WRITER)
+			new = val & ~RWLOCK_WRITER;
+		else if(val & RWLOCK_READERS_MASK)
+			new = val - 1;
+		else
+			return EPERM;
+
+	}while(!(cpu_atomic_cas(rwlock, val, new)));
+
+	/* Both readers and writers may be blocked, let them race again */
+	if(rwlock_isFree(new) && (rwlock_waiters(new) != 0))
+		(void)__pthread_futex_wake((volatile uint_t*)rwlock, (uint_t)-1);
+
+	return 0;
 }
 
 int pthread_rwlock_destroy(pthread_rwlock_t *rwlock)
 {
-	return __sys_rwlock(rwlock, RWLOCK_DESTROY);
+	if(rwlock == NULL)
+		return EINVAL;
+
+	if(*(volatile pthread_rwlock_t*)rwlock != 0)
+		return EBUSY;
+
+	return 0;
 }
@@ -25,54 +25,103 @@
 #include <semaphore.h>
 #include <sys/syscall.h>
 #include <cpu-syscall.h>
+#include <pthread.h>
 
-typedef enum
-{
-	SEM_INIT,
-	SEM_GETVALUE,
-	SEM_WAIT,
-	SEM_TRYWAIT,
-	SEM_POST,
-	SEM_DESTROY
-} sem_operation_t;
-
-static int __sys_sem(sem_t *sem, int operation, int pshared, int *value)
-{
-	register int retval;
-  
-	retval = (int)cpu_syscall((void*)sem,(void*)operation,(void*)pshared,(void*)value,SYS_SEMAPHORE);
-	return retval;
-}
+/*
+ * A semaphore is a single user word: the low half holds the count and
+ * the high half the number of threads about to block in the kernel.
+ * The kernel is only entered to block, or by sem_post when a waiter
+ * has been registered.
+ */
+#define SEM_COUNT_MASK   0x0000FFFF
+#define SEM_WAITER_ONE   0x00010000
+
+#define sem_count(_v)    ((_v) & SEM_COUNT_MASK)
+#define sem_waiters(_v)  ((_v) >> 16)
 
 int sem_init(sem_t *sem, int pshared, unsigned int value)
 {
-	int v          = (int)value;
-	int *value_ptr = &v;
+	if((sem == NULL) || (value > SEM_VALUE_MAX))
+	{
+		errno = EINVAL;
+		return -1;
+	}
 
-	return __sys_sem(sem, SEM_INIT, pshared, value_ptr);
+	*sem = value;
+	return 0;
 }
 
 int sem_getvalue(sem_t *sem, int *value)
 {
-	return __sys_sem(sem, SEM_GETVALUE, 0, value);
+	*value = (int)sem_count(*(volatile sem_t*)sem);
+	return 0;
 }
 
-int sem_wait(sem_t *sem)
+int sem_trywait(sem_t *sem)
 {
-	return __sys_sem(sem, SEM_WAIT, 0, NULL);
+	register uint_t val;
+
+	while(sem_count(val = *(volatile sem_t*)sem) != 0)
+	{
+		if(cpu_atomic_cas(sem, val, val - 1))
+			return 0;
+	}
+
+	errno = EAGAIN;
+	return -1;
 }
 
-int sem_trywait(sem_t *sem)
+int sem_wait(sem_t *sem)
 {
-	return __sys_sem(sem, SEM_TRYWAIT, 0, NULL);
+	register uint_t val;
+
+	while(1)
+	{
+		val = *(volatile sem_t*)sem;
+
+		if(sem_count(val) != 0)
+		{
+			if(cpu_atomic_cas(sem, val, val - 1))
+				return 0;
+
+			continue;
+		}
+
+		if(!(cpu_atomic_cas(sem, val, val + SEM_WAITER_ONE)))
+			continue;
+
+		/* EAGAIN means a post has already changed the word */
+		(void)__pthread_futex_wait((volatile uint_t*)sem, val + SEM_WAITER_ONE);
+		(void)cpu_atomic_add(sem, -SEM_WAITER_ONE);
+	}
 }
 
 int sem_post(sem_t *sem)
 {
-	return __sys_sem(sem, SEM_POST, 0, NULL);
+	register uint_t val;
+
+	val = (uint_t)cpu_atomic_add(sem, 1);
+
+	if(sem_count(val) >= SEM_VALUE_MAX)
+	{
+		(void)cpu_atomic_add(sem, -1);
+		errno = EOVERFLOW;
+		return -1;
+	}
+
+	if(sem_waiters(val) != 0)
+		(void)__pthread_futex_wake((volatile uint_t*)sem, 1);
+
+	return 0;
 }
 
 int sem_destroy(sem_t *sem)
 {
-	return __sys_sem(sem, SEM_DESTROY, 0, NULL);
+	if(sem_waiters(*(volatile sem_t*)sem) != 0)
+	{
+		errno = EBUSY;
+		return -1;
+	}
+
+	return 0;
 }
@@ -6,7 +6,24 @@
 /* @(#) $Id$ */
 
 #define ZLIB_INTERNAL
-#include "zlib.h"
+#include "zutil.h"      /* for STDC and FAR definitions */
+
+/* Find a four-byte integer type for adler32_little(). */
+#ifndef NOBYFOUR
+#  ifdef STDC           /* need ANSI C limits.h to determine sizes */
+#    include <limits.h>
+#    define BYFOUR
+#    if (UINT_MAX == 0xffffffffUL)
+       typedef unsigned int u4;
+#    else
+#      if (ULONG_MAX == 0xffffffffUL)
+         typedef unsigned long u4;
+#      else
+#        undef BYFOUR     /* can't find a four-byte integer type! */
+#      endif
+#    endif
+#  endif /* STDC */
+#endif /* !NOBYFOUR */
 
 #define BASE 65521UL    /* largest prime smaller than 65536 */
 #define NMAX 5552
@@ -53,6 +70,86 @@
 #  define MOD4(a) a %= BASE
 #endif
 
+#ifdef BYFOUR
+/*
+  Word at a time, little-endian: the bytes 0 and 2 of each word are summed
+  in the two 16-bit lanes of lo, and the bytes 1 and 3 in those of hi, two
+  sums for the price of one add.  q sums lo and hi before each word, which
+  is what the bytes of the earlier words add to sum2.  The lanes are folded
+  into adler and sum2 every 16 words (64 bytes), before a lane of q can
+  overflow: 2 * 255 * (0 + 1 + ... + 15) < 65536.  WMAX is the largest
+  multiple of 64 not over NMAX.
+*/
+#  define WMAX 5504
+#  define LANES(x) (((x) & 0xffff) + ((x) >> 16))
+#  define DOW(i)  {w = buf4[i]; q += lo + hi; \
+                   lo += w & 0xff00ff; hi += (w >> 8) & 0xff00ff;}
+#  define DOW4(i) DOW(i); DOW(i+1); DOW(i+2); DOW(i+3);
+#  define DOW64 \
+    do { \
+        lo = hi = q = 0; \
+        DOW4(0); DOW4(4); DOW4(8); DOW4(12); \
+        buf4 += 16; \
+        sum2 += (adler << 6) + (LANES(q) << 2) + \
+                ((lo & 0xffff) << 2) + ((lo >> 16) << 1) + \
+                (hi & 0xffff) * 3 + (hi >> 16); \
+        adler += LANES(lo) + LANES(hi); \
+    } while (0)
+
+local uLong adler32_little OF((unsigned long, unsigned long,
+                               const Bytef *, uInt));
+
+/* ========================================================================= */
+local uLong adler32_little(adler, sum2, buf, len)
+    unsigned long adler;
+    unsigned long sum2;
+    const Bytef *buf;
+    uInt len;
+{
+    register u4 lo, hi, q, w;
+    register const u4 FAR *buf4;
+    unsigned n;
+
+    /* at most three bytes more than WMAX before the first modulo */
+    while (len && ((ptrdiff_t)buf & 3)) {
+        adler += *buf++;
+        sum2 += adler;
+        len--;
+    }
+
+    buf4 = (const u4 FAR *)(const void FAR *)buf;
+
+    /* do length WMAX blocks -- requires just one modulo operation */
+    while (len >= WMAX) {
+        len -= WMAX;
+        n = WMAX / 64;
+        do {
+            DOW64;
+        } while (--n);
+        MOD(adler);
+        MOD(sum2);
+    }
+
+    /* do remaining bytes (less than NMAX, still just one modulo) */
+    if (len) {
+        while (len >= 64) {
+            len -= 64;
+            DOW64;
+        }
+        buf = (const Bytef FAR *)buf4;
+        while (len--) {
+            adler += *buf++;
+            sum2 += adler;
+        }
+        MOD(adler);
+        MOD(sum2);
+    }
+
+    /* return recombined sums */
+    return adler | (sum2 << 16);
+}
+#endif /* BYFOUR */
+
 /* ========================================================================= */
 uLong ZEXPORT adler32(adler, buf, len)
     uLong adler;
@@ -93,6 +190,16 @@ uLong ZEXPORT adler32(adler, buf, len)
         return adler | (sum2 << 16);
     }
 
+#ifdef BYFOUR
+    {
+        u4 endian;
+
+        endian = 1;
+        if (*((unsigned char *)(&endian)))
+            return adler32_little(adler, sum2, buf, len);
+    }
+#endif /* BYFOUR */
+
     /* do length NMAX blocks -- requires just one modulo operation */
     while (len >= NMAX) {
         len -= NMAX;
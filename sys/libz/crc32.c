@@ -59,7 +59,7 @@
                         const unsigned char FAR *, unsigned));
    local unsigned long crc32_big OF((unsigned long,
                         const unsigned char FAR *, unsigned));
-#  define TBLS 8
+#  define TBLS 16
 #else
 #  define TBLS 1
 #endif /* BYFOUR */
@@ -101,7 +101,10 @@ local void make_crc_table OF((void));
   all the information needed to generate CRCs on data a byte at a time for all
   combinations of CRC register values and incoming bytes.  The remaining tables
   allow for word-at-a-time CRC calculation for both big-endian and little-
-  endian machines, where a word is four bytes.
+  endian machines, where a word is four bytes: tables 0..3 and 4..7 hold the
+  CRC of each byte followed by zero to three zeros, little and big-endian,
+  and tables 8..11 and 12..15 the same followed by four to seven zeros, so
+  that two words can be folded at once ("slicing-by-8").
 */
 local void make_crc_table()
 {
@@ -132,15 +135,15 @@ local void make_crc_table()
         }
 
 #ifdef BYFOUR
-        /* generate crc for each value followed by one, two, and three zeros,
+        /* generate crc for each value followed by one to seven zeros,
            and then the byte reversal of those as well as the first table */
         for (n = 0; n < 256; n++) {
             c = crc_table[0][n];
             crc_table[4][n] = REV(c);
-            for (k = 1; k < 4; k++) {
+            for (k = 1; k < 8; k++) {
                 c = crc_table[0][c & 0xff] ^ (c >> 8);
-                crc_table[k][n] = c;
-                crc_table[k + 4][n] = REV(c);
+                crc_table[k < 4 ? k : k + 4][n] = c;
+                crc_table[k < 4 ? k + 4 : k + 8][n] = REV(c);
             }
         }
 #endif /* BYFOUR */
@@ -167,7 +170,7 @@ local void make_crc_table()
         write_table(out, crc_table[0]);
 #  ifdef BYFOUR
         fprintf(out, "#ifdef BYFOUR\n");
-        for (k = 1; k < 8; k++) {
+        for (k = 1; k < TBLS; k++) {
             fprintf(out, "  },\n  {\n");
             write_table(out, crc_table[k]);
         }
@@ -256,7 +259,12 @@ unsigned long ZEXPORT crc32(crc, buf, len)
 #define DOLIT4 c ^= *buf4++; \
         c = crc_table[3][c & 0xff] ^ crc_table[2][(c >> 8) & 0xff] ^ \
             crc_table[1][(c >> 16) & 0xff] ^ crc_table[0][c >> 24]
-#define DOLIT32 DOLIT4; DOLIT4; DOLIT4; DOLIT4; DOLIT4; DOLIT4; DOLIT4; DOLIT4
+#define DOLIT8 c ^= *buf4++; n = *buf4++; \
+        c = crc_table[11][c & 0xff] ^ crc_table[10][(c >> 8) & 0xff] ^ \
+            crc_table[9][(c >> 16) & 0xff] ^ crc_table[8][c >> 24] ^ \
+            crc_table[3][n & 0xff] ^ crc_table[2][(n >> 8) & 0xff] ^ \
+            crc_table[1][(n >> 16) & 0xff] ^ crc_table[0][n >> 24]
+#define DOLIT32 DOLIT8; DOLIT8; DOLIT8; DOLIT8
 
 /* ========================================================================= */
 local unsigned long crc32_little(crc, buf, len)
@@ -265,6 +273,7 @@ local unsigned long crc32_little(crc, buf, len)
     unsigned len;
 {
     register u4 c;
+    register u4 n;
     register const u4 FAR *buf4;
 
     c = (u4)crc;
@@ -296,7 +305,12 @@ local unsigned long crc32_little(crc, buf, len)
 #define DOBIG4 c ^= *++buf4; \
         c = crc_table[4][c & 0xff] ^ crc_table[5][(c >> 8) & 0xff] ^ \
             crc_table[6][(c >> 16) & 0xff] ^ crc_table[7][c >> 24]
-#define DOBIG32 DOBIG4; DOBIG4; DOBIG4; DOBIG4; DOBIG4; DOBIG4; DOBIG4; DOBIG4
+#define DOBIG8 c ^= *++buf4; n = *++buf4; \
+        c = crc_table[12][c & 0xff] ^ crc_table[13][(c >> 8) & 0xff] ^ \
+            crc_table[14][(c >> 16) & 0xff] ^ crc_table[15][c >> 24] ^ \
+            crc_table[4][n & 0xff] ^ crc_table[5][(n >> 8) & 0xff] ^ \
+            crc_table[6][(n >> 16) & 0xff] ^ crc_table[7][n >> 24]
+#define DOBIG32 DOBIG8; DOBIG8; DOBIG8; DOBIG8
 
 /* ========================================================================= */
 local unsigned long crc32_big(crc, buf, len)
@@ -305,6 +319,7 @@ local unsigned long crc32_big(crc, buf, len)
     unsigned len;
 {
     register u4 c;
+    register u4 n;
     register const u4 FAR *buf4;
 
     c = REV((u4)crc);
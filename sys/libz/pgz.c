@@ -0,0 +1,790 @@
+/* pgz.c -- parallel block-wise gzip of file descriptors
+ * For conditions of distribution and use, see copyright notice in zlib.h
+ *
+ * The input is cut in blocks of equal size, deflated by a pool of threads
+ * into raw deflate data ending on a byte boundary (Z_SYNC_FLUSH, the last
+ * block with Z_FINISH), and written in order as one gzip member.  Each
+ * thread computes the CRC of its blocks, combined with crc32_combine().
+ * Unless PGZ_INDEPENDENT is given, a block is primed with the last 32K of
+ * the previous one, so that the ratio stays close to a serial deflate.
+ *
+ * When the input size is known, the gzip header carries a "PZ" extra
+ * subfield holding the block size and, filled in once the stream is
+ * written, the compressed size of every block.  Independent blocks listed
+ * there are inflated in parallel; any other stream is inflated serially.
+ */
+
+/* @(#) $Id$ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <pthread.h>
+
+#include "zutil.h"
+
+#define PGZ_DICT      32768  /* deflate window primed from the previous block */
+#define PGZ_VERSION   1      /* version of the PZ subfield */
+#define PGZ_XHEAD     12     /* PZ data before the compressed block sizes */
+#define PGZ_INDEX_MAX 16000  /* blocks a PZ subfield can describe */
+#define PGZ_BUFSIZE   16384  /* serial inflate buffers */
+
+/* gzip flag byte */
+#define HEAD_CRC     0x02 /* bit 1 set: header CRC present */
+#define EXTRA_FIELD  0x04 /* bit 2 set: extra field present */
+#define ORIG_NAME    0x08 /* bit 3 set: original file name present */
+#define COMMENT      0x10 /* bit 4 set: file comment present */
+#define RESERVED     0xE0 /* bits 5..7: reserved */
+
+typedef struct pgz_block {
+    Bytef *in;        /* deflate: data, inflate: compressed block */
+    uLong in_len;
+    Bytef *out;       /* deflate: compressed block, inflate: data */
+    uLong out_len;
+    uLong out_size;
+    uLong crc;        /* of the uncompressed data */
+    int   last;       /* last block of the stream */
+    int   err;
+} pgz_block;
+
+typedef struct pgz_state pgz_state;
+
+typedef struct pgz_worker {
+    pgz_state *s;
+    z_stream  strm;
+    pthread_t thread;
+} pgz_worker;
+
+struct pgz_state {
+    int        deflate;   /* deflating or inflating blocks */
+    int        flags;
+    int        nthreads;  /* running threads, the calling one included */
+    int        nstreams;  /* initialized worker streams */
+    int        nalloc;    /* allocated blocks */
+    uLong      block;     /* uncompressed block size */
+    pgz_block  *blocks;   /* the blocks of a round, one per thread */
+    pgz_worker *workers;  /* worker 0 is the calling thread */
+    Bytef      *dict;     /* end of the block before the round */
+    uInt       dict_len;
+    int        count;     /* blocks in the current round */
+    int        next;      /* next block to hand out */
+    int        pending;   /* threads still working on the round */
+    int        round;
+    int        quit;
+    pthread_mutex_t lock;
+    pthread_cond_t  start;
+    pthread_cond_t  done;
+};
+
+local void pgz_deflate_block OF((pgz_state *s, z_streamp strm, pgz_block *b,
+                                 int i));
+local void pgz_inflate_block OF((pgz_state *s, z_streamp strm, pgz_block *b));
+local void pgz_work     OF((pgz_worker *w));
+local void *pgz_thread  OF((void *arg));
+local void pgz_run      OF((pgz_state *s, int count));
+local int  pgz_open     OF((pgz_state *s, int deflate, int level,
+                            int nthreads, uLong block, uLong in_size,
+                            uLong out_size));
+local void pgz_close    OF((pgz_state *s));
+local int  pgz_read     OF((int fd, Bytef *buf, uLong len, uLong *got));
+local int  pgz_write    OF((int fd, const Bytef *buf, uLong len));
+local void putLong      OF((Bytef *buf, uLong x));
+local uLong getLong     OF((const Bytef *buf));
+local int  pgz_skip_string OF((int fd));
+local int  pgz_inflate_serial OF((int out, int in));
+
+/* ===========================================================================
+   Deflates block i of the round.  Its data must end on a byte boundary for
+   the blocks to be concatenated: a sync flush ends it with an empty stored
+   block, unless it is the last one.
+*/
+local void pgz_deflate_block(s, strm, b, i)
+    pgz_state *s;
+    z_streamp strm;
+    pgz_block *b;
+    int i;
+{
+    pgz_block *prev;
+    int flush, err;
+
+    deflateReset(strm);
+
+    if (!(s->flags & PGZ_INDEPENDENT)) {
+        if (i > 0) {
+            prev = &s->blocks[i - 1];
+            if (prev->in_len > PGZ_DICT)
+                deflateSetDictionary(strm, prev->in + prev->in_len - PGZ_DICT,
+                                     PGZ_DICT);
+            else if (prev->in_len)
+                deflateSetDictionary(strm, prev->in, (uInt)prev->in_len);
+        } else if (s->dict_len) {
+            deflateSetDictionary(strm, s->dict, s->dict_len);
+        }
+    }
+
+    strm->next_in = b->in;
+    strm->avail_in = (uInt)b->in_len;
+    strm->next_out = b->out;
+    strm->avail_out = (uInt)b->out_size;
+
+    flush = b->last ? Z_FINISH : Z_SYNC_FLUSH;
+    err = deflate(strm, flush);
+
+    if (b->last)
+        b->err = err == Z_STREAM_END ? Z_OK : Z_BUF_ERROR;
+    else
+        b->err = (err == Z_OK && strm->avail_out != 0) ? Z_OK : Z_BUF_ERROR;
+
+    b->out_len = b->out_size - strm->avail_out;
+    b->crc = crc32(crc32(0L, Z_NULL, 0), b->in, (uInt)b->in_len);
+}
+
+/* ===========================================================================
+   Inflates an independent block: all blocks but the last one must produce
+   exactly a block of data.
+*/
+local void pgz_inflate_block(s, strm, b)
+    pgz_state *s;
+    z_streamp strm;
+    pgz_block *b;
+{
+    int err;
+
+    inflateReset(strm);
+
+    strm->next_in = b->in;
+    strm->avail_in = (uInt)b->in_len;
+    strm->next_out = b->out;
+    strm->avail_out = (uInt)b->out_size;   /* one byte to spare */
+
+    err = inflate(strm, Z_SYNC_FLUSH);
+
+    b->out_len = b->out_size - strm->avail_out;
+
+    if (b->last)
+        b->err = (err == Z_STREAM_END && strm->avail_in == 0) ?
+                 Z_OK : Z_DATA_ERROR;
+    else
+        b->err = (err == Z_OK && strm->avail_in == 0 &&
+                  b->out_len == s->block) ? Z_OK : Z_DATA_ERROR;
+
+    b->crc = crc32(crc32(0L, Z_NULL, 0), b->out, (uInt)b->out_len);
+}
+
+/* ===========================================================================
+   Takes blocks of the current round until there are none left.
+*/
+local void pgz_work(w)
+    pgz_worker *w;
+{
+    pgz_state *s = w->s;
+    int i;
+
+    for (;;) {
+        pthread_mutex_lock(&s->lock);
+        i = s->next < s->count ? s->next++ : -1;
+        pthread_mutex_unlock(&s->lock);
+
+        if (i < 0)
+            break;
+
+        if (s->deflate)
+            pgz_deflate_block(s, &w->strm, &s->blocks[i], i);
+        else
+            pgz_inflate_block(s, &w->strm, &s->blocks[i]);
+    }
+}
+
+local void *pgz_thread(arg)
+    void *arg;
+{
+    pgz_worker *w = arg;
+    pgz_state *s = w->s;
+    int round = 0;
+
+    pthread_mutex_lock(&s->lock);
+
+    for (;;) {
+        while (!s->quit && s->round == round)
+            pthread_cond_wait(&s->start, &s->lock);
+
+        if (s->quit)
+            break;
+
+        round = s->round;
+        pthread_mutex_unlock(&s->lock);
+
+        pgz_work(w);
+
+        pthread_mutex_lock(&s->lock);
+        if (--s->pending == 0)
+            pthread_cond_signal(&s->done);
+    }
+
+    pthread_mutex_unlock(&s->lock);
+    return NULL;
+}
+
+/* ===========================================================================
+   Processes the count first blocks on all the threads, the calling one
+   included, and waits for them.
+*/
+local void pgz_run(s, count)
+    pgz_state *s;
+    int count;
+{
+    pthread_mutex_lock(&s->lock);
+    s->count = count;
+    s->next = 0;
+    s->pending = s->nthreads - 1;
+    s->round++;
+    pthread_cond_broadcast(&s->start);
+    pthread_mutex_unlock(&s->lock);
+
+    pgz_work(&s->workers[0]);
+
+    pthread_mutex_lock(&s->lock);
+    while (s->pending != 0)
+        pthread_cond_wait(&s->done, &s->lock);
+    pthread_mutex_unlock(&s->lock);
+}
+
+/* ===========================================================================
+   Allocates the blocks and the streams of nthreads threads, and starts
+   them.  A thread that cannot be created just leaves the pool smaller.
+*/
+local int pgz_open(s, deflate, level, nthreads, block, in_size, out_size)
+    pgz_state *s;
+    int deflate;
+    int level;
+    int nthreads;
+    uLong block;
+    uLong in_size;
+    uLong out_size;
+{
+    pthread_attr_t attr;
+    z_streamp strm;
+    int cpu_nr, i, err;
+
+    zmemzero(s, sizeof(pgz_state));
+
+    s->deflate = deflate;
+    s->block = block;
+    if (nthreads < 1)
+        nthreads = 1;
+
+    err = Z_MEM_ERROR;
+    s->blocks = calloc(nthreads, sizeof(pgz_block));
+    s->workers = calloc(nthreads, sizeof(pgz_worker));
+    s->dict = malloc(PGZ_DICT);
+    if (s->blocks == Z_NULL || s->workers == Z_NULL || s->dict == Z_NULL)
+        goto fail;
+
+    for (s->nalloc = 0; s->nalloc < nthreads; s->nalloc++) {
+        i = s->nalloc;
+        s->blocks[i].in = malloc(in_size);
+        s->blocks[i].out = malloc(out_size);
+        s->blocks[i].out_size = out_size;
+        if (s->blocks[i].in == Z_NULL || s->blocks[i].out == Z_NULL) {
+            s->nalloc++;
+            goto fail;
+        }
+    }
+
+    /* a stream is only ever used by its own thread */
+    for (s->nstreams = 0; s->nstreams < nthreads; s->nstreams++) {
+        s->workers[s->nstreams].s = s;
+        strm = &s->workers[s->nstreams].strm;
+        if (deflate)
+            err = deflateInit2(strm, level, Z_DEFLATED, -MAX_WBITS,
+                               DEF_MEM_LEVEL, Z_DEFAULT_STRATEGY);
+        else
+            err = inflateInit2(strm, -MAX_WBITS);
+        if (err != Z_OK)
+            goto fail;
+    }
+
+    pthread_mutex_init(&s->lock, NULL);
+    pthread_cond_init(&s->start, NULL);
+    pthread_cond_init(&s->done, NULL);
+
+    cpu_nr = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpu_nr <= 0)
+        cpu_nr = 1;
+
+    for (s->nthreads = 1; s->nthreads < nthreads; s->nthreads++) {
+        i = s->nthreads;
+        pthread_attr_init(&attr);
+        pthread_attr_setcpuid_np(&attr, i % cpu_nr, NULL);
+
+        if (pthread_create(&s->workers[i].thread, &attr, pgz_thread,
+                           &s->workers[i]))
+            break;
+    }
+
+    return Z_OK;
+
+fail:
+    pgz_close(s);
+    return err;
+}
+
+/* ===========================================================================
+   Stops the threads and frees everything pgz_open() allocated.
+*/
+local void pgz_close(s)
+    pgz_state *s;
+{
+    int i;
+
+    if (s->nthreads > 0) {
+        pthread_mutex_lock(&s->lock);
+        s->quit = 1;
+        pthread_cond_broadcast(&s->start);
+        pthread_mutex_unlock(&s->lock);
+
+        for (i = 1; i < s->nthreads; i++)
+            pthread_join(s->workers[i].thread, NULL);
+
+        pthread_cond_destroy(&s->start);
+        pthread_cond_destroy(&s->done);
+        pthread_mutex_destroy(&s->lock);
+    }
+
+    for (i = 0; i < s->nstreams; i++) {
+        if (s->deflate)
+            deflateEnd(&s->workers[i].strm);
+        else
+            inflateEnd(&s->workers[i].strm);
+    }
+
+    for (i = 0; i < s->nalloc; i++) {
+        free(s->blocks[i].in);
+        free(s->blocks[i].out);
+    }
+
+    free(s->blocks);
+    free(s->workers);
+    free(s->dict);
+}
+
+/* ===========================================================================
+   Reads up to len bytes, fewer only at the end of the file.
+*/
+local int pgz_read(fd, buf, len, got)
+    int fd;
+    Bytef *buf;
+    uLong len;
+    uLong *got;
+{
+    ssize_t ret;
+
+    *got = 0;
+    while (*got < len) {
+        ret = read(fd, buf + *got, len - *got);
+        if (ret < 0)
+            return Z_ERRNO;
+        if (ret == 0)
+            break;
+        *got += ret;
+    }
+    return Z_OK;
+}
+
+local int pgz_write(fd, buf, len)
+    int fd;
+    const Bytef *buf;
+    uLong len;
+{
+    ssize_t ret;
+
+    while (len) {
+        ret = write(fd, buf, len);
+        if (ret <= 0)
+            return Z_ERRNO;
+        buf += ret;
+        len -= ret;
+    }
+    return Z_OK;
+}
+
+/* ===========================================================================
+   Little endian 32 bits, as in the gzip header and trailer.
+*/
+local void putLong(buf, x)
+    Bytef *buf;
+    uLong x;
+{
+    buf[0] = (Byte)(x & 0xff);
+    buf[1] = (Byte)((x >> 8) & 0xff);
+    buf[2] = (Byte)((x >> 16) & 0xff);
+    buf[3] = (Byte)((x >> 24) & 0xff);
+}
+
+local uLong getLong(buf)
+    const Bytef *buf;
+{
+    return (uLong)buf[0] | ((uLong)buf[1] << 8) |
+           ((uLong)buf[2] << 16) | ((uLong)buf[3] << 24);
+}
+
+/* ===========================================================================
+   Writes the gzip header, the PZ subfield, the blocks and the trailer.  The
+   compressed sizes are filled in the header at the end when out can seek.
+*/
+int ZEXPORT pgz_deflate(out, in, level, nthreads, block, flags)
+    int out;
+    int in;
+    int level;
+    int nthreads;
+    uLong block;
+    int flags;
+{
+    pgz_state s;
+    pgz_block *b;
+    struct stat st;
+    Byte head[10 + 2 + 4 + PGZ_XHEAD];
+    Byte tail[8];
+    Bytef *index;
+    z_off_t start;
+    uLong nblocks, n, crc, total;
+    int count, last, err, i;
+
+    if (level == Z_DEFAULT_COMPRESSION)
+        level = 6;
+    if (level < 0 || level > 9)
+        return Z_STREAM_ERROR;
+    if (block == 0)
+        block = PGZ_BLOCK;
+
+    /* the number of blocks must be known to reserve the index */
+    nblocks = 0;
+    index = Z_NULL;
+    if (fstat(in, &st) == 0 && S_ISREG(st.st_mode)) {
+        if (st.st_size / block >= PGZ_INDEX_MAX - 1)
+            block = (uLong)(st.st_size / (PGZ_INDEX_MAX - 1)) + 1;
+        /* the last block is short, or empty */
+        nblocks = (uLong)(st.st_size / block) + 1;
+        index = calloc(nblocks, 4);
+        if (index == Z_NULL)
+            nblocks = 0;
+    }
+
+    err = pgz_open(&s, 1, level, nthreads, block, block,
+                   deflateBound(Z_NULL, block) + 16);
+    if (err != Z_OK) {
+        free(index);
+        return err;
+    }
+    s.flags = flags;
+
+    head[0] = 0x1f;
+    head[1] = 0x8b;
+    head[2] = Z_DEFLATED;
+    head[3] = nblocks ? EXTRA_FIELD : 0;
+    putLong(head + 4, 0L);
+    head[8] = 0;
+    head[9] = OS_CODE;
+    n = 10;
+    if (nblocks) {
+        head[10] = (Byte)((4 + PGZ_XHEAD + 4 * nblocks) & 0xff);
+        head[11] = (Byte)((4 + PGZ_XHEAD + 4 * nblocks) >> 8);
+        head[12] = 'P';
+        head[13] = 'Z';
+        head[14] = (Byte)((PGZ_XHEAD + 4 * nblocks) & 0xff);
+        head[15] = (Byte)((PGZ_XHEAD + 4 * nblocks) >> 8);
+        head[16] = PGZ_VERSION;
+        head[17] = (Byte)(flags & PGZ_INDEPENDENT);
+        head[18] = 0;
+        head[19] = 0;
+        putLong(head + 20, block);
+        putLong(head + 24, nblocks);
+        n = sizeof(head);
+    }
+
+    start = lseek(out, 0, SEEK_CUR);
+
+    err = pgz_write(out, head, n);
+    if (err == Z_OK && nblocks)
+        err = pgz_write(out, index, 4 * nblocks);
+
+    crc = crc32(0L, Z_NULL, 0);
+    total = 0;
+    n = 0;
+    last = 0;
+
+    while (err == Z_OK && !last) {
+        for (count = 0; count < s.nthreads && !last; count++) {
+            b = &s.blocks[count];
+            err = pgz_read(in, b->in, block, &b->in_len);
+            if (err != Z_OK)
+                break;
+            b->last = last = b->in_len < block;
+        }
+        if (err != Z_OK)
+            break;
+
+        pgz_run(&s, count);
+
+        for (i = 0; i < count && err == Z_OK; i++) {
+            b = &s.blocks[i];
+            err = b->err;
+            if (err == Z_OK)
+                err = pgz_write(out, b->out, b->out_len);
+            crc = crc32_combine(crc, b->crc, b->in_len);
+            total += b->in_len;
+            if (n < nblocks)
+                putLong(index + 4 * n, b->out_len);
+            n++;
+        }
+
+        /* prime the first block of the next round */
+        b = &s.blocks[count - 1];
+        s.dict_len = b->in_len > PGZ_DICT ? PGZ_DICT : (uInt)b->in_len;
+        zmemcpy(s.dict, b->in + b->in_len - s.dict_len, s.dict_len);
+    }
+
+    if (err == Z_OK) {
+        putLong(tail, crc);
+        putLong(tail + 4, total);
+        err = pgz_write(out, tail, 8);
+    }
+
+    /* the input did not change size: complete the index */
+    if (err == Z_OK && n == nblocks && nblocks && start != -1 &&
+        lseek(out, start + sizeof(head), SEEK_SET) != -1) {
+        err = pgz_write(out, index, 4 * nblocks);
+        lseek(out, 0, SEEK_END);
+    }
+
+    pgz_close(&s);
+    free(index);
+    return err;
+}
+
+/* ===========================================================================
+   Skips a zero terminated string of the gzip header.
+*/
+local int pgz_skip_string(fd)
+    int fd;
+{
+    Byte c;
+    ssize_t ret;
+
+    do {
+        ret = read(fd, &c, 1);
+        if (ret < 0)
+            return Z_ERRNO;
+        if (ret == 0)
+            return Z_DATA_ERROR;
+    } while (c != 0);
+    return Z_OK;
+}
+
+/* ===========================================================================
+   Inflates the raw deflate data following the header on the calling thread,
+   then checks the trailer.
+*/
+local int pgz_inflate_serial(out, in)
+    int out;
+    int in;
+{
+    z_stream strm;
+    Bytef *ibuf, *obuf;
+    Byte tail[8];
+    uLong crc, total, got, len;
+    int err;
+
+    ibuf = malloc(PGZ_BUFSIZE);
+    obuf = malloc(PGZ_BUFSIZE);
+    zmemzero(&strm, sizeof(strm));
+    if (ibuf == Z_NULL || obuf == Z_NULL ||
+        inflateInit2(&strm, -MAX_WBITS) != Z_OK) {
+        free(ibuf);
+        free(obuf);
+        return Z_MEM_ERROR;
+    }
+
+    crc = crc32(0L, Z_NULL, 0);
+    total = 0;
+    err = Z_OK;
+
+    do {
+        if (strm.avail_in == 0) {
+            err = pgz_read(in, ibuf, PGZ_BUFSIZE, &got);
+            if (err != Z_OK)
+                break;
+            if (got == 0) {
+                err = Z_DATA_ERROR;
+                break;
+            }
+            strm.next_in = ibuf;
+            strm.avail_in = (uInt)got;
+        }
+
+        strm.next_out = obuf;
+        strm.avail_out = PGZ_BUFSIZE;
+        err = inflate(&strm, Z_NO_FLUSH);
+        if (err != Z_OK && err != Z_STREAM_END) {
+            if (err != Z_MEM_ERROR)
+                err = Z_DATA_ERROR;
+            break;
+        }
+
+        len = PGZ_BUFSIZE - strm.avail_out;
+        crc = crc32(crc, obuf, (uInt)len);
+        total += len;
+        if (pgz_write(out, obuf, len) != Z_OK) {
+            err = Z_ERRNO;
+            break;
+        }
+    } while (err != Z_STREAM_END);
+
+    if (err == Z_STREAM_END) {
+        /* the trailer may start in the input buffer */
+        len = strm.avail_in > 8 ? 8 : strm.avail_in;
+        zmemcpy(tail, strm.next_in, len);
+        err = pgz_read(in, tail + len, 8 - len, &got);
+        if (err == Z_OK && (len + got != 8 || getLong(tail) != crc ||
+                            getLong(tail + 4) != (total & 0xffffffffUL)))
+            err = Z_DATA_ERROR;
+    }
+
+    inflateEnd(&strm);
+    free(ibuf);
+    free(obuf);
+    return err;
+}
+
+/* ===========================================================================
+   Reads the gzip header and looks for a usable PZ index: independent blocks
+   whose compressed sizes were all filled in.
+*/
+int ZEXPORT pgz_inflate(out, in, nthreads)
+    int out;
+    int in;
+    int nthreads;
+{
+    pgz_state s;
+    pgz_block *b;
+    Byte head[10];
+    Byte tail[8];
+    Bytef *extra, *index, *p;
+    uLong xlen, len, block, nblocks, max, crc, total, got, n;
+    int flags, count, err, i;
+
+    err = pgz_read(in, head, 10, &got);
+    if (err != Z_OK)
+        return err;
+    if (got != 10 || head[0] != 0x1f || head[1] != 0x8b ||
+        head[2] != Z_DEFLATED || (head[3] & RESERVED))
+        return Z_DATA_ERROR;
+    flags = head[3];
+
+    extra = Z_NULL;
+    index = Z_NULL;
+    block = nblocks = 0;
+
+    if (flags & EXTRA_FIELD) {
+        err = pgz_read(in, head, 2, &got);
+        if (err == Z_OK && got != 2)
+            err = Z_DATA_ERROR;
+        xlen = head[0] | (head[1] << 8);
+        if (err == Z_OK && (extra = malloc(xlen + 1)) == Z_NULL)
+            err = Z_MEM_ERROR;
+        if (err == Z_OK)
+            err = pgz_read(in, extra, xlen, &got);
+        if (err == Z_OK && got != xlen)
+            err = Z_DATA_ERROR;
+        if (err != Z_OK) {
+            free(extra);
+            return err;
+        }
+
+        for (p = extra; p + 4 <= extra + xlen; p += 4 + len) {
+            len = p[2] | (p[3] << 8);
+            if (p + 4 + len > extra + xlen)
+                break;
+            if (p[0] != 'P' || p[1] != 'Z' || len < PGZ_XHEAD ||
+                p[4] != PGZ_VERSION || !(p[5] & PGZ_INDEPENDENT))
+                continue;
+            block = getLong(p + 8);
+            nblocks = getLong(p + 12);
+            if (block && len == PGZ_XHEAD + 4 * nblocks)
+                index = p + 4 + PGZ_XHEAD;
+            break;
+        }
+    }
+
+    if (err == Z_OK && (flags & ORIG_NAME))
+        err = pgz_skip_string(in);
+    if (err == Z_OK && (flags & COMMENT))
+        err = pgz_skip_string(in);
+    if (err == Z_OK && (flags & HEAD_CRC)) {
+        err = pgz_read(in, head, 2, &got);
+        if (err == Z_OK && got != 2)
+            err = Z_DATA_ERROR;
+    }
+
+    /* an index left empty means the output could not seek */
+    max = 0;
+    for (n = 0; index != Z_NULL && n < nblocks; n++) {
+        len = getLong(index + 4 * n);
+        if (len == 0)
+            index = Z_NULL;
+        else if (len > max)
+            max = len;
+    }
+
+    if (err != Z_OK || index == Z_NULL) {
+        free(extra);
+        return err != Z_OK ? err : pgz_inflate_serial(out, in);
+    }
+
+    err = pgz_open(&s, 0, 0, nthreads, block, max, block + 1);
+    if (err != Z_OK) {
+        free(extra);
+        return err;
+    }
+
+    crc = crc32(0L, Z_NULL, 0);
+    total = 0;
+
+    for (n = 0; err == Z_OK && n < nblocks; n += count) {
+        for (count = 0; count < s.nthreads && n + count < nblocks; count++) {
+            b = &s.blocks[count];
+            len = getLong(index + 4 * (n + count));
+            err = pgz_read(in, b->in, len, &b->in_len);
+            if (err == Z_OK && b->in_len != len)
+                err = Z_DATA_ERROR;
+            if (err != Z_OK)
+                break;
+            b->last = n + count == nblocks - 1;
+        }
+        if (err != Z_OK)
+            break;
+
+        pgz_run(&s, count);
+
+        for (i = 0; i < count && err == Z_OK; i++) {
+            b = &s.blocks[i];
+            err = b->err;
+            if (err == Z_OK)
+                err = pgz_write(out, b->out, b->out_len);
+            crc = crc32_combine(crc, b->crc, b->out_len);
+            total += b->out_len;
+        }
+    }
+
+    if (err == Z_OK) {
+        err = pgz_read(in, tail, 8, &got);
+        if (err == Z_OK && (got != 8 || getLong(tail) != crc ||
+                            getLong(tail + 4) != (total & 0xffffffffUL)))
+            err = Z_DATA_ERROR;
+    }
+
+    pgz_close(&s);
+    free(extra);
+    return err;
+}
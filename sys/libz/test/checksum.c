@@ -0,0 +1,255 @@
+/* checksum.c -- host-side checks and benchmark of crc32() and adler32()
+ * For conditions of distribution and use, see copyright notice in zlib.h
+ *
+ * The word-wise kernels of ../crc32.c and ../adler32.c are compared with
+ * byte-at-a-time reference implementations, the CRC one being built from
+ * the bitwise definition, on the standard vectors and on random buffers
+ * for every alignment, many lengths and seeds, and split runs.  With -b,
+ * the throughput of both is then reported.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "zlib.h"
+
+#define BUFF_SIZE       (256 * 1024)
+#define BENCH_ROUNDS    64
+#define RANDOM_RUNS     20000
+
+#define ADLER_BASE      65521UL
+#define ADLER_NMAX      5552
+
+static unsigned long ref_table[256];
+
+static const struct
+{
+  const char *str;
+  unsigned long crc;
+  unsigned long adler;
+} vectors[] = {
+  {"",                                             0x00000000UL, 0x00000001UL},
+  {"a",                                            0xe8b7be43UL, 0x00620062UL},
+  {"abc",                                          0x352441c2UL, 0x024d0127UL},
+  {"123456789",                                    0xcbf43926UL, 0x091e01deUL},
+  {"Wikipedia",                                    0xadaac02eUL, 0x11e60398UL},
+  {"message digest",                               0x20159d7fUL, 0x29750586UL},
+  {"The quick brown fox jumps over the lazy dog",  0x414fa339UL, 0x5bdc0fdaUL},
+};
+
+static unsigned long seed;
+
+static unsigned long rnd(void)
+{
+  seed = seed * 1103515245UL + 12345UL;
+  return (seed >> 16) & 0x7fff;
+}
+
+/* Byte-at-a-time CRC-32, table built from the reflected polynomial */
+static void ref_crc32_init(void)
+{
+  unsigned long c;
+  int n, k;
+
+  for(n = 0; n < 256; n++)
+  {
+    c = (unsigned long)n;
+
+    for(k = 0; k < 8; k++)
+      c = (c & 1) ? 0xedb88320UL ^ (c >> 1) : c >> 1;
+
+    ref_table[n] = c;
+  }
+}
+
+static unsigned long ref_crc32(unsigned long crc, const unsigned char *buf, size_t len)
+{
+  crc = crc ^ 0xffffffffUL;
+
+  while(len--)
+    crc = ref_table[(crc ^ *buf++) & 0xff] ^ (crc >> 8);
+
+  return crc ^ 0xffffffffUL;
+}
+
+/* Byte-at-a-time Adler-32, modulo deferred over ADLER_NMAX bytes */
+static unsigned long ref_adler32(unsigned long adler, const unsigned char *buf, size_t len)
+{
+  unsigned long s1, s2;
+  size_t n;
+
+  s1 = adler & 0xffff;
+  s2 = (adler >> 16) & 0xffff;
+
+  while(len)
+  {
+    n    = (len < ADLER_NMAX) ? len : ADLER_NMAX;
+    len -= n;
+
+    while(n--)
+    {
+      s1 += *buf++;
+      s2 += s1;
+    }
+
+    s1 %= ADLER_BASE;
+    s2 %= ADLER_BASE;
+  }
+
+  return (s2 << 16) | s1;
+}
+
+static int check_one(const unsigned char *buf, size_t len, unsigned long crc, unsigned long adler)
+{
+  unsigned long c, a, rc, ra;
+  size_t cut;
+
+  c  = crc32(crc, buf, len);
+  a  = adler32(adler, buf, len);
+  rc = ref_crc32(crc, buf, len);
+  ra = ref_adler32(adler, buf, len);
+
+  if((c != rc) || (a != ra))
+  {
+    fprintf(stderr, "address %% 8 = %u, length %u: crc32 %08lx (ref %08lx), adler32 %08lx (ref %08lx)\n",
+	    (unsigned)((size_t)buf & 7), (unsigned)len, c, rc, a, ra);
+    return -1;
+  }
+
+  /* Same result in two runs */
+  cut = (len) ? rnd() % len : 0;
+  c   = crc32(crc32(crc, buf, cut), buf + cut, len - cut);
+  a   = adler32(adler32(adler, buf, cut), buf + cut, len - cut);
+
+  if((c != rc) || (a != ra))
+  {
+    fprintf(stderr, "length %u cut at %u: crc32 %08lx (ref %08lx), adler32 %08lx (ref %08lx)\n",
+	    (unsigned)len, (unsigned)cut, c, rc, a, ra);
+    return -1;
+  }
+
+  return 0;
+}
+
+static int check(unsigned char *buf, size_t size)
+{
+  static const size_t edges[] = {5503, 5504, 5505, 5551, 5552, 5553, 11008, 65535, 65536, 65537};
+  unsigned long crc, adler;
+  size_t off, len, i;
+  int err;
+
+  for(i = 0; i < sizeof(vectors) / sizeof(vectors[0]); i++)
+  {
+    len   = strlen(vectors[i].str);
+    crc   = crc32(crc32(0L, Z_NULL, 0), (const Bytef*)vectors[i].str, len);
+    adler = adler32(adler32(0L, Z_NULL, 0), (const Bytef*)vectors[i].str, len);
+
+    if((crc != vectors[i].crc) || (adler != vectors[i].adler) ||
+       (ref_crc32(0, (const unsigned char*)vectors[i].str, len) != vectors[i].crc) ||
+       (ref_adler32(1, (const unsigned char*)vectors[i].str, len) != vectors[i].adler))
+    {
+      fprintf(stderr, "\"%s\": crc32 %08lx, adler32 %08lx, expected %08lx, %08lx\n",
+	      vectors[i].str, crc, adler, vectors[i].crc, vectors[i].adler);
+      return -1;
+    }
+  }
+
+  err = 0;
+
+  /* Every alignment, all short lengths and the block edges */
+  for(off = 0; (off < 8) && !err; off++)
+  {
+    for(len = 0; (len <= 512) && !err; len++)
+      err = check_one(buf + off, len, 0L, 1L);
+
+    for(i = 0; (i < sizeof(edges) / sizeof(edges[0])) && !err; i++)
+      err = check_one(buf + off, edges[i], 0L, 1L);
+  }
+
+  /* All 0xff bytes, the worst case of the deferred modulo */
+  memset(buf + size, 0xff, 65536 + 8);
+
+  for(off = 0; (off < 8) && !err; off++)
+    err = check_one(buf + size + off, 65536, 0L, 1L);
+
+  /* Random offsets, lengths and seeds */
+  for(i = 0; (i < RANDOM_RUNS) && !err; i++)
+  {
+    off   = rnd() % 64;
+    len   = (rnd() << 3 | rnd() % 8) % (size - off);
+    crc   = (rnd() << 16) | rnd();
+    adler = ((rnd() % ADLER_BASE) << 16) | (rnd() % ADLER_BASE);
+    err   = check_one(buf + off, len, crc, adler);
+  }
+
+  return err;
+}
+
+static double bench(unsigned long (*fn)(unsigned long, const unsigned char*, size_t),
+		    unsigned long init, const unsigned char *buf, size_t size, unsigned long *sum)
+{
+  clock_t start;
+  double secs;
+  int i;
+
+  *sum  = init;
+  start = clock();
+
+  for(i = 0; i < BENCH_ROUNDS; i++)
+    *sum = fn(*sum, buf, size);
+
+  secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+  return (secs > 0) ? ((double)size * BENCH_ROUNDS) / (secs * 1024 * 1024) : 0;
+}
+
+static unsigned long lib_crc32(unsigned long crc, const unsigned char *buf, size_t len)
+{
+  return crc32(crc, buf, len);
+}
+
+static unsigned long lib_adler32(unsigned long adler, const unsigned char *buf, size_t len)
+{
+  return adler32(adler, buf, len);
+}
+
+int main(int argc, char **argv)
+{
+  unsigned char *buf;
+  unsigned long sum, ref;
+  double speed, rspeed;
+  size_t i;
+
+  ref_crc32_init();
+
+  /* Room for the all 0xff buffer after the random one */
+  if((buf = malloc(BUFF_SIZE + 65536 + 8)) == NULL)
+  {
+    fprintf(stderr, "cannot allocate the buffer\n");
+    return EXIT_FAILURE;
+  }
+
+  for(seed = 1, i = 0; i < BUFF_SIZE; i++)
+    buf[i] = rnd() & 0xff;
+
+  if(check(buf, BUFF_SIZE))
+    return EXIT_FAILURE;
+
+  printf("crc32 and adler32 match the reference outputs\n");
+
+  if((argc > 1) && !strcmp(argv[1], "-b"))
+  {
+    speed  = bench(lib_crc32, 0L, buf, BUFF_SIZE, &sum);
+    rspeed = bench(ref_crc32, 0L, buf, BUFF_SIZE, &ref);
+    printf("crc32:   %8.1f MB/s, reference %8.1f MB/s, x%.2f%s\n",
+	   speed, rspeed, (rspeed > 0) ? speed / rspeed : 0, (sum != ref) ? " MISMATCH" : "");
+
+    speed  = bench(lib_adler32, 1L, buf, BUFF_SIZE, &sum);
+    rspeed = bench(ref_adler32, 1L, buf, BUFF_SIZE, &ref);
+    printf("adler32: %8.1f MB/s, reference %8.1f MB/s, x%.2f%s\n",
+	   speed, rspeed, (rspeed > 0) ? speed / rspeed : 0, (sum != ref) ? " MISMATCH" : "");
+  }
+
+  free(buf);
+  return EXIT_SUCCESS;
+}
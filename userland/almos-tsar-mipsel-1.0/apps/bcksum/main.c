@@ -0,0 +1,129 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <zlib.h>
+
+#define DEFAULT_KBYTES  256
+#define DEFAULT_ROUNDS  16
+#define CHECK_MAX       1024
+
+static const struct
+{
+  const char *str;
+  uLong crc;
+  uLong adler;
+} vectors[] = {
+  {"",                                             0x00000000UL, 0x00000001UL},
+  {"a",                                            0xe8b7be43UL, 0x00620062UL},
+  {"123456789",                                    0xcbf43926UL, 0x091e01deUL},
+  {"Wikipedia",                                    0xadaac02eUL, 0x11e60398UL},
+  {"The quick brown fox jumps over the lazy dog",  0x414fa339UL, 0x5bdc0fdaUL},
+};
+
+/* Checks the reference vectors, then the word-wise kernels against a byte
+ * at a time run, for every alignment and many lengths */
+static int check(unsigned char *buff, size_t size)
+{
+  uLong crc, crc1, adler, adler1;
+  size_t off, len, i;
+
+  for(i = 0; i < sizeof(vectors) / sizeof(vectors[0]); i++)
+  {
+    len   = strlen(vectors[i].str);
+    crc   = crc32(crc32(0L, Z_NULL, 0), (const Bytef*)vectors[i].str, len);
+    adler = adler32(adler32(0L, Z_NULL, 0), (const Bytef*)vectors[i].str, len);
+
+    if((crc != vectors[i].crc) || (adler != vectors[i].adler))
+    {
+      fprintf(stderr, "\"%s\": crc32 %08lx, adler32 %08lx, expected %08lx, %08lx\n",
+	      vectors[i].str, crc, adler, vectors[i].crc, vectors[i].adler);
+      return -1;
+    }
+  }
+
+  if(size > CHECK_MAX + 8)
+    size = CHECK_MAX + 8;
+
+  for(off = 0; off < 8; off++)
+  {
+    for(len = 0; len <= size - off; len += (len < 128) ? 1 : 61)
+    {
+      crc    = crc32(0L, buff + off, len);
+      adler  = adler32(1L, buff + off, len);
+      crc1   = 0L;
+      adler1 = 1L;
+
+      for(i = 0; i < len; i++)
+      {
+	crc1   = crc32(crc1, buff + off + i, 1);
+	adler1 = adler32(adler1, buff + off + i, 1);
+      }
+
+      if((crc != crc1) || (adler != adler1))
+      {
+	fprintf(stderr, "offset %u length %u: crc32 %08lx/%08lx, adler32 %08lx/%08lx\n",
+		off, len, crc, crc1, adler, adler1);
+	return -1;
+      }
+    }
+  }
+
+  return 0;
+}
+
+int main(int argc, char **argv)
+{
+  unsigned char *buff;
+  unsigned seed;
+  size_t size;
+  clock_t start;
+  clock_t ctime;
+  clock_t atime;
+  uLong crc;
+  uLong adler;
+  int rounds;
+  int i;
+
+  size   = ((argc > 1) ? atoi(argv[1]) : DEFAULT_KBYTES) * 1024;
+  rounds = (argc > 2) ? atoi(argv[2]) : DEFAULT_ROUNDS;
+
+  if((buff = malloc(size + 8)) == NULL)
+  {
+    fprintf(stderr, "cannot allocate %u bytes\n", size + 8);
+    return EXIT_FAILURE;
+  }
+
+  for(seed = 1, i = 0; i < (int)size + 8; i++)
+  {
+    seed    = seed * 1103515245 + 12345;
+    buff[i] = seed >> 16;
+  }
+
+  if(check(buff, size + 8))
+    return EXIT_FAILURE;
+
+  crc   = 0L;
+  start = clock();
+
+  for(i = 0; i < rounds; i++)
+    crc = crc32(crc, buff, size);
+
+  ctime = clock() - start;
+  adler = 1L;
+  start = clock();
+
+  for(i = 0; i < rounds; i++)
+    adler = adler32(adler, buff, size);
+
+  atime = clock() - start;
+
+  printf("Checksums of %u bytes x %d: crc32 %08lx %u bytes/Kticks, adler32 %08lx %u bytes/Kticks\n",
+	 size, rounds, crc,
+	 (ctime) ? (unsigned)(((unsigned long long)size * rounds * 1000) / ctime) : 0,
+	 adler,
+	 (atime) ? (unsigned)(((unsigned long long)size * rounds * 1000) / atime) : 0);
+
+  free(buff);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,161 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <zlib.h>
+
+#define DEFAULT_MBYTES  4
+#define DATA_FILE       "BGZ.DAT"
+#define GZ_FILE         "BGZ.GZ"
+#define OUT_FILE        "BGZ.OUT"
+
+static char buff[4096];
+
+/* Writes total bytes of compressible text, words from a small vocabulary */
+static int make_data(size_t total)
+{
+  static const char *words[] = {"thread", "cluster", "page", "block", "deflate",
+				"inflate", "kernel", "mapper", "cache", "vfs "};
+  unsigned seed;
+  size_t done;
+  size_t len;
+  size_t n;
+  int fd;
+
+  if((fd = open(DATA_FILE, O_WRONLY | O_CREAT | O_TRUNC, 420)) == -1)
+  {
+    fprintf(stderr, "cannot create %s [%d]\n", DATA_FILE, errno);
+    return -1;
+  }
+
+  seed = 1;
+  done = 0;
+
+  while(done < total)
+  {
+    for(len = 0; len < sizeof(buff) - 16; len += n)
+    {
+      seed = seed * 1103515245 + 12345;
+      n = strlen(words[(seed >> 16) % 10]);
+      memcpy(buff + len, words[(seed >> 16) % 10], n);
+      buff[len + n++] = ((seed >> 8) & 0xF) ? ' ' : '\n';
+    }
+
+    if(len > total - done)
+      len = total - done;
+
+    if(write(fd, buff, len) != (ssize_t)len)
+    {
+      fprintf(stderr, "cannot write %s [%d]\n", DATA_FILE, errno);
+      close(fd);
+      return -1;
+    }
+
+    done += len;
+  }
+
+  close(fd);
+  return 0;
+}
+
+/* Deflates then inflates the data file with nthreads threads */
+static int run(size_t total, int nthreads, int flags)
+{
+  clock_t start;
+  clock_t dtime;
+  clock_t itime;
+  off_t gzsize;
+  int in;
+  int out;
+  int err;
+
+  in  = open(DATA_FILE, O_RDONLY, 0);
+  out = open(GZ_FILE, O_WRONLY | O_CREAT | O_TRUNC, 420);
+
+  if((in == -1) || (out == -1))
+  {
+    fprintf(stderr, "cannot open %s or %s [%d]\n", DATA_FILE, GZ_FILE, errno);
+    return EXIT_FAILURE;
+  }
+
+  start = clock();
+  err   = pgz_deflate(out, in, Z_DEFAULT_COMPRESSION, nthreads, 0, flags);
+  dtime = clock() - start;
+
+  gzsize = lseek(out, 0, SEEK_END);
+  close(in);
+  close(out);
+
+  if(err != Z_OK)
+  {
+    fprintf(stderr, "pgz_deflate failed [%d]\n", err);
+    return EXIT_FAILURE;
+  }
+
+  in  = open(GZ_FILE, O_RDONLY, 0);
+  out = open(OUT_FILE, O_WRONLY | O_CREAT | O_TRUNC, 420);
+
+  if((in == -1) || (out == -1))
+  {
+    fprintf(stderr, "cannot open %s or %s [%d]\n", GZ_FILE, OUT_FILE, errno);
+    return EXIT_FAILURE;
+  }
+
+  start = clock();
+  err   = pgz_inflate(out, in, nthreads);
+  itime = clock() - start;
+
+  close(in);
+  close(out);
+
+  if(err != Z_OK)
+  {
+    fprintf(stderr, "pgz_inflate failed [%d]\n", err);
+    return EXIT_FAILURE;
+  }
+
+  printf("%s %2d threads: %u -> %u bytes, deflate %u bytes/Kticks, inflate %u bytes/Kticks\n",
+	 (flags & PGZ_INDEPENDENT) ? "independent" : "primed     ",
+	 nthreads, total, (unsigned)gzsize,
+	 (dtime) ? (unsigned)(((unsigned long long)total * 1000) / dtime) : 0,
+	 (itime) ? (unsigned)(((unsigned long long)total * 1000) / itime) : 0);
+
+  return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+  size_t total;
+  int cpu_nr;
+  int nthreads;
+  int err;
+
+  total  = ((argc > 1) ? atoi(argv[1]) : DEFAULT_MBYTES) * 1024 * 1024;
+  cpu_nr = sysconf(_SC_NPROCESSORS_ONLN);
+
+  if(make_data(total))
+    return EXIT_FAILURE;
+
+  printf("Parallel gzip throughput, %u bytes, up to %d threads\n", total, cpu_nr);
+
+  for(nthreads = 1; ; nthreads = (nthreads * 2 < cpu_nr) ? nthreads * 2 : cpu_nr)
+  {
+    if((err = run(total, nthreads, 0)))
+      return err;
+
+    /* only independent blocks are inflated in parallel */
+    if((err = run(total, nthreads, PGZ_INDEPENDENT)))
+      return err;
+
+    if(nthreads >= cpu_nr)
+      break;
+  }
+
+  unlink(DATA_FILE);
+  unlink(GZ_FILE);
+  unlink(OUT_FILE);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,268 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+
+#define DEFAULT_MBYTES  4
+#define DEFAULT_ROUNDS  1000
+#define MAX_CHUNK       (64*1024)
+#define BPIPE_PATH      "/bin/bpipe"
+
+static const size_t chunks[] = {64, 512, 4096, 16384, MAX_CHUNK};
+
+typedef struct bench_s
+{
+  int fd;
+  size_t chunk;
+  size_t total;
+}bench_t;
+
+static char wbuff[MAX_CHUNK] __attribute__((aligned(4096)));
+static char rbuff[MAX_CHUNK] __attribute__((aligned(4096)));
+
+static void* writer(void *arg)
+{
+  bench_t *bench;
+  size_t done;
+  ssize_t ret;
+
+  bench = arg;
+  done  = 0;
+
+  while(done < bench->total)
+  {
+    ret = write(bench->fd, wbuff, bench->chunk);
+
+    if(ret <= 0)
+    {
+      fprintf(stderr, "writer: write failed [%d]\n", errno);
+      return (void*)EXIT_FAILURE;
+    }
+
+    done += ret;
+  }
+
+  close(bench->fd);
+  return NULL;
+}
+
+static int run(size_t chunk, size_t total)
+{
+  pthread_t th;
+  bench_t bench;
+  clock_t start;
+  clock_t elapsed;
+  size_t done;
+  ssize_t ret;
+  int pipefd[2];
+  int err;
+
+  if(pipe(pipefd))
+  {
+    fprintf(stderr, "pipe failed [%d]\n", errno);
+    return EXIT_FAILURE;
+  }
+
+  bench.fd    = pipefd[1];
+  bench.chunk = chunk;
+  bench.total = total;
+  done        = 0;
+
+  start = clock();
+
+  if((err = pthread_create(&th, NULL, writer, &bench)))
+  {
+    fprintf(stderr, "pthread_create failed [%d]\n", err);
+    return EXIT_FAILURE;
+  }
+
+  while((ret = read(pipefd[0], rbuff, chunk)) > 0)
+    done += ret;
+
+  elapsed = clock() - start;
+
+  pthread_join(th, NULL);
+  close(pipefd[0]);
+
+  if(done != total)
+  {
+    fprintf(stderr, "chunk %u: read %u bytes, expected %u\n", chunk, done, total);
+    return EXIT_FAILURE;
+  }
+
+  printf("chunk %6u: %u bytes in %u ticks, %u bytes/Kticks\n",
+	 chunk, done, (unsigned)elapsed,
+	 (elapsed) ? (unsigned)(((unsigned long long)done * 1000) / elapsed) : 0);
+
+  return EXIT_SUCCESS;
+}
+
+/* Echoes each byte read on rfd to wfd until rfd is closed, the first
+ * message telling the peer the cluster the echo runs on */
+static int echo(int rfd, int wfd)
+{
+  cid_t cid;
+  char byte;
+
+  cid = getcid();
+
+  if(write(wfd, &cid, sizeof(cid)) != sizeof(cid))
+    return EXIT_FAILURE;
+
+  while(read(rfd, &byte, 1) == 1)
+  {
+    if(write(wfd, &byte, 1) != 1)
+      return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+static void* echo_thread(void *arg)
+{
+  int *fds = arg;
+
+  return (void*)echo(fds[0], fds[1]);
+}
+
+/* Round trips of one byte through a pair of pipes, the echo being a
+ * thread of this task or, when isRemote, a task forked then exec'ed on
+ * the last cpu, so that its requests go to the pipes' home cluster */
+static int latency(int rounds, int isRemote)
+{
+  char rfd_str[16];
+  char wfd_str[16];
+  char *args[5];
+  pthread_t th;
+  clock_t start;
+  clock_t elapsed;
+  cid_t cid;
+  char byte;
+  int req[2];
+  int rep[2];
+  int fds[2];
+  int pid;
+  int err;
+  int i;
+
+  if(pipe(req) || pipe(rep))
+  {
+    fprintf(stderr, "pipe failed [%d]\n", errno);
+    return EXIT_FAILURE;
+  }
+
+  fds[0] = req[0];
+  fds[1] = rep[1];
+
+  if(isRemote)
+  {
+    sprintf(rfd_str, "%d", req[0]);
+    sprintf(wfd_str, "%d", rep[1]);
+    args[0] = BPIPE_PATH;
+    args[1] = "-e";
+    args[2] = rfd_str;
+    args[3] = wfd_str;
+    args[4] = NULL;
+
+    pthread_attr_setforkcpuid_np(sysconf(_SC_NPROCESSORS_ONLN) - 1);
+    pthread_attr_setforkinfo_np(PT_FORK_WILL_EXEC | PT_FORK_TARGET_CPU);
+
+    pid = fork();
+
+    if(pid == 0)
+    {
+      close(req[1]);
+      close(rep[0]);
+      execv(args[0], args);
+      perror("exec");
+      exit(EXIT_FAILURE);
+    }
+
+    pthread_attr_setforkinfo_np(PT_FORK_DEFAULT);
+
+    if(pid < 0)
+    {
+      fprintf(stderr, "fork failed [%d]\n", errno);
+      return EXIT_FAILURE;
+    }
+
+    close(req[0]);
+    close(rep[1]);
+  }
+  else if((err = pthread_create(&th, NULL, echo_thread, fds)))
+  {
+    fprintf(stderr, "pthread_create failed [%d]\n", err);
+    return EXIT_FAILURE;
+  }
+
+  if(read(rep[0], &cid, sizeof(cid)) != sizeof(cid))
+  {
+    fprintf(stderr, "echo did not start\n");
+    return EXIT_FAILURE;
+  }
+
+  byte  = 0x5A;
+  start = clock();
+
+  for(i = 0; i < rounds; i++)
+  {
+    if((write(req[1], &byte, 1) != 1) || (read(rep[0], &byte, 1) != 1))
+    {
+      fprintf(stderr, "round %d: echo failed [%d]\n", i, errno);
+      return EXIT_FAILURE;
+    }
+  }
+
+  elapsed = clock() - start;
+
+  close(req[1]);
+
+  if(!isRemote)
+  {
+    pthread_join(th, NULL);
+    close(req[0]);
+    close(rep[1]);
+  }
+
+  close(rep[0]);
+
+  printf("%s echo on cluster %u (this on %u): %d round trips in %u ticks, %u ticks each\n",
+	 (isRemote) ? "task" : "thread", (unsigned)cid, (unsigned)getcid(),
+	 rounds, (unsigned)elapsed, (rounds) ? (unsigned)elapsed / rounds : 0);
+
+  return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+  size_t total;
+  unsigned i;
+  int rounds;
+  int err;
+
+  if((argc == 4) && (strcmp(argv[1], "-e") == 0))
+    return echo(atoi(argv[2]), atoi(argv[3]));
+
+  total  = ((argc > 1) ? atoi(argv[1]) : DEFAULT_MBYTES) * 1024 * 1024;
+  rounds = (argc > 2) ? atoi(argv[2]) : DEFAULT_ROUNDS;
+
+  memset(wbuff, 0xA5, sizeof(wbuff));
+
+  printf("Pipe throughput, %u bytes per run\n", total);
+
+  for(i = 0; i < sizeof(chunks)/sizeof(chunks[0]); i++)
+  {
+    if((err = run(chunks[i], total)))
+      return err;
+  }
+
+  printf("Pipe latency, %d round trips of 1 byte\n", rounds);
+
+  if((err = latency(rounds, 0)))
+    return err;
+
+  return latency(rounds, 1);
+}
@@ -0,0 +1,124 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <openssl/sha.h>
+
+#define DEFAULT_BUFFERS  256
+#define DEFAULT_KBYTES   16
+#define DEFAULT_MBYTES   4
+
+static unsigned rate(size_t bytes, clock_t ticks)
+{
+  return (ticks) ? (unsigned)(((unsigned long long)bytes * 1000) / ticks) : 0;
+}
+
+int main(int argc, char **argv)
+{
+  const unsigned char **bufs;
+  unsigned char *data;
+  unsigned char *md;
+  unsigned char ref[SHA256_DIGEST_LENGTH];
+  unsigned char root[SHA256_DIGEST_LENGTH];
+  size_t *lens;
+  size_t count;
+  size_t size;
+  size_t tree;
+  size_t total;
+  size_t i;
+  unsigned seed;
+  clock_t start;
+  clock_t btime;
+  clock_t ttime;
+  int cpu_nr;
+  int nthreads;
+
+  count  = (argc > 1) ? atoi(argv[1]) : DEFAULT_BUFFERS;
+  size   = ((argc > 2) ? atoi(argv[2]) : DEFAULT_KBYTES) * 1024;
+  tree   = ((argc > 3) ? atoi(argv[3]) : DEFAULT_MBYTES) * 1024 * 1024;
+  total  = (count * size > tree) ? count * size : tree;
+  cpu_nr = sysconf(_SC_NPROCESSORS_ONLN);
+
+  data = malloc(total);
+  bufs = malloc(count * sizeof(*bufs));
+  lens = malloc(count * sizeof(*lens));
+  md   = malloc(count * SHA256_DIGEST_LENGTH);
+
+  if((data == NULL) || (bufs == NULL) || (lens == NULL) || (md == NULL))
+  {
+    fprintf(stderr, "cannot allocate %u bytes\n", total);
+    return EXIT_FAILURE;
+  }
+
+  for(seed = 1, i = 0; i < total; i++)
+  {
+    seed    = seed * 1103515245 + 12345;
+    data[i] = seed >> 16;
+  }
+
+  /* the buffers of a batch are of uneven sizes, as files are */
+  for(i = 0; i < count; i++)
+  {
+    bufs[i] = data + i * size;
+    lens[i] = size - (i * 61) % (size / 2 + 1);
+  }
+
+  if(!SHA_batch(SHA_ALG_SHA256, bufs, lens, count, md, cpu_nr))
+  {
+    fprintf(stderr, "SHA_batch failed\n");
+    return EXIT_FAILURE;
+  }
+
+  for(i = 0; i < count; i++)
+  {
+    SHA256(bufs[i], lens[i], ref);
+
+    if(memcmp(ref, md + i * SHA256_DIGEST_LENGTH, SHA256_DIGEST_LENGTH))
+    {
+      fprintf(stderr, "SHA_batch: digest %u differs from SHA256\n", i);
+      return EXIT_FAILURE;
+    }
+  }
+
+  if(SHA_tree(SHA_ALG_SHA256, data, tree, 0, root, 1) == NULL)
+  {
+    fprintf(stderr, "SHA_tree failed\n");
+    return EXIT_FAILURE;
+  }
+
+  for(size = 0, i = 0; i < count; i++)
+    size += lens[i];
+
+  printf("Parallel SHA-256: batch of %u buffers, %u bytes, tree of %u bytes, up to %d threads\n",
+	 count, size, tree, cpu_nr);
+
+  for(nthreads = 1; ; nthreads = (nthreads * 2 < cpu_nr) ? nthreads * 2 : cpu_nr)
+  {
+    start = clock();
+    SHA_batch(SHA_ALG_SHA256, bufs, lens, count, md, nthreads);
+    btime = clock() - start;
+
+    start = clock();
+    SHA_tree(SHA_ALG_SHA256, data, tree, 0, ref, nthreads);
+    ttime = clock() - start;
+
+    if(memcmp(ref, root, SHA256_DIGEST_LENGTH))
+    {
+      fprintf(stderr, "SHA_tree: %d threads root differs from 1 thread root\n", nthreads);
+      return EXIT_FAILURE;
+    }
+
+    printf("%2d threads: batch %u bytes/Kticks, tree %u bytes/Kticks\n",
+	   nthreads, rate(size, btime), rate(tree, ttime));
+
+    if(nthreads >= cpu_nr)
+      break;
+  }
+
+  free(md);
+  free(lens);
+  free(bufs);
+  free(data);
+  return EXIT_SUCCESS;
+}
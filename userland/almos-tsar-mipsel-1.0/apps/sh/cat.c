@@ -26,8 +26,12 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <errno.h>
+#include <sys/sendfile.h>
 #include "ush.h"
 
+#define SENDFILE_CHUNK (64*1024)
+
 
 int cat_func(void *param)
 {
@@ -52,11 +56,17 @@ int cat_func(void *param)
     if((fd=open(path_name,O_RDONLY,0)) == -1)
       return -1;
     
-    while((size = read(fd,&buffer[0],BUFFER_SIZE-1)) > 0)
-    { 
-      write(STDOUT_FILENO, &buffer[0], size);
-      //memset(buffer,0, BUFFER_SIZE);
-      //if((ch=getChar()) == 'q') break;
+    while((size = sendfile(STDOUT_FILENO,fd,NULL,SENDFILE_CHUNK)) > 0)
+      continue;
+
+    if((size < 0) && (errno == EINVAL))
+    {
+      while((size = read(fd,&buffer[0],BUFFER_SIZE-1)) > 0)
+      { 
+	write(STDOUT_FILENO, &buffer[0], size);
+	//memset(buffer,0, BUFFER_SIZE);
+	//if((ch=getChar()) == 'q') break;
+      }
     }
     close(fd);
    
@@ -25,8 +25,11 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <errno.h>
+#include <sys/sendfile.h>
 #include "ush.h"
 
+#define SENDFILE_CHUNK (64*1024)
+
 int cp_func(void *param)
 {
   const char *src_name;
@@ -75,11 +78,17 @@ int cp_func(void *param)
       errno = err;
       return -1;
     }
-    size = 0;
-    while((size = read(src_fd,buffer,BUFFER_SIZE)) > 0)
+    /* Copy within the kernel, fall back to the buffer for non regular files */
+    while((size = sendfile(dst_fd,src_fd,NULL,SENDFILE_CHUNK)) > 0)
+      continue;
+
+    if((size < 0) && (errno == EINVAL))
     {
-      if((size=write(dst_fd,buffer,size)) < 0)
-	goto CP_FUNC_ERROR;
+      while((size = read(src_fd,buffer,BUFFER_SIZE)) > 0)
+      {
+	if((size=write(dst_fd,buffer,size)) < 0)
+	  goto CP_FUNC_ERROR;
+      }
     }
     
     if(size < 0) goto CP_FUNC_ERROR;
@@ -10,12 +10,17 @@
  */
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <unistd.h>
+#include <time.h>
 #include <sys/mman.h>
 #include <GL/gl.h> 
 #include <GL/oscontext.h> 
 #include "ui.h"
 
+#define UI_FPS_FRAMES  16	/* frames between two frame rate reports */
+#define UI_MAX_BUFFERS 4	/* largest [BUFFERS] value of /etc/fbrc */
+
 static ostgl_context *ctx;
 
 void tkSwapBuffers(void)
@@ -24,6 +29,65 @@ void tkSwapBuffers(void)
 }
 
 
+/* swap is the part of ticks spent presenting the frames */
+static void ui_fps(int threads, int frames, clock_t ticks, uint64_t swap)
+{
+  uint64_t fps;
+
+  fps = (ticks) ? ((uint64_t)frames * CLOCKS_PER_SEC * 100) / ticks : 0;
+
+  fprintf(stderr, "%d thread(s): %d frames in %llu ticks, %u.%02u fps, present %llu ticks/frame\n",
+	  threads, frames, (uint64_t)ticks,
+	  (unsigned)(fps / 100), (unsigned)(fps % 100),
+	  swap / frames);
+}
+
+/* Render UI_FPS_FRAMES frames with 1, 2, 4, ... rasterizer threads
+ * up to the number of cpus, reporting the frame rate of each run */
+static void ui_sweep(void)
+{
+  clock_t start;
+  uint64_t swap;
+  int cpu_nr;
+  int threads;
+  int i;
+
+  cpu_nr  = sysconf(_SC_NPROCESSORS_ONLN);
+  threads = 1;
+
+  while(1)
+  {
+    if(ostgl_set_threads(ctx, threads))
+      fprintf(stderr, "WARNING: failed to start %d rasterizer threads\n", threads);
+
+    /* warm up the new rasterizer threads */
+    idle();
+
+    start = clock();
+    swap  = ctx->swap_ticks;
+
+    for(i = 0; i < UI_FPS_FRAMES; i++)
+      idle();
+
+    ui_fps(threads, UI_FPS_FRAMES, clock() - start, ctx->swap_ticks - swap);
+
+    if(threads >= cpu_nr)
+      break;
+
+    threads = (threads * 2 < cpu_nr) ? threads * 2 : cpu_nr;
+  }
+}
+
+/* 
+ * argv[2], when given, is the number of rasterizer threads; 0 runs
+ * ui_sweep() to measure the frame rate against the thread count.
+ *
+ * With [BUFFERS]=1 (the default) in /etc/fbrc, frames are rendered
+ * straight into the mmap'ed frame-buffer and presenting them costs
+ * nothing.  With [BUFFERS]=2 or more, frames are rendered into memory
+ * buffers in turn and page flipped to the frame-buffer, so the screen
+ * never shows a frame being drawn.
+ */
 int ui_loop(int argc, char **argv, const char *name)
 {
   void *dsiplay;
@@ -37,6 +101,11 @@ int ui_loop(int argc, char **argv, const char *name)
   int fd;
   FILE *fbrc;
   void *display;
+  void *buffers[UI_MAX_BUFFERS];
+  size_t nbuffers;
+  uint64_t swap;
+  int threads;
+  int frames;
   int err;
 
   pgsize = sysconf(_SC_PAGE_SIZE);
@@ -58,19 +127,23 @@ int ui_loop(int argc, char **argv, const char *name)
   xsize = 0;
   ysize = 0;
   mode = 0;
+  nbuffers = 1;
 
   fscanf(fbrc, "\n[XSIZE]=%u\n", &xsize);
   fscanf(fbrc, "\n[YSIZE]=%u\n", &ysize);
   fscanf(fbrc, "\n[MODE]=%u\n", &mode);
+  fscanf(fbrc, "\n[BUFFERS]=%u\n", &nbuffers);
 
   fclose(fbrc);
   
-  if((xsize == 0) || (ysize == 0) || (mode != 16))
+  if((xsize == 0) || (ysize == 0) || (mode != 16) || 
+     (nbuffers == 0) || (nbuffers > UI_MAX_BUFFERS))
   {
-    fprintf(stderr, "ERROR: dont like these info: xsize %d, ysize %d, mode %d\n", 
+    fprintf(stderr, "ERROR: dont like these info: xsize %d, ysize %d, mode %d, buffers %d\n", 
 	    xsize,
 	    ysize,
-	    mode);
+	    mode,
+	    nbuffers);
 
     exit(3);
   }
@@ -101,13 +174,26 @@ int ui_loop(int argc, char **argv, const char *name)
     exit(5);
   }
   
-  ctx = ostgl_create_context(xsize, ysize, 16, &display, 1);
+  if(nbuffers == 1)
+    ctx = ostgl_create_context(xsize, ysize, 16, &display, 1);
+  else
+  {
+    /* let TinyGL allocate the back buffers */
+    memset(buffers, 0, sizeof(buffers));
+    ctx = ostgl_create_context(xsize, ysize, 16, buffers, nbuffers);
+  }
 
   if(ctx == NULL)
   {
     fprintf(stderr, "ERROR: failed to create ostgl ctx\n");
     exit(6);
   }
+
+  if((nbuffers > 1) && ostgl_set_front(ctx, display))
+  {
+    fprintf(stderr, "ERROR: failed to start page flipping\n");
+    exit(7);
+  }
   
   ostgl_make_current(ctx,0);
   
@@ -123,10 +209,33 @@ int ui_loop(int argc, char **argv, const char *name)
   tm_now = clock();
   fprintf(stderr, " done [%llu]\n", tm_now - tm_tmp);
 
+  threads = (argc > 2) ? atoi(argv[2]) : 1;
+
+  if(threads <= 0)
+  {
+    ui_sweep();
+    exit(0);
+  }
+
+  if(ostgl_set_threads(ctx, threads))
+    fprintf(stderr, "WARNING: failed to start %d rasterizer threads\n", threads);
+
+  frames = 0;
+  tm_tmp = clock();
+  swap   = ctx->swap_ticks;
+
   while (1) 
   {
     idle();
-    fprintf(stderr, "Time now %llu\n", (uint64_t)clock());
+
+    if(++frames == UI_FPS_FRAMES)
+    {
+      tm_now = clock();
+      ui_fps(threads, frames, tm_now - tm_tmp, ctx->swap_ticks - swap);
+      tm_tmp = tm_now;
+      swap   = ctx->swap_ticks;
+      frames = 0;
+    }
   }
     
   return 0;
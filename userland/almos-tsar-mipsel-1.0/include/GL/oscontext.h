@@ -12,6 +12,13 @@ typedef struct {
   int xsize, ysize;
   int depth;
   int bytes_per_line;
+  /* page flipping, see ostgl_set_front() */
+  void *front;
+  int current;
+  void *flip;
+  /* frame timing: clock() ticks spent presenting frames */
+  unsigned long swap_count;
+  unsigned long long swap_ticks;
 } ostgl_context;
 
 ostgl_context *
@@ -32,6 +39,18 @@ ostgl_resize(ostgl_context * context,
              const int ysize,
              void **framebuffers);
 
+/* rasterize with nb_threads threads, each one owning a band of the
+   screen; 1 (the default) rasterizes on the calling thread. */
+int
+ostgl_set_threads(ostgl_context *context, const int nb_threads);
+
+/* present the buffers by page flipping: they are rendered in turn and
+   each finished one is copied to front while the next one is drawn.
+   Without a front, a buffer rendered straight into its framebuffer
+   (the mmap'ed device) costs no copy at all. */
+int
+ostgl_set_front(ostgl_context *context, void *front);
+
 void
 ostgl_swap_buffers(ostgl_context *context);
 
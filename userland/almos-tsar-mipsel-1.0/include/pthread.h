@@ -120,12 +120,17 @@ void __pthread_keys_init(void);
 void __pthread_keys_destroy(void);
 void __pthread_barrier_init(void);
 
+/* Block while *addr == val / wakeup count threads blocked on addr */
+int __pthread_futex_wait(volatile uint_t *addr, uint_t val);
+int __pthread_futex_wake(volatile uint_t *addr, uint_t count);
+
 #define __pthread_tls_seterrno(tls,errno)
 
 #define __PTHREAD_OBJECT_CREATED   0xA5B5
 #define __PTHREAD_OBJECT_DESTROYED 0xB0A0B0A0
 #define __PTHREAD_OBJECT_BUSY      0x5A5A5A5A
 #define __PTHREAD_OBJECT_FREE      0xC0A5C0A5
+#define __PTHREAD_SHARED_HEAP      0x5EA05EA0
 
 typedef unsigned long pthread_t;
 typedef unsigned long pthread_rwlock_t;
@@ -0,0 +1,20 @@
+#ifndef _SYS_SELECT_H
+#define _SYS_SELECT_H
+
+#include <sys/types.h>
+#include <time.h>
+
+#define FD_SETSIZE	32
+
+typedef struct {
+  unsigned long fds_bits;
+} fd_set;
+
+#define FD_ZERO(set)		((set)->fds_bits = 0)
+#define FD_SET(fd, set)		((set)->fds_bits |= (1UL << (fd)))
+#define FD_CLR(fd, set)		((set)->fds_bits &= ~(1UL << (fd)))
+#define FD_ISSET(fd, set)	(((set)->fds_bits & (1UL << (fd))) != 0)
+
+int select(int nfds, fd_set *readfds, fd_set *writefds, fd_set *exceptfds, struct timeval *timeout);
+
+#endif
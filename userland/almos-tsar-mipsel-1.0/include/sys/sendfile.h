@@ -0,0 +1,11 @@
+#ifndef _SYS_SENDFILE_H
+#define _SYS_SENDFILE_H
+
+#include <sys/types.h>
+
+/* Copy count bytes of in_fd to out_fd without going through user
+ * memory.  in_fd must be a regular file; reading starts at *offset,
+ * which is then updated, or at the file offset when offset is NULL. */
+ssize_t sendfile(int out_fd, int in_fd, off_t *offset, size_t count);
+
+#endif
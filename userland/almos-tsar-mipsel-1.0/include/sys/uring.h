@@ -0,0 +1,90 @@
+#ifndef _SYS_URING_H
+#define _SYS_URING_H
+
+#include <sys/types.h>
+
+/*
+ * Asynchronous system call ring.
+ *
+ * Submissions are queued in user memory and handed to the kernel in
+ * batches: either inline, several per trap (uring_submit), or to a
+ * worker thread running uring_worker() that serves the ring from the
+ * kernel without the submitter trapping at all.  Completions are
+ * polled from user memory (uring_peek_cqe) or waited for
+ * (uring_wait_cqe).  A ring has one submitting and one completing
+ * thread at a time.
+ */
+
+/* Must match the kernel's uring_opcode_t */
+enum {
+  URING_OP_NOP,
+  URING_OP_READ,
+  URING_OP_WRITE,
+  URING_OP_PREAD,
+  URING_OP_PWRITE,
+  URING_OP_OPEN,
+  URING_OP_CLOSE,
+  URING_OP_STAT,
+  URING_OP_FSYNC,
+};
+
+#define URING_ENTRIES_MAX   4096
+
+struct uring_sqe {
+  unsigned int opcode;
+  int fd;
+  void *addr;		/* buffer, path for open, stat buffer for stat */
+  void *addr2;		/* path for stat (fd is -1) */
+  unsigned int len;	/* length, flags for open */
+  unsigned int offset;	/* offset, mode for open */
+  unsigned int user_data;
+  unsigned int pad;
+};
+
+struct uring_cqe {
+  unsigned int user_data;
+  int res;		/* result or -errno */
+};
+
+struct uring {
+  /* Shared with the kernel, must match its struct uring_s */
+  volatile unsigned int sq_head;
+  volatile unsigned int sq_tail;
+  volatile unsigned int cq_head;
+  volatile unsigned int cq_tail;
+  volatile unsigned int kflags;
+  volatile unsigned int uflags;
+  unsigned int entries;
+  struct uring_sqe *sqes;
+  struct uring_cqe *cqes;
+  /* Private */
+  unsigned int sq_local;	/* next free sqe, not yet submitted */
+};
+
+int uring_init(struct uring *ring, unsigned int entries);
+void uring_destroy(struct uring *ring);
+
+struct uring_sqe *uring_get_sqe(struct uring *ring);
+int uring_submit(struct uring *ring);
+
+int uring_peek_cqe(struct uring *ring, struct uring_cqe **cqe);
+int uring_wait_cqe(struct uring *ring, struct uring_cqe **cqe);
+void uring_cqe_seen(struct uring *ring);
+
+int uring_worker(struct uring *ring);
+void uring_stop(struct uring *ring);
+
+static inline void uring_prep_rw(struct uring_sqe *sqe, unsigned int opcode, int fd,
+				 void *addr, unsigned int len, unsigned int offset,
+				 unsigned int user_data)
+{
+  sqe->opcode    = opcode;
+  sqe->fd        = fd;
+  sqe->addr      = addr;
+  sqe->addr2     = 0;
+  sqe->len       = len;
+  sqe->offset    = offset;
+  sqe->user_data = user_data;
+}
+
+#endif
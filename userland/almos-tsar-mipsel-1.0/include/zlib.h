@@ -1249,6 +1249,41 @@ ZEXTERN void ZEXPORT gzclearerr OF((gzFile file));
    file that is being written concurrently.
 */
 
+                        /* parallel gzip functions */
+
+#define PGZ_BLOCK       (128*1024) /* default uncompressed block size */
+#define PGZ_INDEPENDENT 0x01       /* no dictionary priming across blocks */
+
+ZEXTERN int ZEXPORT pgz_deflate OF((int out, int in, int level,
+                                    int nthreads, uLong block, int flags));
+/*
+     Compresses the file descriptor in into the gzip stream out, with
+   nthreads threads.  The input is cut in blocks of block bytes
+   (PGZ_BLOCK if 0) deflated in parallel and written in order as a single
+   gzip member, readable by gzread() or gunzip.  Each block is primed with
+   the end of the previous one, unless flags has PGZ_INDEPENDENT.
+
+     When in is a regular file and out is seekable, the gzip header
+   carries the compressed size of every block.  Streams written with
+   PGZ_INDEPENDENT and this block index can be inflated in parallel.
+
+     pgz_deflate returns Z_OK if success, Z_ERRNO on a read or write
+   error, Z_MEM_ERROR if there was not enough memory, Z_STREAM_ERROR if
+   level is invalid.
+*/
+
+ZEXTERN int ZEXPORT pgz_inflate OF((int out, int in, int nthreads));
+/*
+     Decompresses the gzip stream in into the file descriptor out.  The
+   blocks of streams written by pgz_deflate() with PGZ_INDEPENDENT and a
+   block index are inflated in parallel with nthreads threads; any other
+   single member gzip stream is inflated on the calling thread.
+
+     pgz_inflate returns Z_OK if success, Z_ERRNO on a read or write
+   error, Z_MEM_ERROR if there was not enough memory, Z_DATA_ERROR if the
+   stream is corrupted or its CRC or length does not match.
+*/
+
                         /* checksum functions */
 
 /*